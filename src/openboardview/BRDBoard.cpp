@@ -16,72 +16,137 @@ using namespace std::placeholders;
 const string BRDBoard::kNetUnconnectedPrefix = "UNCONNECTED";
 const string BRDBoard::kComponentDummyName   = "...";
 
-BRDBoard::BRDBoard(const BRDFileBase * const boardFile)
-    : m_file(boardFile) {
-	// TODO: strip / trim all strings, especially those used as keys
-	// TODO: just loop through original arrays?
-	vector<BRDPart> m_parts(m_file->num_parts);
-	vector<BRDPin> m_pins(m_file->num_pins);
-	vector<BRDNail> m_nails(m_file->num_nails);
-	vector<BRDPoint> m_points(m_file->num_format);
+namespace {
+
+// Open addressing table of the nets by name.
+// The keys point into the board file strings, so interning a pin net does not build any std::string.
+class NetTable {
+  public:
+	explicit NetTable(size_t count) {
+		size_t capacity = 64;
+		while (capacity < count * 2) capacity *= 2;
+		slots.resize(capacity);
+	}
 
-	m_parts  = m_file->parts;
-	m_pins   = m_file->pins;
-	m_nails  = m_file->nails;
-	m_points = m_file->format;
+	// nullptr if the name was not inserted
+	Net *find(const char *name, size_t size) const {
+		return slots[lookup(name, size, hash(name, size))].net;
+	}
+
+	// Replaces the net if the name was already inserted
+	void insert(const char *name, size_t size, Net *net) {
+		uint32_t h = hash(name, size);
+		Slot &slot = slots[lookup(name, size, h)];
+		if (!slot.net) used++;
+		slot = {name, size, h, net};
+		if (used * 2 > slots.size()) grow();
+	}
+
+  private:
+	struct Slot {
+		const char *name = nullptr;
+		size_t size      = 0;
+		uint32_t hash    = 0;
+		Net *net         = nullptr; // nullptr for a free slot
+	};
+
+	// FNV-1a
+	static uint32_t hash(const char *name, size_t size) {
+		uint32_t h = 2166136261u;
+		for (size_t i = 0; i < size; i++) h = (h ^ static_cast<uint8_t>(name[i])) * 16777619u;
+		return h;
+	}
+
+	// Slot holding name, or the free slot ending its probe sequence
+	size_t lookup(const char *name, size_t size, uint32_t h) const {
+		size_t mask = slots.size() - 1;
+		for (size_t i = h & mask;; i = (i + 1) & mask) {
+			const Slot &slot = slots[i];
+			if (!slot.net || (slot.hash == h && slot.size == size && !memcmp(slot.name, name, size))) return i;
+		}
+	}
+
+	void grow() {
+		std::vector<Slot> old(slots.size() * 2);
+		old.swap(slots);
+		for (auto &slot : old) {
+			if (slot.net) slots[lookup(slot.name, slot.size, slot.hash)] = slot;
+		}
+	}
+
+	std::vector<Slot> slots;
+	size_t used = 0;
+};
+
+} // namespace
+
+BRDBoard::BRDBoard(const BRDFileBase * const boardFile) {
+	// TODO: strip / trim all strings, especially those used as keys
+	// Everything is read straight from the file arrays, the board keeps no reference to them
+	const auto &brd_parts = boardFile->parts;
+	const auto &brd_pins  = boardFile->pins;
+	const auto &brd_nails = boardFile->nails;
 
 	// Set outline
 	{
-		for (auto &brdPoint : m_points) {
+		outline_points_.reserve(boardFile->format.size());
+		for (auto &brdPoint : boardFile->format) {
 			auto point = make_shared<Point>(brdPoint.x, brdPoint.y);
 			outline_points_.push_back(point);
 		}
 	}
 
-	outline_segments_.reserve(m_file->outline_segments.size());
-	std::transform(m_file->outline_segments.begin(), m_file->outline_segments.end(), std::back_inserter(outline_segments_), [](const std::pair<BRDPoint, BRDPoint> &s) -> std::pair<Point, Point> {
+	outline_segments_.reserve(boardFile->outline_segments.size());
+	std::transform(boardFile->outline_segments.begin(), boardFile->outline_segments.end(), std::back_inserter(outline_segments_), [](const std::pair<BRDPoint, BRDPoint> &s) -> std::pair<Point, Point> {
 		return {{s.first.x, s.first.y}, {s.second.x, s.second.y}};
 	});
 
-	// Populate map of unique nets
-	SharedStringMap<Net> net_map;
+	// Populate table of unique nets
+	NetTable net_table(brd_nails.size() + 1);
+	Net *net_nc;
 	{
 		// adding special net 'UNCONNECTED'
-		auto net_nc           = make_shared<Net>();
-		net_nc->name          = kNetUnconnectedPrefix;
-		net_nc->is_ground     = false;
-		net_map[net_nc->name] = net_nc;
+		nets_.reserve(brd_nails.size() + 1);
+		nets_.push_back(make_shared<Net>());
+		net_nc            = nets_.back().get();
+		net_nc->name      = kNetUnconnectedPrefix;
+		net_nc->is_ground = false;
+		net_table.insert(net_nc->name.c_str(), net_nc->name.size(), net_nc);
 
 		// handle all the others
-		for (auto &brd_nail : m_nails) {
-			auto net = make_shared<Net>();
-
-			// copy NET name and number (probe)
-			net->name = string(brd_nail.net);
-
+		for (auto &brd_nail : brd_nails) {
 			// avoid having multiple UNCONNECTED<XXX> references
-			if (is_prefix(kNetUnconnectedPrefix, net->name)) continue;
+			if (!strncmp(brd_nail.net, kNetUnconnectedPrefix.c_str(), kNetUnconnectedPrefix.size())) continue;
+
+			// so we can find nets later by name (making unique by name), the last nail of a net wins
+			size_t size = strlen(brd_nail.net);
+			Net *net    = net_table.find(brd_nail.net, size);
+			if (!net) {
+				nets_.push_back(make_shared<Net>());
+				net       = nets_.back().get();
+				net->name = string(brd_nail.net, size);
+				net_table.insert(brd_nail.net, size, net);
+			}
 
-			net->number    = brd_nail.probe;
+			// copy NET number (probe)
+			net->number = brd_nail.probe;
 
 			if (brd_nail.side == BRDPartMountingSide::Top) {
 				net->board_side = kBoardSideTop;
 			} else {
 				net->board_side = kBoardSideBottom;
 			}
-
-			// so we can find nets later by name (making unique by name)
-			net_map[net->name] = net;
 		}
 	}
 
 	// Populate parts
 	{
-		for (auto &brd_part : m_parts) {
+		components_.reserve(brd_parts.size() + 1);
+		for (auto &brd_part : brd_parts) {
 			auto comp = make_shared<Component>();
 
 			comp->name    = string(brd_part.name);
-			comp->mfgcode = std::move(brd_part.mfgcode);
+			comp->mfgcode = brd_part.mfgcode;
 
 			comp->p1 = {brd_part.p1.x, brd_part.p1.y};
 			comp->p2 = {brd_part.p2.x, brd_part.p2.y};
@@ -104,37 +169,64 @@ BRDBoard::BRDBoard(const BRDFileBase * const boardFile)
 		}
 	}
 
-	// Populate pins
+	// Populate pins, with the net and component of each pin kept aside until the sorts below give their handles
+	std::vector<Net *> pin_nets;
+	std::vector<Component *> pin_components;
 	{
 		// generate dummy component as reference
 		auto comp_dummy            = make_shared<Component>();
 		comp_dummy->name           = kComponentDummyName;
 		comp_dummy->component_type = Component::kComponentTypeDummy;
 
+		// Pins per component, so that their vectors are allocated once
+		{
+			std::vector<uint32_t> part_pins(components_.size(), 0);
+			size_t dummy_pins = 0;
+			for (auto &brd_pin : brd_pins) {
+				if (brd_pin.part - 1 < part_pins.size()) part_pins[brd_pin.part - 1]++;
+			}
+			for (size_t i = 0; i < components_.size(); i++) {
+				if (components_[i]->is_dummy()) {
+					dummy_pins += part_pins[i];
+				} else {
+					components_[i]->pins.reserve(part_pins[i]);
+				}
+			}
+			comp_dummy->pins.reserve(dummy_pins);
+		}
+
 		// NOTE: originally the pin diameter depended on part.name[0] == 'U' ?
 		unsigned int pin_idx  = 0;
 		unsigned int part_idx = 1;
-		auto pins             = m_pins;
-		auto parts            = m_parts;
 
-		for (size_t i = 0; i < pins.size(); i++) {
+		pins_.reserve(brd_pins.size());
+		pin_columns_.resize(brd_pins.size());
+		pin_columns_.nets       = &nets_;
+		pin_columns_.components = &components_;
+		pin_nets.reserve(brd_pins.size());
+		pin_components.reserve(brd_pins.size());
+
+		for (size_t i = 0; i < brd_pins.size(); i++) {
 			// (originally from BoardView::DrawPins)
-			const BRDPin &brd_pin = pins[i];
-			std::shared_ptr<Component> comp       = components_[brd_pin.part - 1];
+			const BRDPin &brd_pin = brd_pins[i];
+			const std::shared_ptr<Component> &comp = components_[brd_pin.part - 1];
 
 			if (!comp) continue;
 
-			auto pin = make_shared<Pin>();
+			auto pin      = make_shared<Pin>();
+			pin->index    = pins_.size();
+			pin->columns  = &pin_columns_;
+			uint8_t &type = pin_columns_.type[pin->index];
 
 			if (comp->is_dummy()) {
 				// component is virtual, i.e. "...", pin is test pad
-				pin->type      = Pin::kPinTypeTestPad;
-				pin->component = comp_dummy;
+				type = Pin::kPinTypeTestPad;
+				pin_components.push_back(comp_dummy.get());
 				comp_dummy->pins.push_back(pin);
 			} else {
 				// component is regular / not virtual
-				pin->type       = Pin::kPinTypeComponent;
-				pin->component  = comp;
+				type = Pin::kPinTypeComponent;
+				pin_components.push_back(comp.get());
 				comp->pins.push_back(pin);
 			}
 
@@ -159,56 +251,58 @@ BRDBoard::BRDBoard(const BRDFileBase * const boardFile)
 			}
 
 			// copy position
-			pin->position = Point(brd_pin.pos.x, brd_pin.pos.y);
+			pin->position() = Point(brd_pin.pos.x, brd_pin.pos.y);
 
 			// Set board side for pins from specific setting
+			EBoardSide side;
 			if (brd_pin.side == BRDPinSide::Top) {
-				pin->board_side = kBoardSideTop;
+				side = kBoardSideTop;
 			} else if (brd_pin.side == BRDPinSide::Bottom) {
-				pin->board_side = kBoardSideBottom;
+				side = kBoardSideBottom;
 			} else {
-				pin->board_side = kBoardSideBoth;
+				side = kBoardSideBoth;
 			}
+			pin_columns_.side[pin->index] = side;
 
 			// set net reference (here's our NET key string again)
-			string net_name = string(brd_pin.net);
-			if (net_map.count(net_name)) {
-				// there is a net with that name in our map
-				pin->net = net_map[net_name].get();
-			} else {
+			size_t net_size = strlen(brd_pin.net);
+			Net *pin_net    = net_table.find(brd_pin.net, net_size);
+			if (!pin_net) {
 				// no net with that name registered, so create one
-				if (!net_name.empty()) {
-					if (is_prefix(kNetUnconnectedPrefix, net_name)) {
+				if (net_size) {
+					if (!strncmp(brd_pin.net, kNetUnconnectedPrefix.c_str(), kNetUnconnectedPrefix.size())) {
 						// pin is unconnected, so reference our special net
-						pin->net  = net_map[kNetUnconnectedPrefix].get();
-						pin->type = Pin::kPinTypeNotConnected;
+						pin_net = net_nc;
+						type    = Pin::kPinTypeNotConnected;
 					} else {
 						// indeed a new net
-						auto net        = make_shared<Net>();
-						net->name       = net_name;
-						net->board_side = pin->board_side;
+						nets_.push_back(make_shared<Net>());
+						auto net        = nets_.back().get();
+						net->name       = string(brd_pin.net, net_size);
+						net->board_side = side;
 						// NOTE: net->number not set
-						net_map[net_name] = net;
-						pin->net          = net.get();
+						net_table.insert(brd_pin.net, net_size, net);
+						pin_net = net;
 					}
 				} else {
 					// not sure this can happen -> no info
 					// It does happen in .fz apparently and produces a SEGFAULT… Use
 					// unconnected net.
-					pin->net  = net_map[kNetUnconnectedPrefix].get();
-					pin->type = Pin::kPinTypeNotConnected;
+					pin_net = net_nc;
+					type    = Pin::kPinTypeNotConnected;
 				}
 			}
+			pin_nets.push_back(pin_net);
 
 			// TODO: should either depend on file specs or type etc
 			//
-			//  if(brd_pin.radius) pin->diameter = brd_pin.radius; // some format
+			//  if(brd_pin.radius) pin->diameter() = brd_pin.radius; // some format
 			//  (.fz) contains a radius field
-			//    else pin->diameter = 0.5f;
-			pin->diameter = brd_pin.radius; // some format (.fz) contains a radius field
+			//    else pin->diameter() = 0.5f;
+			pin->diameter() = brd_pin.radius; // some format (.fz) contains a radius field
 
-			pin->net->pins.push_back(pin);
-			pins_.push_back(pin);
+			pin_net->pins.push_back(pin);
+			pins_.push_back(std::move(pin));
 		}
 
 		// remove all dummy components from vector, add our official dummy
@@ -217,19 +311,30 @@ BRDBoard::BRDBoard(const BRDFileBase * const boardFile)
 		    end(components_));
 
 		components_.push_back(comp_dummy);
+
+		// Skipped pins leave no hole in the handles
+		pin_columns_.resize(pins_.size());
 	}
 
-	// Populate Net vector by using the map. (sorted by keys)
-	for (auto &net : net_map) {
+	// Sort nets by name, as they used to come out of a std::map
+	sort(begin(nets_), end(nets_), [](const shared_ptr<Net> &lhs, const shared_ptr<Net> &rhs) { return lhs->name < rhs->name; });
+	for (auto &net : nets_) {
 		// check whether the pin represents ground
-		net.second->is_ground = (net.second->name == "GND" || net.second->name == "GROUND");
-		nets_.push_back(net.second);
+		net->is_ground = (net->name == "GND" || net->name == "GROUND");
 	}
 
 	// Sort components by name
 	sort(begin(components_), end(components_), [](const shared_ptr<Component> &lhs, const shared_ptr<Component> &rhs) {
 		return lhs->name < rhs->name;
 	});
+
+	// Handles are the final positions in the vectors
+	for (size_t i = 0; i < nets_.size(); i++) nets_[i]->index = i;
+	for (size_t i = 0; i < components_.size(); i++) components_[i]->index = i;
+	for (size_t i = 0; i < pins_.size(); i++) {
+		pin_columns_.net[i]       = pin_nets[i]->index;
+		pin_columns_.component[i] = pin_components[i]->index;
+	}
 }
 
 BRDBoard::~BRDBoard() {}
@@ -242,6 +347,10 @@ SharedVector<Pin> &BRDBoard::Pins() {
 	return pins_;
 }
 
+PinColumns &BRDBoard::PinData() {
+	return pin_columns_;
+}
+
 SharedVector<Net> &BRDBoard::Nets() {
 	return nets_;
 }
@@ -13,13 +13,12 @@ class BRDBoard : public Board {
 	BRDBoard(const BRDFileBase *const boardFile);
 	~BRDBoard();
 
-	const BRDFileBase *m_file;
-
 	EBoardType BoardType();
 
 	SharedVector<Net> &Nets();
 	SharedVector<Component> &Components();
 	SharedVector<Pin> &Pins();
+	PinColumns &PinData();
 	SharedVector<Point> &OutlinePoints();
 	std::vector<std::pair<Point, Point>> &OutlineSegments();
 
@@ -30,6 +29,7 @@ class BRDBoard : public Board {
 	SharedVector<Net> nets_;
 	SharedVector<Component> components_;
 	SharedVector<Pin> pins_;
+	PinColumns pin_columns_;
 	SharedVector<Point> outline_points_;
 	std::vector<std::pair<Point, Point>> outline_segments_;
 };
@@ -1,5 +1,13 @@
 #include "Board.h"
 
+#include "vectorhulls.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
 std::vector<const std::string *> Component::searchableStringDetails() const {
 	return {&mfgcode};
 }
@@ -14,3 +22,418 @@ std::vector<const std::string *> Net::searchableStringDetails() const {
 	}
 	return result;
 }
+
+/*
+ * Outline, hull and pin sizes of the part, from the positions of its pins.
+ * Parts without pins are left without an outline.
+ */
+void Component::ComputeOutline(float pin_diameter) {
+	int pincount = 0;
+	double min_x, min_y, max_x, max_y, aspect;
+	double angle;
+	double distance = 0;
+	std::vector<ImVec2> pva;
+	std::array<ImVec2, 4> dbox; // default box, if there's nothing else claiming to render the part different.
+	char p0, p1; // first two characters of the part name, code-writing
+	             // convenience more than anything else
+
+	if (pins.size() == 0) return;
+
+	// scale box around pins as a fallback, else either use polygon or convex
+	// hull for better shape fidelity
+	min_x = pins[0]->position().x;
+	min_y = pins[0]->position().y;
+	max_x = min_x;
+	max_y = min_y;
+
+	pva.reserve(pins.size());
+	for (auto &pin : pins) {
+		pincount++;
+
+		pva.push_back({pin->position().x, pin->position().y});
+
+		if (pin->position().x > max_x) {
+			max_x = pin->position().x;
+
+		} else if (pin->position().x < min_x) {
+			min_x = pin->position().x;
+		}
+		if (pin->position().y > max_y) {
+			max_y = pin->position().y;
+
+		} else if (pin->position().y < min_y) {
+			min_y = pin->position().y;
+		}
+	}
+
+	omin        = ImVec2(min_x, min_y);
+	omax        = ImVec2(max_x, max_y);
+	centerpoint = ImVec2((max_x - min_x) / 2 + min_x, (max_y - min_y) / 2 + min_y);
+
+	distance = sqrt((max_x - min_x) * (max_x - min_x) + (max_y - min_y) * (max_y - min_y));
+
+	float pin_radius = pin_diameter / 2.0f;
+
+	/*
+	 *
+	 * Determine the size of our part's pin radius based on the distance
+	 * between the extremes of the pin coordinates.
+	 *
+	 * All the figures below are determined empirically rather than any
+	 * specific formula.
+	 *
+	 */
+	if ((pincount < 4) && (name[0] != 'U') && (name[0] != 'Q')) {
+		bool sized = true;
+
+		if ((distance > 52) && (distance < 57)) {
+			// 0603
+			pin_radius = 15;
+		} else if ((distance > 247) && (distance < 253)) {
+			// SMC diode?
+			pin_radius = 50;
+		} else if ((distance > 195) && (distance < 199)) {
+			// Inductor?
+			pin_radius = 50;
+		} else if ((distance > 165) && (distance < 169)) {
+			// SMB diode?
+			pin_radius = 35;
+		} else if ((distance > 101) && (distance < 109)) {
+			// SMA diode / tant cap
+			pin_radius = 30;
+		} else if ((distance > 108) && (distance < 112)) {
+			// 1206
+			pin_radius = 30;
+		} else if ((distance > 64) && (distance < 68)) {
+			// 0805
+			pin_radius = 25;
+		} else if ((distance > 18) && (distance < 22)) {
+			// 0201 cap/resistor?
+			pin_radius = 5;
+		} else if ((distance > 28) && (distance < 32)) {
+			// 0402 cap/resistor
+			pin_radius = 10;
+		} else {
+			sized = false;
+		}
+
+		if (sized) {
+			for (auto &pin : pins) {
+				pin->diameter() = pin_radius; // * 0.05;
+			}
+		}
+	}
+
+	min_x -= pin_radius;
+	max_x += pin_radius;
+	min_y -= pin_radius;
+	max_y += pin_radius;
+
+	if ((max_y - min_y) < 0.01)
+		aspect = 0;
+	else
+		aspect = (max_x - min_x) / (max_y - min_y);
+
+	dbox[0].x = dbox[3].x = min_x;
+	dbox[1].x = dbox[2].x = max_x;
+	dbox[0].y = dbox[1].y = min_y;
+	dbox[3].y = dbox[2].y = max_y;
+
+	p0 = name[0];
+	p1 = name[1];
+
+	/*
+	 * Draw all 2~3 pin devices as if they're not orthagonal.  It's a bit more
+	 * CPU
+	 * overhead but it keeps the code simpler and saves us replicating things.
+	 */
+
+	if ((pincount == 3) && (abs(aspect > 0.5)) && ((strchr("DQZ", p0) || (strchr("DQZ", p1)) || strcmp(name.c_str(), "LED")))) {
+
+		outline      = dbox;
+		outline_done = true;
+
+		hull.clear();
+		for (auto &pin : pins) {
+			hull.push_back({pin->position().x, pin->position().y});
+		}
+
+		/*
+		 * handle all other devices not specifically handled above
+		 */
+	} else if ((pincount > 1) && (pincount < 4) && ((strchr("CRLD", p0) || (strchr("CRLD", p1))))) {
+		double dx, dy;
+		double tx, ty;
+		double armx, army;
+
+		dx    = pins[1]->position().x - pins[0]->position().x;
+		dy    = pins[1]->position().y - pins[0]->position().y;
+		angle = atan2(dy, dx);
+
+		if (((p0 == 'L') || (p1 == 'L')) && (distance > 50)) {
+			pin_radius = 15;
+			for (auto &pin : pins) {
+				pin->diameter() = pin_radius; // * 0.05;
+			}
+			army = distance / 2;
+			armx = pin_radius;
+		} else if (((p0 == 'C') || (p1 == 'C')) && (distance > 90)) {
+			double mpx, mpy;
+
+			pin_radius = 15;
+			for (auto &pin : pins) {
+				pin->diameter() = pin_radius; // * 0.05;
+			}
+			army = distance / 2 - distance / 4;
+			armx = pin_radius;
+
+			mpx = dx / 2 + pins[0]->position().x;
+			mpy = dy / 2 + pins[0]->position().y;
+			VHRotateV(&mpx, &mpy, dx / 2 + pins[0]->position().x, dy / 2 + pins[0]->position().y, angle);
+
+			expanse        = distance;
+			centerpoint.x  = mpx;
+			centerpoint.y  = mpy;
+			component_type = kComponentTypeCapacitor;
+
+		} else {
+			armx = army = pin_radius;
+		}
+
+		// TODO: Compact this bit of code, maybe. It works at least.
+		tx = pins[0]->position().x - armx;
+		ty = pins[0]->position().y - army;
+		VHRotateV(&tx, &ty, pins[0]->position().x, pins[0]->position().y, angle);
+		outline[0].x = tx;
+		outline[0].y = ty;
+
+		tx = pins[0]->position().x - armx;
+		ty = pins[0]->position().y + army;
+		VHRotateV(&tx, &ty, pins[0]->position().x, pins[0]->position().y, angle);
+		outline[1].x = tx;
+		outline[1].y = ty;
+
+		tx = pins[1]->position().x + armx;
+		ty = pins[1]->position().y + army;
+		VHRotateV(&tx, &ty, pins[1]->position().x, pins[1]->position().y, angle);
+		outline[2].x = tx;
+		outline[2].y = ty;
+
+		tx = pins[1]->position().x + armx;
+		ty = pins[1]->position().y - army;
+		VHRotateV(&tx, &ty, pins[1]->position().x, pins[1]->position().y, angle);
+		outline[3].x = tx;
+		outline[3].y = ty;
+
+		outline_done = true;
+
+	} else {
+
+		/*
+		 * If we have (typically) a connector with a non uniform pin distribution
+		 * then we can try use the minimal bounding box algorithm
+		 * to give it a more sane outline
+		 */
+		if ((pincount >= 4) && ((strchr("UJL", p0) || strchr("UJL", p1) || (strncmp(name.c_str(), "CN", 2) == 0)))) {
+			// Find our hull
+			std::vector<ImVec2> pins_hull = VHConvexHull(pva);
+
+			// If we had a valid hull, then find the MBB for it
+			if (pins_hull.size() > 0) {
+				hull = pins_hull;
+
+				std::array<ImVec2, 4> bbox = VHMBBCalculate(pins_hull, pin_radius);
+				outline                    = bbox;
+				outline_done               = true;
+			}
+		} else {
+			// if it wasn't at an odd angle, or wasn't large, or wasn't a connector,
+			// just an ordinary
+			// type part, then this is where we'll likely end up
+			outline      = dbox;
+			outline_done = true;
+		}
+	}
+}
+
+namespace {
+
+// Everything ComputeOutline() depends on, positions taken relative to the first pin.
+// Parts with the same footprint get the same geometry, shifted by the offset between their first pins.
+std::string footprint_key(const Component &part) {
+	std::string key;
+	key.reserve(1 + part.pins.size() * 2 * sizeof(float));
+
+	// Outcome of the tests on the name, kept in the same form as in ComputeOutline()
+	char p0 = part.name[0], p1 = part.name[0] ? part.name[1] : 0;
+	key.push_back((p0 == 'U' || p0 == 'Q') | (strchr("DQZ", p0) || strchr("DQZ", p1)) << 1 | (strcmp(part.name.c_str(), "LED") != 0) << 2 |
+	              (strchr("CRLD", p0) || strchr("CRLD", p1)) << 3 | (p0 == 'L' || p1 == 'L') << 4 | (p0 == 'C' || p1 == 'C') << 5 |
+	              (strchr("UJL", p0) || strchr("UJL", p1) || strncmp(part.name.c_str(), "CN", 2) == 0) << 6);
+	const Point &origin = part.pins.empty() ? Point() : part.pins[0]->position();
+	for (auto &pin : part.pins) {
+		float offset[2] = {pin->position().x - origin.x, pin->position().y - origin.y};
+		key.append(reinterpret_cast<const char *>(offset), sizeof(offset));
+	}
+	return key;
+}
+
+// Copies the geometry of from, computed by ComputeOutline(), to part having the same footprint
+void apply_footprint(const Component &from, Component &part) {
+	ImVec2 d(part.pins[0]->position().x - from.pins[0]->position().x, part.pins[0]->position().y - from.pins[0]->position().y);
+	auto shift = [&d](const ImVec2 &v) { return ImVec2(v.x + d.x, v.y + d.y); };
+
+	part.omin        = shift(from.omin);
+	part.omax        = shift(from.omax);
+	part.centerpoint = shift(from.centerpoint);
+	for (size_t i = 0; i < part.outline.size(); i++) part.outline[i] = shift(from.outline[i]);
+	part.hull.resize(from.hull.size());
+	for (size_t i = 0; i < part.hull.size(); i++) part.hull[i] = shift(from.hull[i]);
+	part.outline_done   = from.outline_done;
+	part.expanse        = from.expanse;
+	part.component_type = from.component_type;
+	for (size_t i = 0; i < part.pins.size(); i++) part.pins[i]->diameter() = from.pins[i]->diameter();
+}
+
+// Calls run(i) for every part index, in parallel chunks
+template <class Run>
+void for_parts(size_t count, Run run) {
+	static const size_t parallel_min_parts = 256;
+
+	auto bounds = chunk_bounds(count, parallel_min_parts);
+	run_chunks(bounds.size() - 1, [&](size_t c) {
+		for (size_t i = bounds[c]; i < bounds[c + 1]; i++) run(i);
+	});
+}
+
+} // namespace
+
+void Board::ComputePartGeometry(float pin_diameter, float default_pin_diameter) {
+	static const size_t none = SIZE_MAX;
+
+	/*
+	 * Pins get a known lower size, parts recognised from their pin spread override it
+	 */
+	auto &diameters = PinData().diameter;
+	std::fill(diameters.begin(), diameters.end(), default_pin_diameter);
+
+	// Parts only touch their own pins, so each step runs in parallel across them
+	auto &components = Components();
+	std::vector<std::string> keys(components.size());
+	for_parts(components.size(), [&](size_t i) {
+		if (!components[i]->is_dummy() && !components[i]->pins.empty()) keys[i] = footprint_key(*components[i]);
+	});
+
+	// The first part of each footprint computes it for the others
+	std::vector<size_t> footprint(components.size(), none); // Part computing the geometry of part i
+	std::vector<size_t> unique;
+	{
+		std::unordered_map<std::string, size_t> first;
+		first.reserve(components.size());
+		for (size_t i = 0; i < components.size(); i++) {
+			if (keys[i].empty()) continue;
+			footprint[i] = first.emplace(std::move(keys[i]), i).first->second;
+			if (footprint[i] == i) unique.push_back(i);
+		}
+	}
+	unique_footprints = unique.size();
+
+	for_parts(unique.size(), [&](size_t u) { components[unique[u]]->ComputeOutline(pin_diameter); });
+	for_parts(components.size(), [&](size_t i) {
+		if (footprint[i] != none && footprint[i] != i) apply_footprint(*components[footprint[i]], *components[i]);
+	});
+}
+
+void Board::IndexGeometry() {
+	const PinColumns &columns = PinData();
+	auto &components          = Components();
+
+	max_pin_diameter = 0.0f;
+	for (float d : columns.diameter) max_pin_diameter = std::max(max_pin_diameter, d);
+
+	parts_without_pins.clear();
+	for (size_t i = 0; i < components.size(); i++) {
+		if (!components[i]->is_dummy() && components[i]->pins.empty()) parts_without_pins.push_back(i);
+	}
+
+	std::vector<SpatialIndex::Box> boxes;
+	for (int side = kBoardSideTop; side <= kBoardSideBottom; side++) {
+		boxes.assign(columns.size(), SpatialIndex::Box::empty());
+		for (size_t i = 0; i < columns.size(); i++) {
+			if (columns.side[i] != side && columns.side[i] != kBoardSideBoth) continue;
+			const Point &p = columns.position[i];
+			boxes[i]       = {p.x, p.y, p.x, p.y};
+		}
+		pin_index_[side].build(boxes);
+
+		// Parts are hit inside their outline, parts without pins have none
+		boxes.assign(components.size(), SpatialIndex::Box::empty());
+		for (size_t i = 0; i < components.size(); i++) {
+			const Component &part = *components[i];
+			if (!part.outline_done || (part.board_side != side && part.board_side != kBoardSideBoth)) continue;
+			SpatialIndex::Box &b = boxes[i];
+			b                    = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+			for (auto &v : part.outline) {
+				b.minx = std::min(b.minx, v.x);
+				b.miny = std::min(b.miny, v.y);
+				b.maxx = std::max(b.maxx, v.x);
+				b.maxy = std::max(b.maxy, v.y);
+			}
+		}
+		part_index_[side].build(boxes);
+	}
+}
+
+void Board::IndexNets() {
+	const PinColumns &columns = PinData();
+	auto &nets                = Nets();
+
+	// Counting sort of the pins by net, pins keep their order within a net
+	net_pin_start_.assign(nets.size() + 1, 0);
+	for (uint32_t net : columns.net) net_pin_start_[net + 1]++;
+	for (size_t i = 1; i < net_pin_start_.size(); i++) net_pin_start_[i] += net_pin_start_[i - 1];
+	net_pins_.resize(columns.size());
+	std::vector<uint32_t> fill(net_pin_start_.begin(), net_pin_start_.end() - 1);
+	for (uint32_t i = 0; i < columns.size(); i++) net_pins_[fill[columns.net[i]]++] = i;
+
+	net_by_name_.clear();
+	net_by_name_.reserve(nets.size());
+	for (auto &net : nets) net_by_name_.emplace(net->name, net->index);
+}
+
+Board::HandleRange Board::NetPins(uint32_t net) const {
+	if (net + 1 >= net_pin_start_.size()) return {nullptr, nullptr};
+	return {net_pins_.data() + net_pin_start_[net], net_pins_.data() + net_pin_start_[net + 1]};
+}
+
+Net *Board::FindNet(const std::string &name) {
+	auto it = net_by_name_.find(name);
+	return it == net_by_name_.end() ? nullptr : Nets()[it->second].get();
+}
+
+// Items of index on side, both indexes merged for kBoardSideBoth
+template <class Query>
+static std::vector<uint32_t> query_side(const SpatialIndex (&index)[2], int side, Query query) {
+	if (side != kBoardSideBoth) return query(index[side]);
+
+	auto top = query(index[kBoardSideTop]), bottom = query(index[kBoardSideBottom]);
+	std::vector<uint32_t> result;
+	result.reserve(top.size() + bottom.size());
+	std::set_union(top.begin(), top.end(), bottom.begin(), bottom.end(), std::back_inserter(result));
+	return result;
+}
+
+std::vector<uint32_t> Board::PinsNear(float x, float y, float radius, int side) const {
+	return query_side(pin_index_, side, [&](const SpatialIndex &index) { return index.queryRadius(x, y, radius); });
+}
+
+std::vector<uint32_t> Board::PartsAt(float x, float y, int side) const {
+	return query_side(part_index_, side, [&](const SpatialIndex &index) { return index.query(x, y); });
+}
+
+std::vector<uint32_t> Board::PinsIn(const SpatialIndex::Box &area, int side) const {
+	return query_side(pin_index_, side, [&](const SpatialIndex &index) { return index.query(area.minx, area.miny, area.maxx, area.maxy); });
+}
+
+std::vector<uint32_t> Board::PartsIn(const SpatialIndex::Box &area, int side) const {
+	return query_side(part_index_, side, [&](const SpatialIndex &index) { return index.query(area.minx, area.miny, area.maxx, area.maxy); });
+}
@@ -1,13 +1,16 @@
 #pragma once
 
 #include "FileFormats/BRDFile.h"
+#include "SpatialIndex.h"
 
 #include "imgui/imgui.h"
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #define EMPTY_STRING ""
@@ -73,9 +76,6 @@ inline void remove(T &element, vector<T> &v) {
 
 // Any element being on the board.
 struct BoardElement {
-	// Side of the board the element is located. (top, bottom, both?)
-	EBoardSide board_side = kBoardSideBoth;
-
 	// String uniquely identifying this element on the board.
 	virtual string UniqueId() const = 0;
 };
@@ -96,8 +96,46 @@ struct Point {
 	    , y(float(_y)){};
 };
 
+// Pins of a board as parallel arrays indexed by the pin handle (Pin::index).
+// Hot loops over all the pins scan these instead of chasing the Pin objects, which are views for everything else.
+struct PinColumns {
+	std::vector<Point> position;
+	std::vector<float> diameter;
+	std::vector<uint8_t> side;       // EBoardSide
+	std::vector<uint8_t> type;       // Pin::EPinType
+	std::vector<uint32_t> net;       // Net::index
+	std::vector<uint32_t> component; // Component::index
+
+	// Vectors the net and component handles index
+	SharedVector<Net> *nets             = nullptr;
+	SharedVector<Component> *components = nullptr;
+
+	size_t size() const {
+		return position.size();
+	}
+
+	void resize(size_t count) {
+		position.resize(count);
+		diameter.resize(count);
+		side.resize(count);
+		type.resize(count);
+		net.resize(count);
+		component.resize(count);
+	}
+
+	void clear() {
+		resize(0);
+	}
+};
+
 // Shared potential between multiple Pins/Contacts.
 struct Net : BoardElement {
+	// Handle of the net, its index in Board::Nets()
+	uint32_t index = 0;
+
+	// Side of the board the element is located. (top, bottom, both?)
+	EBoardSide board_side = kBoardSideBoth;
+
 	int number;
 	string name;
 	bool is_ground;
@@ -122,25 +160,40 @@ struct Pin : BoardElement {
 		kPinTypeTestPad,
 	};
 
-	// Type of Contact, e.g. pin, via, probe/test point.
-	EPinType type;
-
 	// Pin number / Nail count.
 	string number;
 
 	string name; // for BGA pads will be AZ82 etc
 
+	// Handle of the pin, its index in Board::Pins() and in the board PinColumns
+	uint32_t index = 0;
+	PinColumns *columns = nullptr;
+
 	// Position according to board file. (probably in inches)
-	Point position;
+	Point &position() const {
+		return columns->position[index];
+	}
 
 	// Contact diameter, e.g. via or pin size. (probably in inches)
-	float diameter;
+	float &diameter() const {
+		return columns->diameter[index];
+	}
+
+	// Type of Contact, e.g. pin, via, probe/test point.
+	EPinType type() const {
+		return static_cast<EPinType>(columns->type[index]);
+	}
 
-	// Net this contact is connected to, nulltpr if no info available.
-	Net *net;
+	// Side of the board the element is located. (top, bottom, both?)
+	EBoardSide board_side() const {
+		return static_cast<EBoardSide>(columns->side[index]);
+	}
+
+	// Net this contact is connected to.
+	Net *net() const;
 
-	// Contact belonging to this component (pin), nullptr if nail.
-	std::shared_ptr<Component> component;
+	// Component this contact belongs to, the dummy component for test pads.
+	const std::shared_ptr<Component> &component() const;
 
 	string UniqueId() const {
 		return kBoardPinPrefix + number;
@@ -164,6 +217,12 @@ struct Component : BoardElement {
 		kComponentTypeJellyBean
 	};
 
+	// Handle of the component, its index in Board::Components()
+	uint32_t index = 0;
+
+	// Side of the board the element is located. (top, bottom, both?)
+	EBoardSide board_side = kBoardSideBoth;
+
 	// How the part is attached to the board, either SMD, .., through-hole?
 	EMountType mount_type = kMountTypeUnknown;
 
@@ -204,6 +263,9 @@ struct Component : BoardElement {
 		}
 	}
 
+	// Sets outline, hull, centerpoint and the size of the pins, pin_diameter being the size of unrecognised pins
+	void ComputeOutline(float pin_diameter);
+
 	// true if component is not representing a real/physical component.
 	bool is_dummy() {
 		return component_type == kComponentTypeDummy;
@@ -216,6 +278,14 @@ struct Component : BoardElement {
 	std::vector<const std::string *> searchableStringDetails() const;
 };
 
+inline Net *Pin::net() const {
+	return (*columns->nets)[columns->net[index]].get();
+}
+
+inline const std::shared_ptr<Component> &Pin::component() const {
+	return (*columns->components)[columns->component[index]];
+}
+
 class Board {
   public:
 	enum EBoardType { kBoardTypeUnknown = 0, kBoardTypeBRD = 0x01, kBoardTypeBDV = 0x02 };
@@ -225,10 +295,67 @@ class Board {
 	virtual SharedVector<Net> &Nets()                               = 0;
 	virtual SharedVector<Component> &Components()                   = 0;
 	virtual SharedVector<Pin> &Pins()                               = 0;
+	virtual PinColumns &PinData()                                   = 0;
 	virtual SharedVector<Point> &OutlinePoints()                    = 0;
 	virtual std::vector<std::pair<Point, Point>> &OutlineSegments() = 0;
 
 	EBoardType BoardType() {
 		return kBoardTypeUnknown;
 	}
+
+	// Part outlines, hulls and pin sizes, computed once after loading so drawing only reads them.
+	// Pins are reset to default_pin_diameter first.
+	void ComputePartGeometry(float pin_diameter, float default_pin_diameter);
+
+	// Distinct pin layouts among the parts, each computed once by ComputePartGeometry()
+	size_t unique_footprints = 0;
+
+	// Builds the pin and part grids, once the part outlines are computed
+	void IndexGeometry();
+	// Builds the pins of each net and the nets by name
+	void IndexNets();
+
+	// Pin handles, e.g. those of a net, usable in range-based for loops
+	struct HandleRange {
+		const uint32_t *first, *last;
+
+		const uint32_t *begin() const {
+			return first;
+		}
+		const uint32_t *end() const {
+			return last;
+		}
+		size_t size() const {
+			return last - first;
+		}
+	};
+
+	// Handles of the pins on the net of handle net, in board order
+	HandleRange NetPins(uint32_t net) const;
+	// nullptr if there is no net named name
+	Net *FindNet(const std::string &name);
+
+	// Handles of the pins within radius of (x, y) on each axis, sorted. side can be kBoardSideBoth for either side.
+	std::vector<uint32_t> PinsNear(float x, float y, float radius, int side) const;
+	// Handles of the parts whose outline bounding box contains (x, y), sorted
+	std::vector<uint32_t> PartsAt(float x, float y, int side) const;
+	// Handles of the pins / parts with outlines intersecting area, sorted
+	std::vector<uint32_t> PinsIn(const SpatialIndex::Box &area, int side) const;
+	std::vector<uint32_t> PartsIn(const SpatialIndex::Box &area, int side) const;
+
+	// Parts left out of the part grids as they have no pins, thus no outline
+	std::vector<uint32_t> parts_without_pins;
+
+	// Largest pin diameter, the search radius around points where any pin could be hit
+	float max_pin_diameter = 0.0f;
+
+  private:
+	// Per side, items on both sides are in both
+	SpatialIndex pin_index_[2];
+	SpatialIndex part_index_[2];
+
+	// Pins of net n are net_pins_[net_pin_start_[n]] to net_pins_[net_pin_start_[n + 1] - 1]
+	std::vector<uint32_t> net_pin_start_;
+	std::vector<uint32_t> net_pins_;
+	std::unordered_map<std::string, uint32_t> net_by_name_;
 };
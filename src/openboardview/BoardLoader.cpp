@@ -0,0 +1,223 @@
+#include "BoardLoader.h"
+
+#include "BRDBoard.h"
+#include "FileFormats/FormatRegistry.h"
+#include "FileFormats/OBVCacheFile.h"
+#include "MappedFile.h"
+#include "utils.h"
+#include <SDL.h>
+#include <climits>
+#include <utility>
+
+// Defined here where BRDBoard is complete
+BoardLoadResult::~BoardLoadResult() {}
+
+BoardLoader::~BoardLoader() {
+	cancel();
+	if (m_thread.joinable()) m_thread.join();
+	reap(true);
+}
+
+void BoardLoader::start(const filesystem::path &filepath, const Options &options) {
+	reap(false);
+	if (m_thread.joinable()) {
+		cancel();
+		m_cancelled.emplace_back(std::move(m_thread), std::move(m_job));
+	}
+
+	m_job.reset(new Job);
+	m_job->progress.stage = LoadStage::Read;
+	m_job->options        = options;
+	m_job->filepath       = filepath;
+
+	m_thread = std::thread(&BoardLoader::run, m_job.get());
+}
+
+void BoardLoader::cancel() {
+	if (m_job) m_job->progress.cancelled = true;
+}
+
+bool BoardLoader::busy() const {
+	return m_thread.joinable();
+}
+
+bool BoardLoader::finished() const {
+	return m_job && m_job->finished;
+}
+
+bool BoardLoader::cancelled() const {
+	return m_job && m_job->progress.cancelled;
+}
+
+LoadStage BoardLoader::stage() const {
+	return m_job ? m_job->progress.stage.load() : LoadStage::Idle;
+}
+
+const filesystem::path &BoardLoader::filepath() const {
+	static const filesystem::path none;
+	return m_job ? m_job->filepath : none;
+}
+
+std::unique_ptr<BoardLoadResult> BoardLoader::take() {
+	if (m_thread.joinable()) m_thread.join();
+	reap(false);
+	if (!m_job) return nullptr;
+
+	std::unique_ptr<Job> job = std::move(m_job);
+	if (job->progress.cancelled) return nullptr;
+	return std::move(job->result);
+}
+
+void BoardLoader::reap(bool wait) {
+	for (auto it = m_cancelled.begin(); it != m_cancelled.end();) {
+		if (wait || it->second->finished) {
+			it->first.join();
+			it = m_cancelled.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+const char *BoardLoader::stageName(LoadStage stage) {
+	switch (stage) {
+		case LoadStage::Idle: return "Idle";
+		case LoadStage::Read: return "Reading";
+		case LoadStage::Decrypt: return "Decrypting";
+		case LoadStage::Decompress: return "Decompressing";
+		case LoadStage::Parse: return "Parsing";
+		case LoadStage::Model: return "Building board";
+		case LoadStage::Geometry: return "Computing outlines";
+		case LoadStage::Index: return "Indexing";
+		case LoadStage::Done: return "Done";
+	}
+	return "";
+}
+
+float BoardLoader::stageFraction(LoadStage stage) {
+	switch (stage) {
+		case LoadStage::Idle:
+		case LoadStage::Read: return 0.0f;
+		case LoadStage::Decrypt: return 0.05f;
+		case LoadStage::Decompress: return 0.2f;
+		case LoadStage::Parse: return 0.3f;
+		case LoadStage::Model: return 0.7f;
+		case LoadStage::Geometry: return 0.8f;
+		case LoadStage::Index: return 0.9f;
+		case LoadStage::Done: return 1.0f;
+	}
+	return 0.0f;
+}
+
+// Boards without an outline get a rectangle around their pins
+static void generate_outline(BRDFileBase *file) {
+	if (file->outline_segments.size() >= 3 || file->format.size() >= 3) return;
+
+	int minx, maxx, miny, maxy;
+	int margin = 200; // #define or leave this be? Rather arbritary.
+
+	minx = miny = INT_MAX;
+	maxx = maxy = INT_MIN;
+
+	for (auto &a : file->pins) {
+		if (a.pos.x > maxx) maxx = a.pos.x;
+		if (a.pos.y > maxy) maxy = a.pos.y;
+		if (a.pos.x < minx) minx = a.pos.x;
+		if (a.pos.y < miny) miny = a.pos.y;
+	}
+
+	maxx += margin;
+	maxy += margin;
+	minx -= margin;
+	miny -= margin;
+
+	file->format.push_back({minx, miny});
+	file->format.push_back({maxx, miny});
+	file->format.push_back({maxx, maxy});
+	file->format.push_back({minx, maxy});
+	file->format.push_back({minx, miny});
+}
+
+void BoardLoader::run(Job *job) {
+	std::unique_ptr<BoardLoadResult> result(new BoardLoadResult);
+	result->filepath = job->filepath;
+	auto &filepath   = job->filepath;
+
+	MappedFile source;
+	source.open(filepath, result->error_msg);
+	BufferSpan buffer = source.span();
+
+	if (!buffer.empty() && !job->progress.cancelled) {
+		job->progress.stage = LoadStage::Parse;
+
+		// Reuse the parsed board from a previous load if the file did not change.
+		// ASC boards are made of several files and are not cached, native boards load as fast as their cache.
+		bool useCache  = job->options.useCache && !check_fileext(filepath, ".bom") && !check_fileext(filepath, ".asc") &&
+		                !check_fileext(filepath, ".obv");
+		bool fromCache = false;
+		filesystem::path cachepath;
+		OBVCacheKey cachekey;
+		BRDFileBase *file = nullptr;
+		if (useCache) {
+			cachepath = OBVCacheFile::cachePath(job->options.cacheDir, filepath);
+			cachekey  = OBVCacheFile::key(filepath, buffer);
+			file      = new OBVCacheFile(cachepath, cachekey, buffer);
+			fromCache = file->valid;
+			if (!fromCache) {
+				delete file;
+				file = nullptr;
+				// Hash now, parsers modify the buffer in place
+				if (!cachekey.content_hash) cachekey.content_hash = OBVCacheFile::hash(buffer.data(), buffer.size());
+			}
+		}
+
+		if (fromCache) {
+			SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Loaded %s from cache %s", filepath.string().c_str(), cachepath.string().c_str());
+		} else {
+			auto scores              = FormatRegistry::detect(buffer, filepath);
+			const FileFormat *format = FormatRegistry::best(scores);
+			if (format) {
+				SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Detected %s format for %s", format->name, filepath.string().c_str());
+				FormatContext context = {filepath, job->options.fzKey.data(), &job->progress};
+				file                  = format->create(buffer, context);
+			} else {
+				result->error_msg = "Unrecognized file format.";
+			}
+		}
+		result->file.reset(file);
+
+		// The parsed strings point into the mapped file
+		if (file && !fromCache) file->AttachSource(std::move(source));
+
+		if (file && file->valid && useCache && !fromCache && !job->progress.cancelled) {
+			std::string cache_error;
+			OBVCacheFile::write(*file, cachepath, cachekey, cache_error);
+		}
+
+		if (file && file->valid && !job->progress.cancelled && !job->options.parseOnly) {
+			job->progress.stage = LoadStage::Model;
+			generate_outline(file);
+			result->board.reset(new BRDBoard(file));
+
+			// Compact: the model owns its strings, the parser buffers and arrays are not needed anymore
+			if (!job->options.keepFile) result->file.reset();
+		}
+
+		if (result->board && !job->progress.cancelled) {
+			job->progress.stage = LoadStage::Geometry;
+			result->board->ComputePartGeometry(job->options.pinDiameter, 7.0f);
+		}
+
+		if (result->board && !job->progress.cancelled) {
+			job->progress.stage = LoadStage::Index;
+			result->board->IndexGeometry();
+			result->board->IndexNets();
+			for (auto &n : result->board->Nets()) result->netnames.push_back(n->name);
+			for (auto &p : result->board->Components()) result->partnames.push_back(p->name);
+		}
+	}
+
+	job->result         = std::move(result);
+	job->progress.stage = LoadStage::Done;
+	job->finished       = true;
+}
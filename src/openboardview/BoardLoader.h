@@ -0,0 +1,83 @@
+#pragma once
+
+#include "FileFormats/BRDFileBase.h"
+#include "filesystem_impl.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class BRDBoard;
+
+// Everything a board load produces, handed over to the UI thread in one piece
+struct BoardLoadResult {
+	filesystem::path filepath;
+	std::unique_ptr<BRDFileBase> file; // Freed once the board is built, unless Options::keepFile
+	std::unique_ptr<BRDBoard> board;   // Only set if file is valid, unless Options::parseOnly
+	std::vector<std::string> netnames;
+	std::vector<std::string> partnames;
+	std::string error_msg;
+
+	~BoardLoadResult();
+};
+
+/*
+ * Reads, decodes and parses a board file then builds its model on a worker thread,
+ * so the UI keeps drawing the current board meanwhile.
+ * The UI polls finished() every frame and takes the result once the worker is done.
+ */
+class BoardLoader {
+  public:
+	struct Options {
+		bool useCache   = true;
+		bool keepFile   = false; // For callers needing the parsed arrays, the board owns copies of all it shows
+		bool parseOnly  = false; // Stops once the file is parsed, without building the board, for callers needing only the file
+		int pinDiameter = 20;    // Pin size assumed around the parts outlines, see BoardView::m_pinDiameter
+		filesystem::path cacheDir;
+		std::array<uint32_t, 44> fzKey{};
+	};
+
+	~BoardLoader();
+
+	// Starts loading filepath, cancelling the load in progress if any without waiting for it
+	void start(const filesystem::path &filepath, const Options &options);
+	// The worker stops at the next stage boundary and its result is discarded
+	void cancel();
+
+	// A load was started and its result was not taken yet
+	bool busy() const;
+	bool finished() const;
+	bool cancelled() const;
+	LoadStage stage() const;
+	const filesystem::path &filepath() const;
+
+	// Joins the worker and returns its result, nullptr if the load was cancelled
+	std::unique_ptr<BoardLoadResult> take();
+
+	static const char *stageName(LoadStage stage);
+	// Fraction of the load done when stage starts, for progress bars
+	static float stageFraction(LoadStage stage);
+
+  private:
+	// What a worker reads and writes, owned by the loader until the worker is joined
+	struct Job {
+		LoadProgress progress;
+		std::atomic<bool> finished{false};
+		Options options;
+		filesystem::path filepath;
+		std::unique_ptr<BoardLoadResult> result;
+	};
+
+	static void run(Job *job);
+	// Joins the cancelled workers that are done, or all of them if wait
+	void reap(bool wait);
+
+	std::thread m_thread;
+	std::unique_ptr<Job> m_job;
+	// Parsers cannot be interrupted, cancelled loads run to the end of their stage while the next one starts
+	std::vector<std::pair<std::thread, std::unique_ptr<Job>>> m_cancelled;
+};
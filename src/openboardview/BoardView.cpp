@@ -10,24 +10,14 @@
 #include <climits>
 #include <memory>
 #include <cstdio>
+#include <cstring>
 #ifdef ENABLE_SDL2
 #include <SDL.h>
 #endif
 
 #include "BRDBoard.h"
 #include "Board.h"
-#include "FileFormats/ADFile.h"
-#include "FileFormats/ASCFile.h"
-#include "FileFormats/BDVFile.h"
-#include "FileFormats/BRD2File.h"
-#include "FileFormats/BRDAllegroFile.h"
-#include "FileFormats/BRDFile.h"
-#include "FileFormats/BVRFile.h"
-#include "FileFormats/BVR3File.h"
-#include "FileFormats/CADFile.h"
-#include "FileFormats/CSTFile.h"
-#include "FileFormats/FZFile.h"
-#include "FileFormats/GenCADFile.h"
+#include "FileFormats/OBVFile.h"
 #include "annotations.h"
 #include "imgui/imgui.h"
 #include "imgui/misc/cpp/imgui_stdlib.h"
@@ -54,7 +44,6 @@ BoardView::~BoardView() {
 		m_board->Components().clear();
 		m_board->OutlinePoints().clear();
 		m_board->OutlineSegments().clear();
-		delete m_file;
 		delete m_board;
 		m_annotations.Close();
 		m_validBoard = false;
@@ -301,7 +290,6 @@ int BoardView::ConfigParse(void) {
 	flipMode                  = obvconfig.ParseInt("flipMode", 0);
 
 	boardFill        = obvconfig.ParseBool("boardFill", true);
-	boardFillSpacing = obvconfig.ParseInt("boardFillSpacing", 3);
 
 	zoomFactor   = obvconfig.ParseInt("zoomFactor", 10) / 10.0f;
 	zoomModifier = obvconfig.ParseInt("zoomModifier", 5);
@@ -331,6 +319,7 @@ int BoardView::ConfigParse(void) {
 	 * call this.
 	 */
 	slowCPU |= obvconfig.ParseBool("slowCPU", false);
+	boardCache = obvconfig.ParseBool("boardCache", true);
 	style.AntiAliasedLines = !slowCPU;
 	style.AntiAliasedFill  = !slowCPU;
 
@@ -411,97 +400,167 @@ int BoardView::ConfigParse(void) {
 }
 
 int BoardView::LoadFile(const filesystem::path &filepath) {
-	m_lastFileOpenWasInvalid = true;
-	m_validBoard             = false;
-	if (!filepath.empty()) {
-		// clean up the previous file.
-		if (m_file && m_board) {
-			m_pinHighlighted.clear();
-			m_partHighlighted.clear();
-			m_annotations.Close();
-			m_board->Nets().clear();
-			m_board->Pins().clear();
-			m_board->Components().clear();
-			m_board->OutlinePoints().clear();
-			m_board->OutlineSegments().clear();
-			//	delete m_file;
-			// delete m_board;
-		}
-		delete m_file;
-		m_file = nullptr;
-		m_validBoard = false;
-		m_error_msg.clear();
-		pdfBridge.CloseDocument();
-
-		SetLastFileOpenName(filepath.string());
-		std::vector<char> buffer = file_as_buffer(filepath, m_error_msg);
-		if (!buffer.empty()) {
-			if (check_fileext(filepath, ".fz")) { // Since it is encrypted we cannot use the below logic. Trust the ext.
-				m_file = new FZFile(buffer, FZKey);
-			} else if (check_fileext(filepath, ".bom") || check_fileext(filepath, ".asc"))
-				m_file = new ASCFile(buffer, filepath);
-			else if (GenCADFile::verifyFormat(buffer))
-				m_file = new GenCADFile(buffer);
-			else if (ADFile::verifyFormat(buffer))
-				m_file = new ADFile(buffer);
-			else if (CADFile::verifyFormat(buffer))
-				m_file = new CADFile(buffer);
-			else if (check_fileext(filepath, ".cst"))
-				m_file = new CSTFile(buffer);
-			else if (BRDFile::verifyFormat(buffer))
-				m_file = new BRDFile(buffer);
-			else if (BRD2File::verifyFormat(buffer))
-				m_file = new BRD2File(buffer);
-			else if (BDVFile::verifyFormat(buffer))
-				m_file = new BDVFile(buffer);
-			else if (BVRFile::verifyFormat(buffer))
-				m_file = new BVRFile(buffer);
-			else if (BVR3File::verifyFormat(buffer))
-				m_file = new BVR3File(buffer);
-			else if (BRDAllegroFile::verifyFormat(buffer))
-				m_file = new BRDAllegroFile(buffer);
-			else
-				m_error_msg = "Unrecognized file format.";
-
-			if (m_file && m_file->valid) {
-				LoadBoard(m_file);
-				fhistory.Prepend_save(filepath.string());
-				history_file_has_changed = 1; // used by main to know when to update the window title
-				boardMinMaxDone          = false;
-				m_rotation               = 0;
-				m_current_side           = 0;
-				EPCCheck(); // check to see we don't have a flipped board outline
-
-				m_annotations.SetFilename(filepath.string());
-				m_annotations.Load();
-
-				auto conffilepath = filepath;
-				conffilepath.replace_extension("conf");
-				backgroundImage.loadFromConfig(conffilepath);
-				pdfFile.loadFromConfig(conffilepath);
-
-				pdfBridge.OpenDocument(pdfFile);
+	if (filepath.empty()) return 1;
 
-				/*
-				 * Set pins to a known lower size, they get resized
-				 * in DrawParts() when the component is analysed
-				 */
-				for (auto &p : m_board->Pins()) {
-					//					auto p      = pin.get();
-					p->diameter = 7;
-				}
+	// Parsed on a worker thread, the current board stays usable until FinishLoadFile() swaps the new one in
+	BoardLoader::Options options;
+	options.useCache    = boardCache;
+	options.pinDiameter = m_pinDiameter;
+	options.cacheDir    = filesystem::u8path(get_user_dir(UserDir::Config)) / "cache";
+	std::copy(std::begin(FZKey), std::end(FZKey), options.fzKey.begin());
+	m_loader.start(filepath, options);
 
-				CenterView();
-				m_lastFileOpenWasInvalid = false;
-				m_validBoard             = true;
-				m_error_msg.clear();
-			}
+	return 0;
+}
+
+bool BoardView::IsLoading() const {
+	return m_loader.busy();
+}
+
+void BoardView::FinishLoadFile() {
+	if (!m_loader.finished()) return;
+
+	std::unique_ptr<BoardLoadResult> result = m_loader.take();
+	if (!result) return; // Cancelled, keep the current board
+
+	auto &filepath = result->filepath;
+	SetLastFileOpenName(filepath.string());
+
+	if (!result->board) {
+		// Keep the current board and report the error
+		m_error_msg = result->error_msg;
+		if (result->file && !result->file->error_msg.empty()) {
+			if (!m_error_msg.empty()) m_error_msg += "\n";
+			m_error_msg += result->file->error_msg;
 		}
+		m_lastFileOpenWasInvalid = true;
+		return;
+	}
+
+	// clean up the previous file.
+	if (m_board) {
+		m_pinHighlighted.clear();
+		m_partHighlighted.clear();
+		m_annotations.Close();
+		m_board->Nets().clear();
+		m_board->Pins().clear();
+		m_board->Components().clear();
+		m_board->OutlinePoints().clear();
+		m_board->OutlineSegments().clear();
+	}
+	m_validBoard = false;
+	m_error_msg.clear();
+	pdfBridge.CloseDocument();
+
+	LoadBoard(*result);
+	m_filepath = filepath;
+	fhistory.Prepend_save(filepath.string());
+	history_file_has_changed = 1; // used by main to know when to update the window title
+	m_rotation               = 0;
+	m_current_side           = 0;
+	EPCCheck(); // check to see we don't have a flipped board outline
+	GenerateBoardFill();
+
+	m_annotations.SetFilename(filepath.string());
+	m_annotations.Load();
+	IndexAnnotations();
+
+	auto conffilepath = filepath;
+	conffilepath.replace_extension("conf");
+	backgroundImage.loadFromConfig(conffilepath);
+	pdfFile.loadFromConfig(conffilepath);
+
+	pdfBridge.OpenDocument(pdfFile);
+
+	CenterView();
+	m_lastFileOpenWasInvalid = false;
+	m_validBoard             = true;
+}
+
+// Writes the current board next to its file as .obv, which loads without parsing.
+// The parsed arrays were freed once the board was built, so the file is parsed again on a worker, see FinishSaveNativeFile()
+void BoardView::SaveNativeFile() {
+	if (!m_validBoard) return;
+
+	m_saveNativePath = m_filepath;
+	m_saveNativePath.replace_extension(".obv");
+	m_converter.start(m_filepath, ConvertOptions());
+}
+
+// Writes the file parsed by a loader started with BoardView::ConvertOptions() to output as .obv
+static bool write_native_file(const BoardLoadResult *result, const filesystem::path &output, bool compress, std::string &error_msg) {
+	if (!result || !result->file || !result->file->valid) {
+		error_msg = "Error loading " + (result ? result->filepath.string() : std::string());
+		if (result && !result->error_msg.empty()) error_msg += "\n" + result->error_msg;
+		if (result && result->file && !result->file->error_msg.empty()) error_msg += "\n" + result->file->error_msg;
+		return false;
+	}
+
+	return OBVFile::write(*result->file, output, compress, error_msg);
+}
+
+void BoardView::FinishSaveNativeFile() {
+	if (!m_converter.finished()) return;
+
+	std::unique_ptr<BoardLoadResult> result = m_converter.take();
+	if (!result) return; // Cancelled
+
+	std::string error_msg;
+	if (write_native_file(result.get(), m_saveNativePath, false, error_msg)) {
+		m_saveNativeMsg = "Saved " + m_saveNativePath.string();
 	} else {
-		return 1;
+		m_saveNativeMsg = "Could not save " + m_saveNativePath.string() + ": " + error_msg;
 	}
+	m_showSaveNativeResult = true;
+}
 
-	return 0;
+// Parses with the current FZ key and stops there, a conversion does not need the board
+BoardLoader::Options BoardView::ConvertOptions() const {
+	BoardLoader::Options options;
+	options.useCache  = false;
+	options.parseOnly = true;
+	std::copy(std::begin(FZKey), std::end(FZKey), options.fzKey.begin());
+	return options;
+}
+
+// Parses input and writes it to output as .obv
+bool BoardView::ConvertFile(const filesystem::path &input, const filesystem::path &output, bool compress, std::string &error_msg) {
+	BoardLoader loader;
+	loader.start(input, ConvertOptions());
+	std::unique_ptr<BoardLoadResult> result = loader.take();
+	return write_native_file(result.get(), output, compress, error_msg);
+}
+
+// Small window above the status bar while a board is loading or converted
+void BoardView::ShowLoadProgress() {
+	bool loading    = m_loader.busy() && !m_loader.cancelled();
+	bool converting = m_converter.busy() && !m_converter.cancelled();
+	if (!loading && !converting) return;
+
+	const ImGuiIO &io = ImGui::GetIO();
+
+	ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x / 2, io.DisplaySize.y - m_status_height - DPIF(8.0f)), 0, ImVec2(0.5f, 1.0f));
+	ImGui::SetNextWindowSize(ImVec2(DPIF(400.0f), 0));
+	ImGui::Begin("Loading",
+	             nullptr,
+	             ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse |
+	                 ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing);
+	if (loading) ShowLoaderProgress(m_loader, "Loading");
+	if (converting) ShowLoaderProgress(m_converter, "Saving as native");
+	ImGui::End();
+}
+
+void BoardView::ShowLoaderProgress(BoardLoader &loader, const char *action) {
+	LoadStage stage = loader.stage();
+
+	ImGui::PushID(&loader);
+	ImGui::Text("%s %s", action, loader.filepath().filename().string().c_str());
+	ImGui::ProgressBar(BoardLoader::stageFraction(stage), ImVec2(-DPIF(80.0f), 0), BoardLoader::stageName(stage));
+	ImGui::SameLine();
+	if (ImGui::Button("Cancel", ImVec2(-1, 0))) {
+		loader.cancel();
+	}
+	ImGui::PopID();
 }
 
 void BoardView::SetFZKey(const char *keytext) {
@@ -811,12 +870,6 @@ void BoardView::Preferences(void) {
 
 		ImGui::Separator();
 
-		RA("Board fill spacing", DPI(200));
-		ImGui::SameLine();
-		if (ImGui::InputInt("##boardFillSpacing", &boardFillSpacing)) {
-			obvconfig.WriteInt("boardFillSpacing", boardFillSpacing);
-		}
-
 		t = zoomFactor * 10;
 		RA("Zoom step", DPI(200));
 		ImGui::SameLine();
@@ -871,6 +924,7 @@ void BoardView::Preferences(void) {
 		ImGui::SameLine();
 		if (ImGui::InputInt("##netWebThickness", &netWebThickness)) {
 			obvconfig.WriteInt("netWebThickness", netWebThickness);
+			m_needsRedraw = true;
 		}
 		ImGui::Separator();
 
@@ -879,25 +933,30 @@ void BoardView::Preferences(void) {
 		if (ImGui::InputInt("##pinA1threshold", &pinA1threshold)) {
 			if (pinA1threshold < 1) pinA1threshold = 1;
 			obvconfig.WriteInt("pinA1threshold", pinA1threshold);
+			m_needsRedraw = true;
 		}
 
 		if (ImGui::Checkbox("Pin select masks", &pinSelectMasks)) {
 			obvconfig.WriteBool("pinSelectMasks", pinSelectMasks);
+			m_needsRedraw = true;
 		}
 
 		if (ImGui::Checkbox("Pin Halo", &pinHalo)) {
 			obvconfig.WriteBool("pinHalo", pinHalo);
+			m_needsRedraw = true;
 		}
 		RA("Halo diameter", DPI(200));
 		ImGui::SameLine();
 		if (ImGui::InputFloat("##haloDiameter", &pinHaloDiameter)) {
 			obvconfig.WriteFloat("pinHaloDiameter", pinHaloDiameter);
+			m_needsRedraw = true;
 		}
 
 		RA("Halo thickness", DPI(200));
 		ImGui::SameLine();
 		if (ImGui::InputFloat("##haloThickness", &pinHaloThickness)) {
 			obvconfig.WriteFloat("pinHaloThickness", pinHaloThickness);
+			m_needsRedraw = true;
 		}
 
 		RA("Info Panel Zoom", DPI(200));
@@ -917,12 +976,14 @@ void BoardView::Preferences(void) {
 
 		if (ImGui::Checkbox("Show net web", &showNetWeb)) {
 			obvconfig.WriteBool("showNetWeb", showNetWeb);
+			m_needsRedraw = true;
 		}
 
 		if (ImGui::Checkbox("slowCPU", &slowCPU)) {
 			obvconfig.WriteBool("slowCPU", slowCPU);
 			style.AntiAliasedLines = !slowCPU;
 			style.AntiAliasedFill  = !slowCPU;
+			m_needsRedraw          = true;
 		}
 
 		ImGui::SameLine();
@@ -932,20 +993,24 @@ void BoardView::Preferences(void) {
 
 		if (ImGui::Checkbox("Fill Parts", &fillParts)) {
 			obvconfig.WriteBool("fillParts", fillParts);
+			m_needsRedraw = true;
 		}
 
 		ImGui::SameLine();
 		if (ImGui::Checkbox("Fill Board", &boardFill)) {
 			obvconfig.WriteBool("boardFill", boardFill);
+			m_needsRedraw = true;
 		}
 
 		if (ImGui::Checkbox("Show part name", &showPartName)) {
 			obvconfig.WriteBool("showPartName", showPartName);
+			m_needsRedraw = true;
 		}
 
 		ImGui::SameLine();
 		if (ImGui::Checkbox("Show pin name", &showPinName)) {
 			obvconfig.WriteBool("showPinName", showPinName);
+			m_needsRedraw = true;
 		}
 
 #ifdef _WIN32
@@ -1231,6 +1296,7 @@ void BoardView::ShowInfoPane(void) {
 		ImGui::Columns(2);
 		ImGui::Text("Pins: %zu", m_board->Pins().size());
 		ImGui::Text("Parts: %zu", m_board->Components().size());
+		ImGui::Text("Footprints: %zu", m_board->unique_footprints);
 		ImGui::NextColumn();
 		ImGui::Text("Nets: %zu", m_board->Nets().size());
 		ImGui::TextWrapped("Size: %0.2f x %0.2f\"", m_boardWidth / 1000.0f, m_boardHeight / 1000.0f);
@@ -1274,7 +1340,7 @@ void BoardView::ShowInfoPane(void) {
 
 					SetTarget(part->centerpoint.x, part->centerpoint.y);
 				} else {
-					SetTarget(part->pins[0]->position.x, part->pins[0]->position.y);
+					SetTarget(part->pins[0]->position().x, part->pins[0]->position().y);
 				}
 				m_needsRedraw = 1;
 			}
@@ -1300,7 +1366,7 @@ void BoardView::ShowInfoPane(void) {
 
 						SetTarget(part->centerpoint.x, part->centerpoint.y);
 					} else {
-						SetTarget(part->pins[0]->position.x, part->pins[0]->position.y);
+						SetTarget(part->pins[0]->position().x, part->pins[0]->position().y);
 					}
 					m_needsRedraw = 1;
 				}
@@ -1319,7 +1385,7 @@ void BoardView::ShowInfoPane(void) {
 						to_copy += " " + part->mfgcode;
 					}
 					for (const auto &pin : part->pins) {
-						to_copy += "\n" + pin->name + " " + pin->net->name;
+						to_copy += "\n" + pin->name + " " + pin->net()->name;
 					}
 					ImGui::SetClipboardText(to_copy.c_str());
 				}
@@ -1352,21 +1418,21 @@ void BoardView::ShowInfoPane(void) {
 			if (ImGui::BeginListBox(str.c_str(), listSize)) { //, ImVec2(m_board_surface.x/3 -5, m_board_surface.y/2));
 				for (auto pin : part->pins) {
 					char ss[1024];
-					snprintf(ss, sizeof(ss), "%4s  %s", pin->name.c_str(), pin->net->name.c_str());
+					snprintf(ss, sizeof(ss), "%4s  %s", pin->name.c_str(), pin->net()->name.c_str());
 					if (ImGui::Selectable(ss, (pin == m_pinSelected))) {
 						ClearAllHighlights();
 
-						if ((pin->type == Pin::kPinTypeNotConnected) || (pin->type == Pin::kPinTypeUnkown) || (pin->net->is_ground)) {
-							m_partHighlighted.push_back(pin->component);
+						if ((pin->type() == Pin::kPinTypeNotConnected) || (pin->type() == Pin::kPinTypeUnkown) || (pin->net()->is_ground)) {
+							m_partHighlighted.push_back(pin->component());
 							// do nothing for now
 							//
 						} else {
 							m_pinSelected = pin;
 							for (auto p : m_partHighlighted) {
-								pin->component->visualmode = pin->component->CVMNormal;
+								pin->component()->visualmode = pin->component()->CVMNormal;
 							};
-							m_partHighlighted.push_back(pin->component);
-							CenterZoomNet(pin->net->name);
+							m_partHighlighted.push_back(pin->component());
+							CenterZoomNet(pin->net()->name);
 						}
 						m_needsRedraw = true;
 					}
@@ -1442,9 +1508,9 @@ void BoardView::ContextMenu(void) {
 			min_dist *= min_dist; // all distance squared
 			Pin *selection = nullptr;
 			for (auto &pin : m_board->Pins()) {
-				if (BoardElementIsVisible(pin->component)) {
-					float dx   = pin->position.x - pos.x;
-					float dy   = pin->position.y - pos.y;
+				if (BoardElementIsVisible(pin->component())) {
+					float dx   = pin->position().x - pos.x;
+					float dy   = pin->position().y - pos.y;
 					float dist = dx * dx + dy * dy;
 					if (dist < min_dist) {
 						selection = pin.get();
@@ -1459,8 +1525,8 @@ void BoardView::ContextMenu(void) {
 
 			if (selection != nullptr) {
 				pin   = selection->name;
-				partn = selection->component->name;
-				net   = selection->net->name;
+				partn = selection->component()->name;
+				net   = selection->net()->name;
 			} else {
 
 				/*
@@ -1531,6 +1597,7 @@ void BoardView::ContextMenu(void) {
 							m_annotationedit_retain = false;
 							m_annotations.Update(m_annotations.annotations[m_annotation_clicked_id].id, contextbuf);
 							m_annotations.GenerateList();
+							IndexAnnotations();
 							m_needsRedraw      = true;
 							m_tooltips_enabled = true;
 							// m_parent_occluded = false;
@@ -1594,6 +1661,7 @@ void BoardView::ContextMenu(void) {
 
 						m_annotations.Add(m_current_side, tx, ty, net.c_str(), partn.c_str(), pin.c_str(), contextbufnew);
 						m_annotations.GenerateList();
+						IndexAnnotations();
 						m_needsRedraw = true;
 
 						ImGui::CloseCurrentPopup();
@@ -1613,6 +1681,7 @@ void BoardView::ContextMenu(void) {
 				if ((m_annotation_clicked_id >= 0) && (ImGui::Button("Remove"))) {
 					m_annotations.Remove(m_annotations.annotations[m_annotation_clicked_id].id);
 					m_annotations.GenerateList();
+					IndexAnnotations();
 					m_needsRedraw = true;
 					// m_parent_occluded = false;
 					ImGui::CloseCurrentPopup();
@@ -1682,7 +1751,7 @@ void BoardView::SearchColumnGenerate(const std::string &title,
 
 		if (m_searchComponents) {
 			if (results.first.empty() && (!m_searchNets || results.second.empty())) { // show suggestions only if there is no result at all
-				auto s = scparts.suggest(search);
+				auto s = scparts.suggest(search, limit);
 				if (s.size() > 0) {
 					ImGui::Text("Did you mean...");
 					ShowSearchResults(s, search, limit, &BoardView::FindComponent);
@@ -1693,7 +1762,7 @@ void BoardView::SearchColumnGenerate(const std::string &title,
 
 		if (m_searchNets) {
 			if (results.second.empty() && (!m_searchComponents || results.first.empty())) {
-				auto s = scnets.suggest(search);
+				auto s = scnets.suggest(search, limit);
 				if (s.size() > 0) {
 					ImGui::Text("Did you mean...");
 					ShowSearchResults(s, search, limit, &BoardView::FindNet);
@@ -1901,6 +1970,9 @@ void BoardView::Update() {
 		return;
 	}
 
+	FinishLoadFile();
+	FinishSaveNativeFile();
+
 	/**
 	 * ** FIXME
 	 * This should be handled in the keyboard section, not here
@@ -1949,6 +2021,11 @@ void BoardView::Update() {
 					}
 				}
 			}
+
+			ImGui::Separator();
+			if (ImGui::MenuItem("Save as native", nullptr, false, m_validBoard && !check_fileext(m_filepath, ".obv") && !m_converter.busy())) {
+				SaveNativeFile();
+			}
 			ImGui::Separator();
 
 			if (ImGui::MenuItem("Part/Net Search", keybindings.getKeyNames("Search").c_str())) {
@@ -2163,7 +2240,7 @@ void BoardView::Update() {
 		ImGui::PopItemWidth();
 		*/
 
-		if (m_showContextMenu && m_file && showAnnotations) {
+		if (m_showContextMenu && m_board && showAnnotations) {
 			ImGui::OpenPopup("Annotations");
 		}
 
@@ -2185,7 +2262,7 @@ void BoardView::Update() {
 		keyboardPreferences.render();
 		boardSettings.render();
 
-		if (m_showSearch && m_file) {
+		if (m_showSearch && m_board) {
 			ImGui::OpenPopup("Search for Component / Network");
 		}
 
@@ -2194,9 +2271,6 @@ void BoardView::Update() {
 			if (!m_error_msg.empty()) {
 				ImGui::Text("%s", m_error_msg.c_str());
 			}
-			if (m_file && !m_file->error_msg.empty()) {
-				ImGui::Text("%s", m_file->error_msg.c_str());
-			}
 			if (ImGui::Button("OK")) {
 				ImGui::CloseCurrentPopup();
 			}
@@ -2206,6 +2280,18 @@ void BoardView::Update() {
 			ImGui::OpenPopup("Error opening file");
 			m_lastFileOpenWasInvalid = false;
 		}
+
+		if (ImGui::BeginPopupModal("Save as native")) {
+			ImGui::Text("%s", m_saveNativeMsg.c_str());
+			if (ImGui::Button("OK")) {
+				ImGui::CloseCurrentPopup();
+			}
+			ImGui::EndPopup();
+		}
+		if (m_showSaveNativeResult) {
+			ImGui::OpenPopup("Save as native");
+			m_showSaveNativeResult = false;
+		}
 		ImGui::EndMainMenuBar();
 	}
 
@@ -2244,14 +2330,14 @@ void BoardView::Update() {
 	ImGui::SetNextWindowPos(ImVec2(0, io.DisplaySize.y - m_status_height));
 	ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x, m_status_height));
 	ImGui::Begin("status", nullptr, flags | ImGuiWindowFlags_NoFocusOnAppearing);
-	if (m_file && m_board && m_pinSelected) {
+	if (m_board && m_pinSelected) {
 		auto pin = m_pinSelected;
 		ImGui::Text("Part: %s   Pin: %s   Net: %s   Probe: %d   (%s.)",
-		            pin->component->name.c_str(),
+		            pin->component()->name.c_str(),
 		            pin->name.c_str(),
-		            pin->net->name.c_str(),
-		            pin->net->number,
-		            pin->component->mount_type_str().c_str());
+		            pin->net()->name.c_str(),
+		            pin->net()->number,
+		            pin->component()->mount_type_str().c_str());
 	} else {
 		ImVec2 spos = ImGui::GetMousePos();
 		ImVec2 pos  = ScreenToCoord(spos.x, spos.y);
@@ -2328,6 +2414,8 @@ void BoardView::Update() {
 
 	HandlePDFBridgeSelection();
 
+	ShowLoadProgress();
+
 } // main menu bar
 
 void BoardView::Zoom(float osd_x, float osd_y, float zoom) {
@@ -2387,7 +2475,6 @@ void BoardView::Pan(int direction, int amount) {
 	}
 
 	m_draggingLastFrame = true;
-	m_needsRedraw       = true;
 }
 
 /*
@@ -2396,7 +2483,7 @@ void BoardView::Pan(int direction, int amount) {
  * for menus is handled within the menu generation itself.
  */
 void BoardView::HandleInput() {
-	if (!m_board || (!m_file)) return;
+	if (!m_board) return;
 
 	const ImGuiIO &io = ImGui::GetIO();
 
@@ -2417,14 +2504,13 @@ void BoardView::HandleInput() {
 				m_dx += td.x;
 				m_dy += td.y;
 				m_draggingLastFrame = true;
-				m_needsRedraw       = true;
 			}
 		} else if (m_dragging_token >= 0) {
 			m_dragging_token = 0;
 
 			if (m_lastFileOpenWasInvalid == false) {
 				// Conext menu
-				if (!m_lastFileOpenWasInvalid && m_file && m_board && ImGui::IsMouseClicked(1)) {
+				if (!m_lastFileOpenWasInvalid && m_board && ImGui::IsMouseClicked(1)) {
 					if (showAnnotations) {
 						// Build context menu here, for annotations and inspection
 						//
@@ -2440,11 +2526,11 @@ void BoardView::HandleInput() {
 					}
 
 					// Flip the board with the middle click
-				} else if (!m_lastFileOpenWasInvalid && m_file && m_board && ImGui::IsMouseReleased(2)) {
+				} else if (!m_lastFileOpenWasInvalid && m_board && ImGui::IsMouseReleased(2)) {
 					FlipBoard();
 
 					// Else, click to select pin
-				} else if (!m_lastFileOpenWasInvalid && m_file && m_board && ImGui::IsMouseReleased(0) && !m_draggingLastFrame) {
+				} else if (!m_lastFileOpenWasInvalid && m_board && ImGui::IsMouseReleased(0) && !m_draggingLastFrame) {
 					ImVec2 spos = ImGui::GetMousePos();
 					ImVec2 pos  = ScreenToCoord(spos.x, spos.y);
 
@@ -2455,15 +2541,14 @@ void BoardView::HandleInput() {
 					float min_dist = m_pinDiameter / 2.0f;
 					min_dist *= min_dist; // all distance squared
 					std::shared_ptr<Pin> selection = nullptr;
-					for (auto &pin : m_board->Pins()) {
-						if (BoardElementIsVisible(pin)) {
-							float dx   = pin->position.x - pos.x;
-							float dy   = pin->position.y - pos.y;
-							float dist = dx * dx + dy * dy;
-							if ((dist < (pin->diameter * pin->diameter)) && (dist < min_dist)) {
-								selection = pin;
-								min_dist  = dist;
-							}
+					const PinColumns &columns      = m_board->PinData();
+					for (uint32_t i : m_board->PinsNear(pos.x, pos.y, m_pinDiameter / 2.0f, m_current_side)) {
+						float dx   = columns.position[i].x - pos.x;
+						float dy   = columns.position[i].y - pos.y;
+						float dist = dx * dx + dy * dy;
+						if ((dist < (columns.diameter[i] * columns.diameter[i])) && (dist < min_dist)) {
+							selection = m_board->Pins()[i];
+							min_dist  = dist;
 						}
 					}
 
@@ -2473,22 +2558,22 @@ void BoardView::HandleInput() {
 							for (auto p : m_board->Components()) {
 								p->visualmode = p->CVMNormal;
 							}
-							m_partHighlighted.resize(0);
-							m_pinHighlighted.resize(0);
+							m_partHighlighted.clear();
+							m_pinHighlighted.clear();
 						}
-						m_pinSelected->component->visualmode = m_pinSelected->component->CVMSelected;
-						m_partHighlighted.push_back(m_pinSelected->component);
+						m_pinSelected->component()->visualmode = m_pinSelected->component()->CVMSelected;
+						m_partHighlighted.push_back(m_pinSelected->component());
 					}
 
 					if (m_pinSelected == nullptr) {
 						bool any_hits = false;
 
-						for (auto &part : m_board->Components()) {
-							int hit = 0;
+						// Visible parts whose outline box holds the point, in board order
+						for (uint32_t c : m_board->PartsAt(pos.x, pos.y, m_current_side)) {
+							auto &part = m_board->Components()[c];
+							int hit    = 0;
 							//							auto p_part = part.get();
 
-							if (!BoardElementIsVisible(part)) continue;
-
 							// Work out if the point is inside the hull
 							{
 								auto poly = part->outline;
@@ -2504,7 +2589,7 @@ void BoardView::HandleInput() {
 							if (hit) {
 								any_hits = true;
 
-								bool partInList = contains(part, m_partHighlighted);
+								bool partInList = m_partHighlighted.contains(part);
 
 								/*
 								 * If the CTRL key isn't held down, then we have to
@@ -2515,7 +2600,7 @@ void BoardView::HandleInput() {
 										m_partHighlighted.push_back(part);
 										part->visualmode = part->CVMSelected;
 									} else {
-										remove(part, m_partHighlighted);
+										m_partHighlighted.remove(part);
 										part->visualmode = part->CVMNormal;
 									}
 
@@ -2523,8 +2608,8 @@ void BoardView::HandleInput() {
 									for (auto p : m_board->Components()) {
 										p->visualmode = p->CVMNormal;
 									}
-									m_partHighlighted.resize(0);
-									m_pinHighlighted.resize(0);
+									m_partHighlighted.clear();
+									m_pinHighlighted.clear();
 									if (!partInList) {
 										m_partHighlighted.push_back(part);
 										part->visualmode = part->CVMSelected;
@@ -2567,15 +2652,7 @@ void BoardView::HandleInput() {
 					} // if a pin wasn't selected
 
 				} else {
-					if (!m_showContextMenu) {
-						if (AnnotationIsHovered()) {
-							m_needsRedraw        = true;
-							AnnotationWasHovered = true;
-						} else {
-							AnnotationWasHovered = false;
-							m_needsRedraw        = true;
-						}
-					}
+					if (!m_showContextMenu) AnnotationWasHovered = AnnotationIsHovered();
 				}
 
 				m_draggingLastFrame = false;
@@ -2717,19 +2794,21 @@ void BoardView::CenterZoomNet(string netname) {
 	min.x = min.y = FLT_MAX;
 	max.x = max.y = FLT_MIN;
 
-	for (auto &pin : m_board->Pins()) {
-		if (pin->net->name == netname) {
-			auto p = pin->position;
-			if (p.x < min.x) min.x = p.x;
-			if (p.y < min.y) min.y = p.y;
-			if (p.x > max.x) max.x = p.x;
-			if (p.y > max.y) max.y = p.y;
+	Net *net = m_board->FindNet(netname);
+	if (!net) return;
 
-			if ((infoPanelSelectPartsOnNet) && (pin->type != Pin::kPinTypeTestPad)) {
-				if (!contains(pin->component, m_partHighlighted)) {
-					pin->component->visualmode = pin->component->CVMSelected;
-					m_partHighlighted.push_back(pin->component);
-				}
+	for (uint32_t i : m_board->NetPins(net->index)) {
+		auto &pin = m_board->Pins()[i];
+		auto p    = pin->position();
+		if (p.x < min.x) min.x = p.x;
+		if (p.y < min.y) min.y = p.y;
+		if (p.x > max.x) max.x = p.x;
+		if (p.y > max.y) max.y = p.y;
+
+		if ((infoPanelSelectPartsOnNet) && (pin->type() != Pin::kPinTypeTestPad)) {
+			if (!m_partHighlighted.contains(pin->component())) {
+				pin->component()->visualmode = pin->component()->CVMSelected;
+				m_partHighlighted.push_back(pin->component());
 			}
 		}
 	}
@@ -2781,7 +2860,7 @@ void BoardView::CenterZoomSearchResults(void) {
 	max.x = max.y = FLT_MIN;
 
 	for (auto &pp : m_pinHighlighted) {
-		auto &p = pp->position;
+		auto &p = pp->position();
 		if (p.x < min.x) min.x = p.x;
 		if (p.y < min.y) min.y = p.y;
 		if (p.x > max.x) max.x = p.x;
@@ -2791,7 +2870,7 @@ void BoardView::CenterZoomSearchResults(void) {
 
 	for (auto &pp : m_partHighlighted) {
 		for (auto &pn : pp->pins) {
-			auto &p = pn->position;
+			auto &p = pn->position();
 			if (p.x < min.x) min.x = p.x;
 			if (p.y < min.y) min.y = p.y;
 			if (p.x > max.x) max.x = p.x;
@@ -2879,19 +2958,19 @@ int BoardView::EPCCheck(void) {
 				}
 
 				// test to see if this segment makes the scan-cut.
-				if ((pa.y > pb.y && p->position.y < pa.y && p->position.y > pb.y) ||
-				    (pa.y < pb.y && p->position.y > pa.y && p->position.y < pb.y)) {
+				if ((pa.y > pb.y && p->position().y < pa.y && p->position().y > pb.y) ||
+				    (pa.y < pb.y && p->position().y > pa.y && p->position().y < pb.y)) {
 					ImVec2 intersect;
 
-					intersect.y = p->position.y;
+					intersect.y = p->position().y;
 					if (pa.x == pb.x)
 						intersect.x = pa.x;
 					else
-						intersect.x = (pb.x - pa.x) / (pb.y - pa.y) * (p->position.y - pa.y) + pa.x;
+						intersect.x = (pb.x - pa.x) / (pb.y - pa.y) * (p->position().y - pa.y) + pa.x;
 
-					if (intersect.x > p->position.x)
+					if (intersect.x > p->position().x)
 						r++;
-					else if (intersect.x < p->position.x)
+					else if (intersect.x < p->position().x)
 						l++;
 				}
 			} // if we did get an intersection
@@ -2915,168 +2994,64 @@ int BoardView::EPCCheck(void) {
 }
 
 /*
- * Experimenting to see how much CPU hit rescanning and
- * drawing the flood fill is (as pin-stripe) each time
- * as opposed to precalculated line list
- *
- * We also do this slightly differently, we ask for a
- * y-pixel delta and thickness of line
- *
+ * The board shape is filled where horizontal scanlines would cross an odd number of outline segments.
+ * The outline is cut in triangles once, so drawing it costs the same at any zoom.
  */
-void BoardView::OutlineGenFillDraw(ImDrawList *draw, int ydelta, double thickness = 1.0f) {
-
-	auto io = ImGui::GetIO();
-	vector<ImVec2> scanhits;
-	static ImVec2 min, max; // board min/max points
-	                        //	double steps = 500;
-	double vdelta;
-	double y, ystart, yend;
+void BoardView::GenerateBoardFill(void) {
+	std::vector<std::pair<ImVec2, ImVec2>> segments;
 
-	if (!boardFill || slowCPU) return;
-	if (!m_file) return;
+	int jump = 1;
+	Point fp;
 
-	scanhits.reserve(20);
+	auto &outline_points = m_board->OutlinePoints();
 
-	draw->ChannelsSetCurrent(kChannelFill);
+	// set our initial draw point, so we can detect when we encounter it again
+	if (!outline_points.empty()) {
+		fp = *outline_points[0];
+
+		for (size_t i = 0; i < outline_points.size() - 1; i++) {
+			Point &pa = *outline_points[i];
+			Point &pb = *outline_points[i + 1];
+
+			// jump double/dud points
+			if (pa.x == pb.x && pa.y == pb.y) continue;
+
+			// if we encounter our hull/poly start point, then we've now created the
+			// closed
+			// hull, jump the next segment and reset the first-point
+			if ((!jump) && (fp.x == pb.x) && (fp.y == pb.y)) {
+				if (i < outline_points.size() - 2) {
+					fp   = *outline_points[i + 2];
+					jump = 1;
+					i++;
+				}
+			} else {
+				jump = 0;
+			}
 
-	// find the orthagonal bounding box
-	// probably can put this as a predefined
-	if (!boardMinMaxDone) {
-		min.x = min.y = 100000000000;
-		max.x = max.y = -100000000000;
-		for (auto &p : m_board->OutlinePoints()) {
-			if (p->x < min.x) min.x = p->x;
-			if (p->y < min.y) min.y = p->y;
-			if (p->x > max.x) max.x = p->x;
-			if (p->y > max.y) max.y = p->y;
-		}
-		for (auto &s: m_board->OutlineSegments()) {
-			if (s.first.x < min.x) min.x = s.first.x;
-			if (s.second.x < min.x) min.x = s.second.x;
-			if (s.first.y < min.y) min.y = s.first.y;
-			if (s.second.y < min.y) min.y = s.second.y;
-			if (s.first.x > max.x) max.x = s.first.x;
-			if (s.second.x > max.x) max.x = s.second.x;
-			if (s.first.y > max.y) max.y = s.first.y;
-			if (s.second.y > max.y) max.y = s.second.y;
+			segments.push_back({ImVec2(pa.x, pa.y), ImVec2(pb.x, pb.y)});
 		}
-		boardMinMaxDone = true;
 	}
 
-	// Get the viewport limits, so we don't waste time scanning what we don't need
-	ImVec2 vpa = ScreenToCoord(0, 0);
-	ImVec2 vpb = ScreenToCoord(io.DisplaySize.x, io.DisplaySize.y);
-
-	if (vpa.y > vpb.y) {
-		ystart = vpb.y;
-		yend   = vpa.y;
-	} else {
-		ystart = vpa.y;
-		yend   = vpb.y;
+	for (auto &s : m_board->OutlineSegments()) {
+		segments.push_back({ImVec2(s.first.x, s.first.y), ImVec2(s.second.x, s.second.y)});
 	}
 
-	if (ystart < min.y) ystart = min.y;
-	if (yend > max.y) yend = max.y;
-
-	//	vdelta = (ystart - yend) / steps;
-
-	vdelta = ydelta / m_scale;
-
-	/*
-	 * Go through each scan line
-	 */
-	y = ystart;
-	while (y < yend) {
-
-		scanhits.resize(0);
-		// scan outline segments to see if any intersect with our horizontal scan line
-
-		/*
-		 * While we haven't yet exhausted possible scan hits
-		 */
-
-		{
-
-			int jump = 1;
-			Point fp;
-
-			auto &outline_points = m_board->OutlinePoints();
-
-			// set our initial draw point, so we can detect when we encounter it again
-			if (!outline_points.empty()) {
-				fp = *outline_points[0];
-
-				for (size_t i = 0; i < outline_points.size() - 1; i++) {
-					Point &pa = *outline_points[i];
-					Point &pb = *outline_points[i + 1];
-
-					// jump double/dud points
-					if (pa.x == pb.x && pa.y == pb.y) continue;
-
-					// if we encounter our hull/poly start point, then we've now created the
-					// closed
-					// hull, jump the next segment and reset the first-point
-					if ((!jump) && (fp.x == pb.x) && (fp.y == pb.y)) {
-						if (i < outline_points.size() - 2) {
-							fp   = *outline_points[i + 2];
-							jump = 1;
-							i++;
-						}
-					} else {
-						jump = 0;
-					}
-
-					// test to see if this segment makes the scan-cut.
-					if ((pa.y > pb.y && y < pa.y && y > pb.y) || (pa.y < pb.y && y > pa.y && y < pb.y)) {
-						ImVec2 intersect;
-
-						intersect.y = y;
-						if (pa.x == pb.x)
-							intersect.x = pa.x;
-						else
-							intersect.x = (pb.x - pa.x) / (pb.y - pa.y) * (y - pa.y) + pa.x;
-						scanhits.push_back(intersect);
-					}
-				} // if we did get an intersection
-			}
-
-			for (auto &s: m_board->OutlineSegments()) {
-				auto pa = s.first;
-				auto pb = s.second;
-
-				// jump double/dud segments
-				if (pa.x == pb.x && pa.y == pb.y) continue;
-
-				// test to see if this segment makes the scan-cut.
-				if ((pa.y > pb.y && y < pa.y && y > pb.y) || (pa.y < pb.y && y > pa.y && y < pb.y)) {
-					ImVec2 intersect;
+	m_boardFill = VHFillTriangles(segments);
+}
 
-					intersect.y = y;
-					if (pa.x == pb.x)
-						intersect.x = pa.x;
-					else
-						intersect.x = (pb.x - pa.x) / (pb.y - pa.y) * (y - pa.y) + pa.x;
-					scanhits.push_back(intersect);
-				}
-			}
+void BoardView::DrawBoardFill(ImDrawList *draw) {
+	if (!boardFill) return;
+	if (!m_board) return;
 
-			sort(scanhits.begin(), scanhits.end(), [](ImVec2 const &a, ImVec2 const &b) { return a.x < b.x; });
-			// Some boards contain duplicate outline segments (possibly with points swapped) that generate duplicate intersections
-			// which interferes with the process of generating alterating segments for the scanlines, so remove duplicates.
-			scanhits.erase(std::unique(scanhits.begin(), scanhits.end(), [](const ImVec2 &a, const ImVec2 &b) {return a.x == b.x && a.y == b.y;}), scanhits.end());
+	draw->ChannelsSetCurrent(kChannelFill);
 
-			// now finally generate the lines.
-			{
-				int i = 0;
-				int l = scanhits.size() - 1;
-				for (i = 0; i < l; i += 2) {
-					draw->AddLine(
-					    CoordToScreen(scanhits[i].x, y), CoordToScreen(scanhits[i + 1].x, y), m_colors.boardFillColor, thickness);
-				}
-			}
-		}
-		y += vdelta;
-	} // for each scan line
+	// One reservation per triangle, so that the draw list can start a new command past 16 bit indices
+	ImVec2 uv = ImGui::GetFontTexUvWhitePixel();
+	for (size_t i = 0; i + 2 < m_boardFill.size(); i += 3) {
+		draw->PrimReserve(3, 3);
+		for (size_t j = i; j < i + 3; j++) draw->PrimVtx(CoordToScreen(m_boardFill[j].x, m_boardFill[j].y), uv, m_colors.boardFillColor);
+	}
 }
 
 void BoardView::DrawDiamond(ImDrawList *draw, ImVec2 c, double r, uint32_t color) {
@@ -3190,24 +3165,22 @@ void BoardView::DrawNetWeb(ImDrawList *draw) {
 	 * Some nets we don't bother showing, because they're not relevant or
 	 * produce too many results (such as ground!)
 	 */
-	if (m_pinSelected->type == Pin::kPinTypeNotConnected) return;
-	if (m_pinSelected->type == Pin::kPinTypeUnkown) return;
-	if (m_pinSelected->net->is_ground) return;
-
-	for (auto &p : m_board->Pins()) {
-
-		if (p->net == m_pinSelected->net) {
-			uint32_t col = m_colors.pinNetWebColor;
-			if (!BoardElementIsVisible(p->component)) {
-				col = m_colors.pinNetWebOSColor;
-				draw->AddCircle(CoordToScreen(p->position.x, p->position.y), p->diameter * m_scale, col, 16);
-			}
-
-			draw->AddLine(CoordToScreen(m_pinSelected->position.x, m_pinSelected->position.y),
-			              CoordToScreen(p->position.x, p->position.y),
-			              ImColor(col),
-			              netWebThickness);
+	if (m_pinSelected->type() == Pin::kPinTypeNotConnected) return;
+	if (m_pinSelected->type() == Pin::kPinTypeUnkown) return;
+	if (m_pinSelected->net()->is_ground) return;
+
+	for (uint32_t i : m_board->NetPins(m_pinSelected->net()->index)) {
+		auto &p      = m_board->Pins()[i];
+		uint32_t col = m_colors.pinNetWebColor;
+		if (!BoardElementIsVisible(p->component())) {
+			col = m_colors.pinNetWebOSColor;
+			draw->AddCircle(CoordToScreen(p->position().x, p->position().y), p->diameter() * m_scale, col, 16);
 		}
+
+		draw->AddLine(CoordToScreen(m_pinSelected->position().x, m_pinSelected->position().y),
+		              CoordToScreen(p->position().x, p->position().y),
+		              ImColor(col),
+		              netWebThickness);
 	}
 
 	return;
@@ -3244,8 +3217,19 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 
 	if (m_pinSelected) DrawNetWeb(draw);
 
-	for (auto &pin : m_board->Pins()) {
-		float psz           = pin->diameter * m_scale;
+	// Only the pins of this side around the screen, the Pin itself is looked at once the pin is on screen
+	const PinColumns &columns = m_board->PinData();
+	auto &pins                = m_board->Pins();
+	for (uint32_t i : m_board->PinsIn(VisibleArea(m_drawMargin + m_board->max_pin_diameter * m_scale + 1.0f), m_current_side)) {
+		float psz  = columns.diameter[i] * m_scale;
+		ImVec2 pos = CoordToScreen(columns.position[i].x, columns.position[i].y);
+		{
+			if (!IsVisibleScreen(pos.x, pos.y, psz, io)) continue;
+		}
+
+		if ((!m_pinSelected) && (psz < threshold)) continue;
+
+		auto &pin           = pins[i];
 		uint32_t fill_color = 0xFFFF8888; // fallback fill colour
 		uint32_t text_color = m_colors.pinDefaultTextColor;
 		uint32_t color      = (m_colors.pinDefaultColor & cmask) | omask;
@@ -3253,23 +3237,13 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 		bool show_text      = false;
 		bool draw_ring      = true;
 
-		// continue if pin is not visible anyway
-		if (!BoardElementIsVisible(pin)) continue;
-
-		ImVec2 pos = CoordToScreen(pin->position.x, pin->position.y);
-		{
-			if (!IsVisibleScreen(pos.x, pos.y, psz, io)) continue;
-		}
-
-		if ((!m_pinSelected) && (psz < threshold)) continue;
-
 		// color & text depending on app state & pin type
 
 		{
 			/*
 			 * Pins resulting from a net search
 			 */
-			if (contains(pin, m_pinHighlighted)) {
+			if (m_pinHighlighted.contains(i)) {
 				if (psz < fontSize / 2) psz = fontSize / 2;
 				text_color = m_colors.pinSelectedTextColor;
 				fill_color = m_colors.pinSelectedFillColor;
@@ -3285,7 +3259,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 			/*
 			 * If the part is selected, as part of search or otherwise
 			 */
-			if (PartIsHighlighted(pin->component)) {
+			if (PartIsHighlighted(pin->component())) {
 				color      = m_colors.pinDefaultColor;
 				text_color = m_colors.pinDefaultTextColor;
 				fill_pin   = false;
@@ -3294,7 +3268,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 				threshold  = 0;
 			}
 
-			if (pin->type == Pin::kPinTypeTestPad) {
+			if (pin->type() == Pin::kPinTypeTestPad) {
 				color      = (m_colors.pinTestPadColor & cmask) | omask;
 				fill_color = (m_colors.pinTestPadFillColor & cmask) | omask;
 				show_text  = false;
@@ -3302,7 +3276,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 
 			// If the part itself is highlighted ( CVMShowPins )
 			// if (p_pin->component->visualmode == p_pin->component->CVMSelected) {
-			if (pin->component->visualmode == pin->component->CVMSelected) {
+			if (pin->component()->visualmode == pin->component()->CVMSelected) {
 				color      = m_colors.pinDefaultColor;
 				text_color = m_colors.pinDefaultTextColor;
 				fill_pin   = false;
@@ -3311,14 +3285,14 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 				threshold  = 0;
 			}
 
-			if (!pin->net || pin->type == Pin::kPinTypeNotConnected) {
+			if (!pin->net() || pin->type() == Pin::kPinTypeNotConnected) {
 				color = (m_colors.pinNotConnectedColor & cmask) | omask;
 			} else {
-				if (pin->net->is_ground) color = (m_colors.pinGroundColor & cmask) | omask;
+				if (pin->net()->is_ground) color = (m_colors.pinGroundColor & cmask) | omask;
 			}
 
 			// pin is on the same net as selected pin: highlight > rest
-			if (m_pinSelected && pin->net == m_pinSelected->net) {
+			if (m_pinSelected && pin->net() == m_pinSelected->net()) {
 				if (psz < fontSize / 2) psz = fontSize / 2;
 				color      = m_colors.pinSameNetColor;
 				text_color = m_colors.pinSameNetTextColor;
@@ -3351,7 +3325,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 			}
 
 			if ((pin->number == "1")) {
-				if (pin->component->pins.size() >= static_cast<unsigned int>(pinA1threshold)) { // pinA1threshold is never negative
+				if (pin->component()->pins.size() >= static_cast<unsigned int>(pinA1threshold)) { // pinA1threshold is never negative
 					color = fill_color = m_colors.pinA1PadColor;
 					fill_pin           = m_colors.pinA1PadColor;
 					draw_ring          = false;
@@ -3359,8 +3333,8 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 			}
 
 			// don't show text if it doesn't make sense
-			if (pin->component->pins.size() <= 1) show_text = false;
-			if (pin->type == Pin::kPinTypeTestPad) show_text = false;
+			if (pin->component()->pins.size() <= 1) show_text = false;
+			if (pin->type() == Pin::kPinTypeTestPad) show_text = false;
 		}
 
 		// Drawing
@@ -3382,7 +3356,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 			 */
 			if ((show_text) && (psz < fontSize / 2)) psz = fontSize / 2;
 
-			switch (pin->type) {
+			switch (pin->type()) {
 				case Pin::kPinTypeTestPad:
 					if ((psz > 3) && (!slowCPU)) {
 						draw->AddCircleFilled(ImVec2(pos.x, pos.y), psz, fill_color, segments);
@@ -3419,7 +3393,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 
 			// Show all pin names when showPinName is enabled and pin diameter is above threshold or show pin name only for selected part
 			if ((showPinName && psz > 3) || show_text) {
-				std::string text = pin->name + "\n" + pin->net->name;
+				std::string text = pin->name + "\n" + pin->net()->name;
 				ImFont *font = ImGui::GetIO().Fonts->Fonts[0]; // Default font
 				ImVec2 text_size_normalized = font->CalcTextSizeA(1.0f, FLT_MAX, 0.0f, text.c_str());
 
@@ -3430,7 +3404,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 				// Font size for pin name only depends on height of text (rather than width of full text incl. net name) to scale to pin bounding box
 				ImVec2 size_pin_name = font->CalcTextSizeA(maxfontheight, FLT_MAX, 0.0f, pin->name.c_str());
 				// Font size for net name also depends on width of full text to avoid overflowing too much and colliding with text from other pin
-				ImVec2 size_net_name = font->CalcTextSizeA(maxfontsize, FLT_MAX, 0.0f, pin->net->name.c_str());
+				ImVec2 size_net_name = font->CalcTextSizeA(maxfontsize, FLT_MAX, 0.0f, pin->net()->name.c_str());
 
 				// Show pin name above net name, full text is centered vertically
 				ImVec2 pos_pin_name   = ImVec2(pos.x - size_pin_name.x * 0.5f, pos.y - size_pin_name.y);
@@ -3458,7 +3432,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 
 				draw->ChannelsSetCurrent(kChannelText);
 				draw->AddText(font_pin_name, maxfontheight, pos_pin_name, text_color, pin->name.c_str());
-				draw->AddText(font_net_name, maxfontsize, pos_net_name, text_color, pin->net->name.c_str());
+				draw->AddText(font_net_name, maxfontsize, pos_net_name, text_color, pin->net()->name.c_str());
 				draw->ChannelsSetCurrent(kChannelPins);
 			}
 		}
@@ -3467,12 +3441,7 @@ inline void BoardView::DrawPins(ImDrawList *draw) {
 
 inline void BoardView::DrawParts(ImDrawList *draw) {
 	// float psz = (float)m_pinDiameter * 0.5f * m_scale;
-	double angle;
-	double distance = 0;
 	uint32_t color = m_colors.partOutlineColor;
-	//	int rendered   = 0;
-	char p0, p1; // first two characters of the part name, code-writing
-	             // convenience more than anything else
 
 	draw->ChannelsSetCurrent(kChannelPolylines);
 	/*
@@ -3483,298 +3452,27 @@ inline void BoardView::DrawParts(ImDrawList *draw) {
 		color = (m_colors.partOutlineColor & m_colors.selectedMaskParts) | m_colors.orMaskParts;
 	}
 
-	for (auto &part : m_board->Components()) {
-		int pincount = 0;
-		double min_x, min_y, max_x, max_y, aspect;
-		std::vector<ImVec2> pva;
-		std::array<ImVec2, 4> dbox; // default box, if there's nothing else claiming to render the part different.
+	// Parts of this side around the screen, highlighted ones show their name wherever they are, parts without pins their warning
+	std::vector<uint32_t> visible = m_board->PartsIn(VisibleArea(m_drawMargin + 1.0f), m_current_side);
+	visible.insert(visible.end(), m_board->parts_without_pins.begin(), m_board->parts_without_pins.end());
+	for (auto &part : m_partHighlighted) visible.push_back(part->index);
+	std::sort(visible.begin(), visible.end());
+	visible.erase(std::unique(visible.begin(), visible.end()), visible.end());
 
+	for (uint32_t index : visible) {
+		auto &part = m_board->Components()[index];
 		if (part->is_dummy()) continue;
 
-		/*
-		 *
-		 * When we first load the board, the outline of each part isn't (yet) rendered
-		 * or determined/calculated.  So, the first time we display the board we
-		 * compute the outline and store it for later.
-		 *
-		 * This also sets the pin diameters too.
-		 *
-		 */
-		if (!part->outline_done) { // should only need to do this once for most parts
-			if (part->pins.size() == 0) {
-				if (debug) fprintf(stderr, "WARNING: Drawing empty part %s\n", part->name.c_str());
-				draw->AddRect(CoordToScreen(part->p1.x + DPIF(10), part->p1.y + DPIF(10)),
-				              CoordToScreen(part->p2.x - DPIF(10), part->p2.y - DPIF(10)),
-				              0xff0000ff);
-				draw->AddText(
-				    CoordToScreen(part->p1.x + DPIF(10), part->p1.y - DPIF(50)), m_colors.partTextColor, part->name.c_str());
-				continue;
-			}
-
-			for (auto &pin : part->pins) {
-				pincount++;
-
-				// scale box around pins as a fallback, else either use polygon or convex
-				// hull for better shape fidelity
-				if (pincount == 1) {
-					min_x = pin->position.x;
-					min_y = pin->position.y;
-					max_x = min_x;
-					max_y = min_y;
-				}
-
-				pva.push_back({pin->position.x, pin->position.y});
-
-				if (pin->position.x > max_x) {
-					max_x = pin->position.x;
-
-				} else if (pin->position.x < min_x) {
-					min_x = pin->position.x;
-				}
-				if (pin->position.y > max_y) {
-					max_y = pin->position.y;
-
-				} else if (pin->position.y < min_y) {
-					min_y = pin->position.y;
-				}
-			}
-
-			part->omin        = ImVec2(min_x, min_y);
-			part->omax        = ImVec2(max_x, max_y);
-			part->centerpoint = ImVec2((max_x - min_x) / 2 + min_x, (max_y - min_y) / 2 + min_y);
-
-			distance = sqrt((max_x - min_x) * (max_x - min_x) + (max_y - min_y) * (max_y - min_y));
-
-			float pin_radius = m_pinDiameter / 2.0f;
-
-			/*
-			 *
-			 * Determine the size of our part's pin radius based on the distance
-			 * between the extremes of the pin coordinates.
-			 *
-			 * All the figures below are determined empirically rather than any
-			 * specific formula.
-			 *
-			 */
-			if ((pincount < 4) && (part->name[0] != 'U') && (part->name[0] != 'Q')) {
-
-				if ((distance > 52) && (distance < 57)) {
-					// 0603
-					pin_radius = 15;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 247) && (distance < 253)) {
-					// SMC diode?
-					pin_radius = 50;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 195) && (distance < 199)) {
-					// Inductor?
-					pin_radius = 50;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 165) && (distance < 169)) {
-					// SMB diode?
-					pin_radius = 35;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 101) && (distance < 109)) {
-					// SMA diode / tant cap
-					pin_radius = 30;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 108) && (distance < 112)) {
-					// 1206
-					pin_radius = 30;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 64) && (distance < 68)) {
-					// 0805
-					pin_radius = 25;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-
-				} else if ((distance > 18) && (distance < 22)) {
-					// 0201 cap/resistor?
-					pin_radius = 5;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-				} else if ((distance > 28) && (distance < 32)) {
-					// 0402 cap/resistor
-					pin_radius = 10;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-				}
-			}
-
-			// TODO: pin radius is stored in Pin object
-			//
-			//
-			//
-			min_x -= pin_radius;
-			max_x += pin_radius;
-			min_y -= pin_radius;
-			max_y += pin_radius;
-
-			if ((max_y - min_y) < 0.01)
-				aspect = 0;
-			else
-				aspect = (max_x - min_x) / (max_y - min_y);
-
-			dbox[0].x = dbox[3].x = min_x;
-			dbox[1].x = dbox[2].x = max_x;
-			dbox[0].y = dbox[1].y = min_y;
-			dbox[3].y = dbox[2].y = max_y;
-
-			p0 = part->name[0];
-			p1 = part->name[1];
-
-			/*
-			 * Draw all 2~3 pin devices as if they're not orthagonal.  It's a bit more
-			 * CPU
-			 * overhead but it keeps the code simpler and saves us replicating things.
-			 */
-
-			if ((pincount == 3) && (abs(aspect > 0.5)) &&
-			    ((strchr("DQZ", p0) || (strchr("DQZ", p1)) || strcmp(part->name.c_str(), "LED")))) {
-
-				part->outline = dbox;
-				part->outline_done = true;
-
-				part->hull.clear();
-				for (auto &pin : part->pins) {
-					part->hull.push_back({pin->position.x, pin->position.y});
-				}
-
-				/*
-				 * handle all other devices not specifically handled above
-				 */
-			} else if ((pincount > 1) && (pincount < 4) && ((strchr("CRLD", p0) || (strchr("CRLD", p1))))) {
-				double dx, dy;
-				double tx, ty;
-				double armx, army;
-
-				dx    = part->pins[1]->position.x - part->pins[0]->position.x;
-				dy    = part->pins[1]->position.y - part->pins[0]->position.y;
-				angle = atan2(dy, dx);
-
-				if (((p0 == 'L') || (p1 == 'L')) && (distance > 50)) {
-					pin_radius = 15;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-					army = distance / 2;
-					armx = pin_radius;
-				} else if (((p0 == 'C') || (p1 == 'C')) && (distance > 90)) {
-					double mpx, mpy;
-
-					pin_radius = 15;
-					for (auto &pin : part->pins) {
-						pin->diameter = pin_radius; // * 0.05;
-					}
-					army = distance / 2 - distance / 4;
-					armx = pin_radius;
-
-					mpx = dx / 2 + part->pins[0]->position.x;
-					mpy = dy / 2 + part->pins[0]->position.y;
-					VHRotateV(&mpx, &mpy, dx / 2 + part->pins[0]->position.x, dy / 2 + part->pins[0]->position.y, angle);
-
-					part->expanse        = distance;
-					part->centerpoint.x  = mpx;
-					part->centerpoint.y  = mpy;
-					part->component_type = part->kComponentTypeCapacitor;
-
-				} else {
-					armx = army = pin_radius;
-				}
-
-				// TODO: Compact this bit of code, maybe. It works at least.
-				tx = part->pins[0]->position.x - armx;
-				ty = part->pins[0]->position.y - army;
-				VHRotateV(&tx, &ty, part->pins[0]->position.x, part->pins[0]->position.y, angle);
-				// a = CoordToScreen(tx, ty);
-				part->outline[0].x = tx;
-				part->outline[0].y = ty;
-
-				tx = part->pins[0]->position.x - armx;
-				ty = part->pins[0]->position.y + army;
-				VHRotateV(&tx, &ty, part->pins[0]->position.x, part->pins[0]->position.y, angle);
-				// b = CoordToScreen(tx, ty);
-				part->outline[1].x = tx;
-				part->outline[1].y = ty;
-
-				tx = part->pins[1]->position.x + armx;
-				ty = part->pins[1]->position.y + army;
-				VHRotateV(&tx, &ty, part->pins[1]->position.x, part->pins[1]->position.y, angle);
-				// c = CoordToScreen(tx, ty);
-				part->outline[2].x = tx;
-				part->outline[2].y = ty;
-
-				tx = part->pins[1]->position.x + armx;
-				ty = part->pins[1]->position.y - army;
-				VHRotateV(&tx, &ty, part->pins[1]->position.x, part->pins[1]->position.y, angle);
-				// d = CoordToScreen(tx, ty);
-				part->outline[3].x = tx;
-				part->outline[3].y = ty;
-
-				part->outline_done = true;
-
-				// rendered = 1;
-
-			} else {
-
-				/*
-				 * If we have (typically) a connector with a non uniform pin distribution
-				 * then we can try use the minimal bounding box algorithm
-				 * to give it a more sane outline
-				 */
-				if ((pincount >= 4) && ((strchr("UJL", p0) || strchr("UJL", p1) || (strncmp(part->name.c_str(), "CN", 2) == 0)))) {
-					// Find our hull
-					std::vector<ImVec2> hull = VHConvexHull(pva);
-
-					// If we had a valid hull, then find the MBB for it
-					if (hull.size() > 0) {
-						part->hull = hull;
-
-						std::array<ImVec2, 4> bbox = VHMBBCalculate(hull, pin_radius);
-						part->outline = bbox;
-						part->outline_done = true;
-
-						/*
-						 * Tighten the hull, removes any small angle segments
-						 * such as a sequence of pins in a line, might be an overkill
-						 */
-						// hpc = TightenHull(hull, hpc, 0.1f);
-					}
-				} else {
-					// if it wasn't at an odd angle, or wasn't large, or wasn't a connector,
-					// just an ordinary
-					// type part, then this is where we'll likely end up
-					part->outline = dbox;
-					part->outline_done = true;
-				}
-			}
-
-			//			if (rendered == 0) {
-			//				fprintf(stderr, "Part wasn't rendered (%s)\n", part->name.c_str());
-			//			}
-
-		} // if !outline_done
+		// Outlines are computed while loading, see Board::ComputePartGeometry(). Parts without pins have none.
+		if (part->pins.size() == 0) {
+			if (debug) fprintf(stderr, "WARNING: Drawing empty part %s\n", part->name.c_str());
+			draw->AddRect(CoordToScreen(part->p1.x + DPIF(10), part->p1.y + DPIF(10)),
+			              CoordToScreen(part->p2.x - DPIF(10), part->p2.y - DPIF(10)),
+			              0xff0000ff);
+			draw->AddText(
+			    CoordToScreen(part->p1.x + DPIF(10), part->p1.y - DPIF(50)), m_colors.partTextColor, part->name.c_str());
+			continue;
+		}
 
 		if (!BoardElementIsVisible(part) && !PartIsHighlighted(part)) continue;
 
@@ -3918,23 +3616,24 @@ void BoardView::DrawPartTooltips(ImDrawList *draw) {
 	if (!m_tooltips_enabled) return;
 	if (spos.x > m_board_surface.x) return;
 	/*
-	 * I am loathing that I have to add this, but basically check every pin on the board so we can
-	 * determine if we're hovering over a testpad
+	 * Check the pins around the mouse so we can determine if we're hovering over a testpad
 	 */
-	for (auto &pin : m_board->Pins()) {
+	const PinColumns &columns = m_board->PinData();
+	for (uint32_t i : m_board->PinsNear(pos.x, pos.y, m_board->max_pin_diameter, kBoardSideBoth)) {
 
-		if (pin->type == Pin::kPinTypeTestPad) {
-			float dx   = pin->position.x - pos.x;
-			float dy   = pin->position.y - pos.y;
+		if (columns.type[i] == Pin::kPinTypeTestPad) {
+			float dx   = columns.position[i].x - pos.x;
+			float dy   = columns.position[i].y - pos.y;
 			float dist = dx * dx + dy * dy;
-			if ((dist < (pin->diameter * pin->diameter))) {
-				float pd = pin->diameter * m_scale;
+			if ((dist < (columns.diameter[i] * columns.diameter[i]))) {
+				auto &pin = m_board->Pins()[i];
+				float pd  = pin->diameter() * m_scale;
 
-				draw->AddCircle(CoordToScreen(pin->position.x, pin->position.y), pd, m_colors.pinHaloColor, 32, pinHaloThickness);
+				draw->AddCircle(CoordToScreen(pin->position().x, pin->position().y), pd, m_colors.pinHaloColor, 32, pinHaloThickness);
 				ImGui::PushStyleColor(ImGuiCol_Text, m_colors.annotationPopupTextColor);
 				ImGui::PushStyleColor(ImGuiCol_PopupBg, m_colors.annotationPopupBackgroundColor);
 				ImGui::BeginTooltip();
-				ImGui::Text("TP[%s]%s", pin->name.c_str(), pin->net->name.c_str());
+				ImGui::Text("TP[%s]%s", pin->name.c_str(), pin->net()->name.c_str());
 				ImGui::EndTooltip();
 				ImGui::PopStyleColor(2);
 				break;
@@ -3943,8 +3642,9 @@ void BoardView::DrawPartTooltips(ImDrawList *draw) {
 	}
 
 	currentlyHoveredPart = nullptr;
-	for (auto &part : m_board->Components()) {
-		int hit = 0;
+	for (uint32_t c : m_board->PartsAt(pos.x, pos.y, kBoardSideBoth)) {
+		auto &part = m_board->Components()[c];
+		int hit    = 0;
 		//		auto p_part = part.get();
 
 
@@ -3970,15 +3670,15 @@ void BoardView::DrawPartTooltips(ImDrawList *draw) {
 
 			for (auto &pin : currentlyHoveredPart->pins) {
 				// auto p     = pin;
-				float dx   = pin->position.x - pos.x;
-				float dy   = pin->position.y - pos.y;
+				float dx   = pin->position().x - pos.x;
+				float dy   = pin->position().y - pos.y;
 				float dist = dx * dx + dy * dy;
 
 				if (!BoardElementIsVisible(pin)) {
 					continue;
 				}
 
-				if ((dist < (pin->diameter * pin->diameter)) && (dist < min_dist)) {
+				if ((dist < (pin->diameter() * pin->diameter())) && (dist < min_dist)) {
 					currentlyHoveredPin = pin;
 					//					fprintf(stderr,"Pinhit: %s\n",pin->number.c_str());
 					min_dist = dist;
@@ -4006,8 +3706,8 @@ void BoardView::DrawPartTooltips(ImDrawList *draw) {
 			draw->ChannelsSetCurrent(kChannelAnnotations);
 
 			if (currentlyHoveredPin)
-				draw->AddCircle(CoordToScreen(currentlyHoveredPin->position.x, currentlyHoveredPin->position.y),
-				                currentlyHoveredPin->diameter * m_scale,
+				draw->AddCircle(CoordToScreen(currentlyHoveredPin->position().x, currentlyHoveredPin->position().y),
+				                currentlyHoveredPin->diameter() * m_scale,
 				                m_colors.pinHaloColor,
 				                32,
 				                pinHaloThickness);
@@ -4018,7 +3718,7 @@ void BoardView::DrawPartTooltips(ImDrawList *draw) {
 				ImGui::Text("%s\n[%s]%s",
 				            currentlyHoveredPart->name.c_str(),
 				            (currentlyHoveredPin ? currentlyHoveredPin->name.c_str() : " "),
-				            (currentlyHoveredPin ? currentlyHoveredPin->net->name.c_str() : " "));
+				            (currentlyHoveredPin ? currentlyHoveredPin->net()->name.c_str() : " "));
 			} else {
 				ImGui::Text("%s", currentlyHoveredPart->name.c_str());
 			}
@@ -4038,9 +3738,9 @@ inline void BoardView::DrawPinTooltips(ImDrawList *draw) {
 		ImGui::PushStyleColor(ImGuiCol_PopupBg, m_colors.annotationPopupBackgroundColor);
 		ImGui::BeginTooltip();
 		ImGui::Text("%s[%s]\n%s",
-		            m_pinHighlightedHovered->component->name.c_str(),
+		            m_pinHighlightedHovered->component()->name.c_str(),
 		            m_pinHighlightedHovered->name.c_str(),
-		            m_pinHighlightedHovered->net->name.c_str());
+		            m_pinHighlightedHovered->net()->name.c_str());
 		ImGui::EndTooltip();
 		ImGui::PopStyleColor(2);
 	}
@@ -4105,8 +3805,8 @@ bool BoardView::HighlightedPinIsHovered(void) {
 	 * See if any of the pins listed in the m_pinHighlighted vector are hovered over
 	 */
 	for (auto &p : m_pinHighlighted) {
-		ImVec2 a = ImVec2(p->position.x, p->position.y);
-		double r = p->diameter / 2.0f;
+		ImVec2 a = ImVec2(p->position().x, p->position().y);
+		double r = p->diameter() / 2.0f;
 		if ((mpc.x > a.x - r) && (mpc.x < a.x + r) && (mpc.y > a.y - r) && (mpc.y < a.y + r)) {
 			m_pinHighlightedHovered = p;
 			return true;
@@ -4116,14 +3816,25 @@ bool BoardView::HighlightedPinIsHovered(void) {
 	/*
 	 * See if any of the pins in the same network as the SELECTED pin (single) are hovered
 	 */
-	for (auto &p : m_board->Pins()) {
-		//	auto p   = pin.get();
-		double r = p->diameter / 2.0f * m_scale;
-		if (m_pinSelected && p->net == m_pinSelected->net) {
-			ImVec2 a = ImVec2(p->position.x, p->position.y);
-			if ((mpc.x > a.x - r) && (mpc.x < a.x + r) && (mpc.y > a.y - r) && (mpc.y < a.y + r)) {
-				m_pinHighlightedHovered = p;
-				return true;
+	if (m_pinSelected) {
+		// Pins of the net, or those around the mouse for nets as large as ground
+		static const size_t net_scan_max = 1024;
+		auto net_pins                    = m_board->NetPins(m_pinSelected->net()->index);
+		std::vector<uint32_t> pins;
+		if (net_pins.size() > net_scan_max) {
+			pins = m_board->PinsNear(mpc.x, mpc.y, m_board->max_pin_diameter / 2.0f * m_scale, kBoardSideBoth);
+		} else {
+			pins.assign(net_pins.begin(), net_pins.end());
+		}
+		for (uint32_t i : pins) {
+			auto &p  = m_board->Pins()[i];
+			double r = p->diameter() / 2.0f * m_scale;
+			if (p->net() == m_pinSelected->net()) {
+				ImVec2 a = ImVec2(p->position().x, p->position().y);
+				if ((mpc.x > a.x - r) && (mpc.x < a.x + r) && (mpc.y > a.y - r) && (mpc.y < a.y + r)) {
+					m_pinHighlightedHovered = p;
+					return true;
+				}
 			}
 		}
 	}
@@ -4133,8 +3844,8 @@ bool BoardView::HighlightedPinIsHovered(void) {
 	 */
 	for (auto &part : m_partHighlighted) {
 		for (auto &p : part->pins) {
-			double r = p->diameter / 2.0f * m_scale;
-			ImVec2 a = ImVec2(p->position.x, p->position.y);
+			double r = p->diameter() / 2.0f * m_scale;
+			ImVec2 a = ImVec2(p->position().x, p->position().y);
 			if ((mpc.x > a.x - r) && (mpc.x < a.x + r) && (mpc.y > a.y - r) && (mpc.y < a.y + r)) {
 				m_pinHighlightedHovered = p;
 				return true;
@@ -4145,25 +3856,39 @@ bool BoardView::HighlightedPinIsHovered(void) {
 	return false;
 }
 
+void BoardView::IndexAnnotations(void) {
+	std::vector<SpatialIndex::Box> boxes;
+	boxes.reserve(m_annotations.annotations.size());
+	for (auto &ann : m_annotations.annotations) {
+		boxes.push_back({static_cast<float>(ann.x), static_cast<float>(ann.y), static_cast<float>(ann.x), static_cast<float>(ann.y)});
+	}
+	m_annotationIndex.build(boxes);
+	m_annotationsHovered.clear();
+}
+
 int BoardView::AnnotationIsHovered(void) {
 	ImVec2 mp       = ImGui::GetMousePos();
 	bool is_hovered = false;
-	int i           = 0;
 
 	if (!m_tooltips_enabled) return false;
 	m_annotation_last_hovered = 0;
 
-	for (auto &ann : m_annotations.annotations) {
-		ImVec2 a = CoordToScreen(ann.x, ann.y);
+	for (uint32_t i : m_annotationsHovered) m_annotations.annotations[i].hovered = false;
+	m_annotationsHovered.clear();
+
+	// Boxes are drawn up and right of their point on screen, so look for points in the board area down and left of the mouse
+	ImVec2 c0 = ScreenToCoord(mp.x - (annotationBoxOffset + annotationBoxSize), mp.y + annotationBoxOffset);
+	ImVec2 c1 = ScreenToCoord(mp.x - annotationBoxOffset, mp.y + (annotationBoxOffset + annotationBoxSize));
+	for (uint32_t i : m_annotationIndex.query(std::min(c0.x, c1.x), std::min(c0.y, c1.y), std::max(c0.x, c1.x), std::max(c0.y, c1.y))) {
+		auto &ann = m_annotations.annotations[i];
+		ImVec2 a  = CoordToScreen(ann.x, ann.y);
 		if ((mp.x > a.x + annotationBoxOffset) && (mp.x < a.x + (annotationBoxOffset + annotationBoxSize)) &&
 		    (mp.y < a.y - annotationBoxOffset) && (mp.y > a.y - (annotationBoxOffset + annotationBoxSize))) {
 			ann.hovered               = true;
 			is_hovered                = true;
 			m_annotation_last_hovered = i;
-		} else {
-			ann.hovered = false;
+			m_annotationsHovered.push_back(i);
 		}
-		i++;
 	}
 
 	if (is_hovered == false) m_annotation_clicked_id = -1;
@@ -4179,7 +3904,7 @@ void BoardView::DrawSelectedPins(ImDrawList *draw) {
 	std::vector<ImVec2> pl;
 	if ((m_pinHighlighted.size()) < 3) return;
 	for (auto &p : m_pinHighlighted) {
-		pl.push_back(CoordToScreen(p->position.x, p->position.y));
+		pl.push_back(CoordToScreen(p->position().x, p->position().y));
 	}
 	std::vector<ImVec2> hull = VHConvexHull(pl);
 	if (hull.size() > 3) {
@@ -4187,40 +3912,113 @@ void BoardView::DrawSelectedPins(ImDrawList *draw) {
 	}
 }
 
-void BoardView::DrawBoard() {
-	if (!m_file || !m_board) return;
+void BoardView::DrawBoardGeometry() {
+	if (!m_boardDrawList) m_boardDrawList.reset(new ImDrawList(ImGui::GetDrawListSharedData()));
+	ImDrawList *draw = m_boardDrawList.get();
 
-	ImDrawList *draw = ImGui::GetWindowDrawList();
-	if (!m_needsRedraw) {
-		memcpy(draw, m_cachedDrawList, sizeof(ImDrawList));
-		memcpy(draw->CmdBuffer.Data, m_cachedDrawCommands.Data, m_cachedDrawCommands.Size);
-		return;
-	}
+	// Half a screen on each side, panning further draws again
+	m_drawMargin = std::max(m_board_surface.x, m_board_surface.y) * 0.5f;
+
+	draw->_ResetForNewFrame();
+	draw->PushTextureID(ImGui::GetIO().Fonts->TexID);
+	// Text is clipped as it is drawn, this keeps the names in the margin
+	draw->PushClipRect(ImVec2(-m_drawMargin, -m_drawMargin),
+	                   ImVec2(m_board_surface.x + m_drawMargin, m_menu_height + m_board_surface.y + m_drawMargin));
 
 	// Splitting channels, drawing onto those and merging back.
 	draw->ChannelsSplit(NUM_DRAW_CHANNELS);
 
 	// We draw the Parts before the Pins so that we can ascertain the needed pin
 	// size for the parts based on the part/pad geometry and spacing. -Inflex
-	// OutlineGenerateFill();
-	//	DrawFill(draw);
-	OutlineGenFillDraw(draw, boardFillSpacing, 1);
+	DrawBoardFill(draw);
 	DrawOutline(draw);
 	DrawParts(draw);
-	//	DrawSelectedPins(draw);
 	DrawPins(draw);
+
+	draw->ChannelsMerge();
+
+	m_boardDrawOrigin   = CoordToScreen(0.0f, 0.0f);
+	m_boardDrawSurface  = m_board_surface;
+	m_boardDrawScale    = m_scale;
+	m_boardDrawRotation = m_rotation;
+	m_boardDrawSide     = m_current_side;
+	m_boardDrawState    = DrawState();
+	m_needsRedraw       = false;
+}
+
+bool BoardDrawState::operator==(const BoardDrawState &other) const {
+	// ColorScheme only holds uint32_t colors
+	return !memcmp(&colors, &other.colors, sizeof(colors)) && pinSelected == other.pinSelected &&
+	       pinsHighlighted == other.pinsHighlighted && partsHighlighted == other.partsHighlighted && fontSize == other.fontSize &&
+	       pinSizeThresholdLow == other.pinSizeThresholdLow && pinHaloDiameter == other.pinHaloDiameter &&
+	       pinHaloThickness == other.pinHaloThickness && pinA1threshold == other.pinA1threshold &&
+	       netWebThickness == other.netWebThickness && pinDiameter == other.pinDiameter && pinShapeSquare == other.pinShapeSquare &&
+	       pinShapeCircle == other.pinShapeCircle && pinSelectMasks == other.pinSelectMasks && slowCPU == other.slowCPU &&
+	       showNetWeb == other.showNetWeb && showPins == other.showPins && pinHalo == other.pinHalo && fillParts == other.fillParts &&
+	       boardFill == other.boardFill && showPartName == other.showPartName && showPinName == other.showPinName;
+}
+
+BoardDrawState BoardView::DrawState() const {
+	BoardDrawState state;
+	state.colors              = m_colors;
+	state.pinSelected         = m_pinSelected.get();
+	state.pinsHighlighted     = m_pinHighlighted.generation;
+	state.partsHighlighted    = m_partHighlighted.generation;
+	state.fontSize            = fontSize;
+	state.pinSizeThresholdLow = pinSizeThresholdLow;
+	state.pinHaloDiameter     = pinHaloDiameter;
+	state.pinHaloThickness    = pinHaloThickness;
+	state.pinA1threshold      = pinA1threshold;
+	state.netWebThickness     = netWebThickness;
+	state.pinDiameter         = m_pinDiameter;
+	state.pinShapeSquare      = pinShapeSquare;
+	state.pinShapeCircle      = pinShapeCircle;
+	state.pinSelectMasks      = pinSelectMasks;
+	state.slowCPU             = slowCPU;
+	state.showNetWeb          = showNetWeb;
+	state.showPins            = showPins;
+	state.pinHalo             = pinHalo;
+	state.fillParts           = fillParts;
+	state.boardFill           = boardFill;
+	state.showPartName        = showPartName;
+	state.showPinName         = showPinName;
+	return state;
+}
+
+void BoardView::DrawBoard() {
+	if (!m_board) return;
+
+	ImDrawList *draw = ImGui::GetWindowDrawList();
+
+	// Panning only moves what was drawn, anything else draws the board again
+	ImVec2 origin = CoordToScreen(0.0f, 0.0f);
+	ImVec2 offset(origin.x - m_boardDrawOrigin.x, origin.y - m_boardDrawOrigin.y);
+	if (m_needsRedraw || !m_boardDrawList || m_scale != m_boardDrawScale || m_rotation != m_boardDrawRotation ||
+	    m_current_side != m_boardDrawSide || m_board_surface.x != m_boardDrawSurface.x || m_board_surface.y != m_boardDrawSurface.y ||
+	    fabsf(offset.x) > m_drawMargin || fabsf(offset.y) > m_drawMargin || !(DrawState() == m_boardDrawState)) {
+		DrawBoardGeometry();
+		offset = ImVec2(0.0f, 0.0f);
+	}
+
+	draw->ChannelsSplit(NUM_DRAW_CHANNELS);
+
+	// The board geometry uses the font texture only, it goes in as one primitive
+	const ImDrawList &board = *m_boardDrawList;
+	if (board.IdxBuffer.Size) {
+		draw->ChannelsSetCurrent(kChannelFill);
+		draw->PrimReserve(board.IdxBuffer.Size, board.VtxBuffer.Size);
+		unsigned int base = draw->_VtxCurrentIdx;
+		for (ImDrawIdx idx : board.IdxBuffer) draw->PrimWriteIdx(static_cast<ImDrawIdx>(base + idx));
+		for (const ImDrawVert &v : board.VtxBuffer) draw->PrimWriteVtx(ImVec2(v.pos.x + offset.x, v.pos.y + offset.y), v.uv, v.col);
+	}
+
+	// Tooltips and annotations follow the mouse, they are drawn every frame
+	draw->ChannelsSetCurrent(kChannelPolylines);
 	// DrawPinTooltips(draw);
 	DrawPartTooltips(draw);
 	DrawAnnotations(draw);
 
 	draw->ChannelsMerge();
-
-	// Copy the new draw list and cmd buffer:
-	memcpy(m_cachedDrawList, draw, sizeof(ImDrawList));
-	int cmds_size = draw->CmdBuffer.size() * sizeof(ImDrawCmd);
-	m_cachedDrawCommands.resize(cmds_size);
-	memcpy(m_cachedDrawCommands.Data, draw->CmdBuffer.Data, cmds_size);
-	m_needsRedraw = false;
 }
 /** end of drawing region **/
 
@@ -4254,50 +4052,15 @@ void BoardView::CenterView(void) {
 	m_needsRedraw = true;
 }
 
-void BoardView::LoadBoard(BRDFileBase *file) {
+void BoardView::LoadBoard(BoardLoadResult &result) {
 	delete m_board;
+	m_board = result.board.release();
 
-	// Check board outline (format) point count.
-	//		If we don't have an outline, generate one
-	//
-	if (file->outline_segments.size() < 3 && file->format.size() < 3) {
-		auto pins = file->pins;
-		int minx, maxx, miny, maxy;
-		int margin = 200; // #define or leave this be? Rather arbritary.
-
-		minx = miny = INT_MAX;
-		maxx = maxy = INT_MIN;
-
-		for (auto a : pins) {
-			if (a.pos.x > maxx) maxx = a.pos.x;
-			if (a.pos.y > maxy) maxy = a.pos.y;
-			if (a.pos.x < minx) minx = a.pos.x;
-			if (a.pos.y < miny) miny = a.pos.y;
-		}
-
-		maxx += margin;
-		maxy += margin;
-		minx -= margin;
-		miny -= margin;
-
-		file->format.push_back({minx, miny});
-		file->format.push_back({maxx, miny});
-		file->format.push_back({maxx, maxy});
-		file->format.push_back({minx, maxy});
-		file->format.push_back({minx, miny});
-	}
-
-	m_board = new BRDBoard(file);
 	searcher.setParts(m_board->Components());
 	searcher.setNets(m_board->Nets());
 
-	std::vector<std::string> netnames;
-	for (auto &n : m_board->Nets()) netnames.push_back(n->name);
-	std::vector<std::string> partnames;
-	for (auto &p : m_board->Components()) netnames.push_back(p->name);
-
-	scnets.setDictionary(netnames);
-	scparts.setDictionary(partnames);
+	scnets.setDictionary(result.netnames);
+	scparts.setDictionary(result.partnames);
 
 	m_nets = m_board->Nets();
 
@@ -4335,8 +4098,8 @@ void BoardView::LoadBoard(BRDFileBase *file) {
 	m_boardHeight           = max_y - min_y;
 	SetTarget(m_mx, m_my);
 
-	m_pinHighlighted.reserve(m_board->Components().size());
-	m_partHighlighted.reserve(m_board->Components().size());
+	m_pinHighlighted.Reset(m_board->Pins().size());
+	m_partHighlighted.Reset(m_board->Components().size());
 	m_pinSelected = nullptr;
 
 	m_firstFrame  = true;
@@ -4436,9 +4199,8 @@ void BoardView::Mirror(void) {
 		p->x = max.x - p->x;
 	}
 
-	for (auto &p : m_board->Pins()) {
-		//	auto p        = pin.get();
-		p->position.x = max.x - p->position.x;
+	for (auto &position : m_board->PinData().position) {
+		position.x = max.x - position.x;
 	}
 
 	for (auto &part : m_board->Components()) {
@@ -4459,6 +4221,11 @@ void BoardView::Mirror(void) {
 	for (auto &ann : m_annotations.annotations) {
 		ann.x = max.x - ann.x;
 	}
+
+	// Everything moved, the grids and the fill are made again
+	m_board->IndexGeometry();
+	IndexAnnotations();
+	GenerateBoardFill();
 }
 
 void BoardView::SetTarget(float x, float y) {
@@ -4469,27 +4236,45 @@ void BoardView::SetTarget(float x, float y) {
 	m_dy += coord.y - y;
 }
 
-inline bool BoardView::BoardElementIsVisible(const std::shared_ptr<BoardElement> be) {
+inline bool BoardView::BoardSideIsVisible(EBoardSide side) {
+	if (side == m_current_side) return true;
+
+	if (side == kBoardSideBoth) return true;
+
+	return false;
+}
+
+inline bool BoardView::BoardElementIsVisible(const std::shared_ptr<Component> &be) {
 	if (!be) return true; // no element? => no board side info
 
-	if (be->board_side == m_current_side) return true;
+	return BoardSideIsVisible(be->board_side);
+}
 
-	if (be->board_side == kBoardSideBoth) return true;
+inline bool BoardView::BoardElementIsVisible(const std::shared_ptr<Pin> &be) {
+	if (!be) return true; // no element? => no board side info
 
-	return false;
+	return BoardSideIsVisible(be->board_side());
 }
 
 inline bool BoardView::IsVisibleScreen(float x, float y, float radius, const ImGuiIO &io) {
 	// if (x < -radius || y < -radius || x - radius > io.DisplaySize.x || y - radius > io.DisplaySize.y) return false;
+	radius += m_drawMargin; // The margin drawn for panning counts as visible
 	if (x < -radius || y < -radius || x - radius > m_board_surface.x || y - radius > m_board_surface.y) return false;
 	return true;
 }
 
+SpatialIndex::Box BoardView::VisibleArea(float margin) {
+	// Rotations are quarter turns, opposite corners of the screen stay opposite on the board
+	ImVec2 a = ScreenToCoord(-margin, -margin);
+	ImVec2 b = ScreenToCoord(m_board_surface.x + margin, m_board_surface.y + margin);
+	return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)};
+}
+
 bool BoardView::PartIsHighlighted(const std::shared_ptr<Component> component) {
-	bool highlighted = contains(component, m_partHighlighted);
+	bool highlighted = m_partHighlighted.contains(component);
 
 	// is any pin of this part selected?
-	if (m_pinSelected) highlighted |= m_pinSelected->component == component;
+	if (m_pinSelected) highlighted |= m_pinSelected->component() == component;
 
 	return highlighted;
 }
@@ -4506,7 +4291,7 @@ bool BoardView::AnyItemVisible(void) {
 	if (!any_visible) {
 		if (m_searchNets) {
 			for (auto &p : m_pinHighlighted) {
-				any_visible |= BoardElementIsVisible(p->component);
+				any_visible |= BoardElementIsVisible(p->component());
 			}
 		}
 	}
@@ -4515,13 +4300,14 @@ bool BoardView::AnyItemVisible(void) {
 }
 
 void BoardView::FindNetNoClear(const char *name) {
-	if (!m_file || !m_board || !(*name)) return;
+	if (!m_board || !(*name)) return;
 
 	auto results = searcher.nets(name);
 
 	for (auto &net : results) {
 		for (auto &pin : net->pins) m_pinHighlighted.push_back(pin);
 	}
+	m_needsRedraw = true;
 }
 
 void BoardView::FindNet(const char *name) {
@@ -4530,7 +4316,7 @@ void BoardView::FindNet(const char *name) {
 }
 
 void BoardView::FindComponentNoClear(const char *name) {
-	if (!m_file || !m_board || !name) return;
+	if (!m_board || !name) return;
 
 	auto results = searcher.parts(name);
 
@@ -4545,7 +4331,7 @@ void BoardView::FindComponentNoClear(const char *name) {
 }
 
 void BoardView::FindComponent(const char *name) {
-	if (!m_file || !m_board) return;
+	if (!m_board) return;
 
 	m_pinHighlighted.clear();
 	m_partHighlighted.clear();
@@ -4565,6 +4351,7 @@ void BoardView::SearchCompoundNoClear(const char *item) {
 void BoardView::SearchCompound(const char *item) {
 	m_pinHighlighted.clear();
 	m_partHighlighted.clear();
+	m_needsRedraw = true;
 	//	ClearAllHighlights();
 	if (*item == '\0') return;
 
@@ -4606,6 +4393,7 @@ void BoardView::HandlePDFBridgeSelection() {
 		if (selection.empty()) {
 			m_pinHighlighted.clear();
 			m_partHighlighted.clear();
+			m_needsRedraw = true;
 		} else {
 			SearchCompound(selection.c_str());
 			CenterZoomSearchResults();
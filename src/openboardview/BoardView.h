@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Board.h"
+#include "BoardLoader.h"
 #include "Searcher.h"
 #include "SpellCorrector.h"
 #include "annotations.h"
@@ -25,14 +26,17 @@ struct BRDPart;
 class BRDFile;
 
 struct BitVec {
-	uint32_t *m_bits;
+	uint32_t *m_bits = nullptr;
 	// length of the BitVec in bits
-	uint32_t m_size;
+	uint32_t m_size = 0;
 
+	BitVec() = default;
+	BitVec(const BitVec &) = delete;
+	BitVec &operator=(const BitVec &) = delete;
 	~BitVec();
 	void Resize(uint32_t new_size);
 
-	bool operator[](uint32_t index) {
+	bool operator[](uint32_t index) const {
 		return 0 != (m_bits[index >> 5] & (1u << (index & 0x1f)));
 	}
 
@@ -46,13 +50,76 @@ struct BitVec {
 	}
 
 	void Clear() {
-		uint32_t num_ints = m_size >> 5;
+		uint32_t num_ints = (m_size + 31) >> 5;
 		for (uint32_t i = 0; i < num_ints; i++) {
 			m_bits[i] = 0;
 		}
 	}
 };
 
+/*
+ * Highlighted board elements in the order they were picked, for the info pane,
+ * with a bit per element handle so drawing can tell whether an element is highlighted at once.
+ */
+template <class T>
+struct HighlightList {
+	SharedVector<T> items;
+	BitVec bits;
+	uint32_t generation = 0; // Changes whenever the list does
+
+	// Handles go from 0 to count - 1
+	void Reset(uint32_t count) {
+		generation++;
+		items.clear();
+		bits.Resize(count);
+		bits.Clear();
+	}
+
+	bool contains(uint32_t index) const {
+		return index < bits.m_size && bits[index];
+	}
+	bool contains(const std::shared_ptr<T> &element) const {
+		return element && contains(element->index);
+	}
+
+	void push_back(const std::shared_ptr<T> &element) {
+		generation++;
+		if (element->index < bits.m_size) bits.Set(element->index, true);
+		items.push_back(element);
+	}
+
+	// Removes one occurrence of element, swapping the last one in its place like remove() from Board.h
+	void remove(std::shared_ptr<T> element) {
+		auto it = std::find(items.begin(), items.end(), element);
+		if (it == items.end()) return;
+		generation++;
+		std::swap(*it, items.back());
+		items.pop_back();
+		if (element->index < bits.m_size) bits.Set(element->index, std::find(items.begin(), items.end(), element) != items.end());
+	}
+
+	void clear() {
+		generation++;
+		for (auto &element : items) {
+			if (element->index < bits.m_size) bits.Set(element->index, false);
+		}
+		items.clear();
+	}
+
+	size_t size() const {
+		return items.size();
+	}
+	bool empty() const {
+		return items.empty();
+	}
+	typename SharedVector<T>::const_iterator begin() const {
+		return items.begin();
+	}
+	typename SharedVector<T>::const_iterator end() const {
+		return items.end();
+	}
+};
+
 struct ColorScheme {
 	/*
 	 * Take note, because these are directly set
@@ -108,6 +175,37 @@ struct ColorScheme {
 	uint32_t orMaskOutline = 0x00000000;
 };
 
+/*
+ * Settings and selections the board geometry is drawn with, besides the view.
+ * DrawBoard() draws the board again as soon as they differ from the ones it was last drawn with.
+ */
+struct BoardDrawState {
+	ColorScheme colors;
+	const Pin *pinSelected    = nullptr;
+	uint32_t pinsHighlighted  = 0; // HighlightList::generation
+	uint32_t partsHighlighted = 0;
+	double fontSize           = 0.0;
+	float pinSizeThresholdLow = 0.0f;
+	float pinHaloDiameter     = 0.0f;
+	float pinHaloThickness    = 0.0f;
+	int pinA1threshold        = 0;
+	int netWebThickness       = 0;
+	int pinDiameter           = 0;
+	bool pinShapeSquare       = false;
+	bool pinShapeCircle       = false;
+	bool pinSelectMasks       = false;
+	bool slowCPU              = false;
+	bool showNetWeb           = false;
+	bool showPins             = false;
+	bool pinHalo              = false;
+	bool fillParts            = false;
+	bool boardFill            = false;
+	bool showPartName         = false;
+	bool showPinName          = false;
+
+	bool operator==(const BoardDrawState &other) const;
+};
+
 // enum DrawChannel { kChannelImages = 0, kChannelFill, kChannelPolylines = 1, kChannelPins = 2, kChannelText = 3,
 // kChannelAnnotations = 4, NUM_DRAW_CHANNELS = 5 };
 enum DrawChannel {
@@ -123,8 +221,9 @@ enum DrawChannel {
 enum FlipModes { flipModeVP = 0, flipModeMP = 1, NUM_FLIP_MODES };
 
 struct BoardView {
-	BRDFileBase *m_file;
 	Board *m_board;
+	BoardLoader m_loader;
+	BoardLoader m_converter; // Parses the shown board file again for SaveNativeFile()
 	BackgroundImage backgroundImage{m_current_side};
 
 	Confparse obvconfig;
@@ -180,8 +279,7 @@ struct BoardView {
 	bool boardFill            = true;
 	bool showPartName         = true;
 	bool showPinName          = true;
-	int boardFillSpacing      = 3;
-	bool boardMinMaxDone      = false;
+	bool boardCache           = true; // Keep parsed boards in .obvcache files, see OBVCacheFile
 
 	bool showPosition  = true;
 	bool reloadConfig  = false;
@@ -221,12 +319,19 @@ struct BoardView {
 	bool m_centerZoomSearchResults = true;
 	void CenterZoomSearchResults(void);
 	int EPCCheck(void);
-	void OutlineGenFillDraw(ImDrawList *draw, int ydelta, double thickness);
+	// Triangles of the board shape in board coordinates, made once by GenerateBoardFill() and moved with the view when drawn
+	std::vector<ImVec2> m_boardFill;
+	void GenerateBoardFill(void);
+	void DrawBoardFill(ImDrawList *draw);
 
 	/* Context menu, sql stuff */
 	Annotations m_annotations;
 	void ContextMenu(void);
 	int AnnotationIsHovered(void);
+	// Rebuilds the annotations grid, after the list was generated again
+	void IndexAnnotations(void);
+	SpatialIndex m_annotationIndex;
+	std::vector<uint32_t> m_annotationsHovered; // Annotations marked hovered by the last AnnotationIsHovered()
 	bool AnnotationWasHovered     = false;
 	bool m_annotationnew_retain   = false;
 	bool m_annotationedit_retain  = false;
@@ -249,15 +354,25 @@ struct BoardView {
 
 	std::shared_ptr<Pin> m_pinSelected = nullptr;
 	//	vector<Net *> m_netHiglighted;
-	SharedVector<Pin> m_pinHighlighted;
-	SharedVector<Component> m_partHighlighted;
-	char m_cachedDrawList[sizeof(ImDrawList)];
-	ImVector<char> m_cachedDrawCommands;
+	HighlightList<Pin> m_pinHighlighted;
+	HighlightList<Component> m_partHighlighted;
+	// Fill, outline, parts and pins as last drawn, replayed with an offset while the view is only panned, see DrawBoard()
+	std::unique_ptr<ImDrawList> m_boardDrawList;
+	ImVec2 m_boardDrawOrigin;  // CoordToScreen(0, 0) when m_boardDrawList was drawn
+	ImVec2 m_boardDrawSurface; // m_board_surface when m_boardDrawList was drawn
+	float m_boardDrawScale  = 0.0f;
+	int m_boardDrawRotation = 0;
+	int m_boardDrawSide     = 0;
+	float m_drawMargin      = 0.0f; // Screen pixels drawn around the board surface, so that panning has something to show
+	BoardDrawState m_boardDrawState;
 	SharedVector<Net> m_nets;
 	int m_active_search_column = 0;
 	char m_search[3][128];
 	char m_netFilter[128];
 	std::string m_lastFileOpenName;
+	filesystem::path m_filepath; // Board currently shown
+	std::string m_saveNativeMsg;
+	filesystem::path m_saveNativePath;
 	float m_dx; // display top-right coordinate?
 	float m_dy;
 	float m_mx; // board MID POINTS
@@ -306,6 +421,7 @@ struct BoardView {
 	bool m_showColorPreferences;
 	bool m_firstFrame = true;
 	bool m_lastFileOpenWasInvalid;
+	bool m_showSaveNativeResult = false;
 	bool m_validBoard = false;
 	bool m_wantsQuit;
 
@@ -328,9 +444,20 @@ struct BoardView {
 	void DrawPins(ImDrawList *draw);
 	void DrawParts(ImDrawList *draw);
 	void DrawBoard();
+	// Draws the fill, outline, parts and pins into m_boardDrawList
+	void DrawBoardGeometry();
+	BoardDrawState DrawState() const;
 	void DrawNetWeb(ImDrawList *draw);
-	void LoadBoard(BRDFileBase *file);
+	void LoadBoard(BoardLoadResult &result);
 	int LoadFile(const filesystem::path &filepath);
+	bool IsLoading() const;
+	void FinishLoadFile();
+	void ShowLoadProgress();
+	void ShowLoaderProgress(BoardLoader &loader, const char *action);
+	void SaveNativeFile();
+	void FinishSaveNativeFile();
+	BoardLoader::Options ConvertOptions() const;
+	bool ConvertFile(const filesystem::path &input, const filesystem::path &output, bool compress, std::string &error_msg);
 	ImVec2 CoordToScreen(float x, float y, float w = 1.0f);
 	ImVec2 ScreenToCoord(float x, float y, float w = 1.0f);
 	// void Move(float x, float y);
@@ -344,8 +471,12 @@ struct BoardView {
 
 	// Returns true if the part is shown on the currently displayed side of the
 	// board.
-	bool BoardElementIsVisible(const std::shared_ptr<BoardElement> be);
+	bool BoardSideIsVisible(EBoardSide side);
+	bool BoardElementIsVisible(const std::shared_ptr<Component> &be);
+	bool BoardElementIsVisible(const std::shared_ptr<Pin> &be);
 	bool IsVisibleScreen(float x, float y, float radius, const ImGuiIO &io);
+	// Board area on screen grown by margin pixels, in board coordinates
+	SpatialIndex::Box VisibleArea(float margin);
 	// Returns true if the circle described by screen coordinates x, y, and radius
 	// is visible in the
 	// ImGuiIO screen rect.
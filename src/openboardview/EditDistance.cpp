@@ -0,0 +1,118 @@
+#include "EditDistance.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+inline unsigned popcount64(uint64_t v) {
+#ifdef _MSC_VER
+	return __popcnt(static_cast<uint32_t>(v)) + __popcnt(static_cast<uint32_t>(v >> 32));
+#else
+	return __builtin_popcountll(v);
+#endif
+}
+
+// One word of the differences once a character is appended to the text, eq has the bits where it is in the
+// pattern and carry the difference from the previous word. Returns the difference along the text at bit last.
+inline int step(uint64_t eq, uint64_t &up, uint64_t &down, int carry, uint64_t last = uint64_t{1} << 63) {
+	uint64_t xv = eq | down;
+	if (carry < 0) eq |= 1;
+	uint64_t xh    = (((eq & up) + up) ^ up) | eq;
+	uint64_t hup   = down | ~(xh | up);
+	uint64_t hdown = up & xh;
+	int out        = static_cast<int>((hup & last) != 0) - static_cast<int>((hdown & last) != 0);
+	hup            = hup << 1 | (carry > 0);
+	hdown          = hdown << 1 | (carry < 0);
+	up             = hdown | ~(xv | hup);
+	down           = hup & xv;
+	return out;
+}
+
+// Bits below bit i of word w
+inline uint64_t below(size_t i, size_t w) {
+	if (i <= w * 64) return 0;
+	if (i >= w * 64 + 64) return ~uint64_t{0};
+	return (uint64_t{1} << (i - w * 64)) - 1;
+}
+
+} // namespace
+
+EditDistance::EditDistance(const std::string &pattern) {
+	m_size  = std::min(pattern.size(), kMaxSize);
+	m_words = m_size > 64 ? 2 : 1;
+	m_last  = m_size ? uint64_t{1} << ((m_size - 1) % 64) : 0;
+	memset(m_match, 0, sizeof(m_match));
+	for (size_t i = 0; i < m_size; i++) m_match[static_cast<uint8_t>(pattern[i])][i / 64] |= uint64_t{1} << (i % 64);
+}
+
+EditDistance::Column EditDistance::start() const {
+	// The start of size i is i characters away from the empty text
+	Column column;
+	for (size_t w = 0; w < m_words; w++) column.up[w] = ~uint64_t{0};
+	column.distance = m_size;
+	return column;
+}
+
+EditDistance::Column EditDistance::next(const Column &column, char c) const {
+	Column result = column;
+	result.size++;
+
+	// The empty start of the pattern is one character further, then each word passes its last difference on
+	int carry             = 1;
+	const uint64_t *match = m_match[static_cast<uint8_t>(c)];
+	for (size_t w = 0; w + 1 < m_words; w++) carry = step(match[w], result.up[w], result.down[w], carry);
+	if (m_size) {
+		result.distance += step(match[m_words - 1], result.up[m_words - 1], result.down[m_words - 1], carry, m_last);
+	} else {
+		result.distance++;
+	}
+	return result;
+}
+
+unsigned int EditDistance::at(const Column &column, size_t i) const {
+	if (i >= m_size) return column.distance;
+
+	unsigned int d = column.size;
+	for (size_t w = 0; w < m_words; w++) {
+		uint64_t mask = below(i, w);
+		d += popcount64(column.up[w] & mask);
+		d -= popcount64(column.down[w] & mask);
+	}
+	return d;
+}
+
+unsigned int EditDistance::min(const Column &column, size_t from, size_t to) const {
+	// Down from to, which is often the whole pattern
+	unsigned int d    = at(column, to);
+	unsigned int best = d;
+	for (size_t i = to; i > from; i--) {
+		d -= (column.up[(i - 1) / 64] >> ((i - 1) % 64)) & 1;
+		d += (column.down[(i - 1) / 64] >> ((i - 1) % 64)) & 1;
+		best = std::min(best, d);
+	}
+	return best;
+}
+
+unsigned int EditDistance::distance(const char *text, size_t size) const {
+	// Same as next() with the column kept in registers
+	uint64_t up[2] = {~uint64_t{0}, ~uint64_t{0}}, down[2] = {0, 0};
+	unsigned int d = m_size;
+	if (!m_size) return size;
+	if (m_words > 1) {
+		for (size_t k = 0; k < size; k++) {
+			const uint64_t *match = m_match[static_cast<uint8_t>(text[k])];
+			d += step(match[1], up[1], down[1], step(match[0], up[0], down[0], 1), m_last);
+		}
+	} else {
+		for (size_t k = 0; k < size; k++) d += step(m_match[static_cast<uint8_t>(text[k])][0], up[0], down[0], 1, m_last);
+	}
+	return d;
+}
+
+unsigned int EditDistance::distance(const std::string &text) const {
+	return distance(text.data(), text.size());
+}
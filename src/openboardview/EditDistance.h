@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Levenshtein distance from a pattern of up to 128 characters to other strings, one bit per pattern
+ * character (Myers' bit-vector algorithm as written by Hyyrö): a few word operations per character
+ * of the other string, no allocation. Longer patterns are cut.
+ */
+class EditDistance {
+  public:
+	static const size_t kMaxSize = 128;
+
+	/*
+	 * Distances from every start of the pattern to a text, as the differences between consecutive ones:
+	 * bit i of up (down) is set if the start of size i + 1 is one further (closer) than the start of size i.
+	 * Texts can be grown one character at a time, e.g. along the branches of a trie.
+	 */
+	struct Column {
+		uint64_t up[2]        = {0, 0};
+		uint64_t down[2]      = {0, 0};
+		size_t size           = 0; // Characters of the text
+		unsigned int distance = 0; // From the whole pattern
+	};
+
+	explicit EditDistance(const std::string &pattern);
+
+	size_t size() const {
+		return m_size;
+	}
+
+	// The empty text
+	Column start() const;
+	// The text of column followed by c
+	Column next(const Column &column, char c) const;
+
+	// Distance from the first i characters of the pattern to the text of column
+	unsigned int at(const Column &column, size_t i) const;
+	// Smallest distance from the first i characters of the pattern, for i in [from, to], to the text of column
+	unsigned int min(const Column &column, size_t from, size_t to) const;
+
+	unsigned int distance(const char *text, size_t size) const;
+	unsigned int distance(const std::string &text) const;
+
+  private:
+	uint64_t m_match[256][2]; // Positions of each character in the pattern
+	size_t m_size;
+	size_t m_words;           // Words used by the bit vectors
+	uint64_t m_last;          // Last character of the pattern in its word
+};
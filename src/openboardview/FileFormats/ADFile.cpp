@@ -19,10 +19,7 @@
 #define ADFILE_BLOCK_PADS 4
 #define ADFILE_BLOCK_TRACKS 5
 
-char *arena;
-char *arena_end;
-
-char *read_item(char *p) {
+char *read_item(char *p, StringArena &arena) {
 	char *s;
 	char *r;
 
@@ -32,13 +29,7 @@ char *read_item(char *p) {
 	*p = 0;
 	r  = strdup(s);
 	*p = '|';
-	return fix_to_utf8(r, &arena, arena_end);
-}
-
-bool ADFile::verifyFormat(std::vector<char> &buf) {
-	bool isBinary  = find_str_in_buf("Binary", buf);
-	bool versionOK = find_str_in_buf("|KIND=Protel_Advanced_PCB", buf);
-	return versionOK && !isBinary;
+	return fix_to_utf8(r, arena);
 }
 
 void ADFile::outline_order_segments(std::vector<BRDPoint> &format) {
@@ -96,30 +87,21 @@ void ADFile::outline_order_segments(std::vector<BRDPoint> &format) {
 	}
 }
 
-ADFile::ADFile(std::vector<char> &buf) {
+ADFile::ADFile(const BufferSpan &buf) {
 	auto buffer_size = buf.size();
 
 	char *saved_locale;
 	saved_locale = setlocale(LC_NUMERIC, "C"); // Use '.' as delimiter for strtod
 
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	arena     = &file_buf[buffer_size + 1];
-	arena_end = file_buf + file_buf_size - 1;
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
-	*arena_end            = 0;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
 
 	int current_block = 0;
 	int net_count     = 0;
 	BRDPoint format_first, format_last;
 
 	std::vector<char *> lines;
-	stringfile(file_buf, lines);
+	stringfile(file_buf, buffer_size, lines);
 
 	std::vector<char *>::iterator line_it = lines.begin();
 	while (line_it != lines.end()) {
@@ -157,7 +139,7 @@ ADFile::ADFile(std::vector<char> &buf) {
 				p = strstr(line, "|LAYER=");
 				if (p) {
 					p += 7;
-					layer = read_item(p);
+					layer = read_item(p, arena);
 				}
 
 				p = strstr(line, "|COMPONENT=");
@@ -256,7 +238,7 @@ ADFile::ADFile(std::vector<char> &buf) {
 				net_count++;
 				p = strstr(p, "|NAME=");
 				if (p) p += 6;
-				net.name = read_item(p);
+				net.name = read_item(p, arena);
 				ad_nets.push_back(net);
 				current_block = ADFILE_BLOCK_NONE;
 
@@ -276,7 +258,7 @@ ADFile::ADFile(std::vector<char> &buf) {
 				part.part_id++;
 				p = strstr(p, "|LAYER=");
 				if (p) p += 7;
-				part.layer = read_item(p);
+				part.layer = read_item(p, arena);
 				p          = strstr(p, "|X=");
 				if (p) p += 3;
 				part.x = READ_DOUBLE();
@@ -289,7 +271,7 @@ ADFile::ADFile(std::vector<char> &buf) {
 				p                = strstr(p, "|SOURCEDESIGNATOR=");
 				if (p) {
 					p += 18;
-					part.name = read_item(p);
+					part.name = read_item(p, arena);
 				} else {
 					char tn[1024];
 					snprintf(tn, sizeof(tn), "UNKNOWN-%d", part.part_id);
@@ -299,7 +281,7 @@ ADFile::ADFile(std::vector<char> &buf) {
 				if (p) {
 					char *t;
 					p += 19;
-					t                = read_item(p);
+					t                = read_item(p, arena);
 					part.description = t;
 				}
 
@@ -324,7 +306,7 @@ ADFile::ADFile(std::vector<char> &buf) {
 				p = strstr(line, "|NAME=");
 				if (p) {
 					p += 6;
-					pad.snum = read_item(p);
+					pad.snum = read_item(p, arena);
 					*p       = '|';
 				}
 
@@ -388,14 +370,14 @@ ADFile::ADFile(std::vector<char> &buf) {
 				p = strstr(line, "|UNIQUEID=");
 				if (p) {
 					p += sizeof("|UNIQUEID=") - 1;
-					pad.unique_id = read_item(p);
+					pad.unique_id = read_item(p, arena);
 					*p            = '|';
 				}
 
 				p = strstr(line, "|LAYER=");
 				if (p) {
 					p += sizeof("|LAYER=") - 1;
-					pad.layer = read_item(p);
+					pad.layer = read_item(p, arena);
 					if (strcmp(pad.layer, "MULTILAYER") == 0) {
 						pad.type = 1;
 					}
@@ -34,7 +34,7 @@ struct AD_BRDPad {
 };
 
 struct ADFile : public BRDFileBase {
-	ADFile(std::vector<char> &buf);
+	ADFile(const BufferSpan &buf);
 
 	struct {
 		bool operator()(BRDPin a, BRDPin b) const {
@@ -47,6 +47,5 @@ struct ADFile : public BRDFileBase {
 	std::vector<AD_BRDPart> ad_parts;
 	std::vector<AD_BRDPad> ad_pads;
 
-	static bool verifyFormat(std::vector<char> &buf);
 	void outline_order_segments(std::vector<BRDPoint> &format);
 };
@@ -14,20 +14,20 @@
 		while ((*p && *(p + 1)) && (!isspace((uint8_t)*p) || !isspace((uint8_t)*(p + 1)))) ++p; \
 		*p = 0;                                      \
 		p++;                                         \
-		return fix_to_utf8(s, &arena, arena_end);    \
+		return fix_to_utf8(s, arena);                \
 	}
 
 class ASCFile : public BRDFileBase {
   public:
 	typedef std::vector<char *>::iterator line_iterator_t;
-	ASCFile(std::vector<char> &buf, const filesystem::path &filepath);
+	ASCFile(const BufferSpan &buf, const filesystem::path &filepath);
 
-	//	static bool verifyFormat(std::vector<char> &buf);
-	void parse_format(char *&p, char *&s, char *&arena, char *&arena_end, line_iterator_t &line_it);
-	void parse_pin(char *&p, char *&s, char *&arena, char *&arena_end, line_iterator_t &line_it);
-	void parse_nail(char *&p, char *&s, char *&arena, char *&arena_end, line_iterator_t &line_it);
-	bool read_asc(const filesystem::path &filepath, void (ASCFile::*parser)(char *&, char *&, char *&, char *&, line_iterator_t&));
-	bool load_and_parse(const filesystem::path &path, const std::string &filename, void (ASCFile::*parser)(char *&, char *&, char *&, char *&, line_iterator_t&));
+	//	static bool verifyFormat(const BufferSpan &buf);
+	void parse_format(char *&p, char *&s, line_iterator_t &line_it);
+	void parse_pin(char *&p, char *&s, line_iterator_t &line_it);
+	void parse_nail(char *&p, char *&s, line_iterator_t &line_it);
+	bool read_asc(const filesystem::path &filepath, void (ASCFile::*parser)(char *&, char *&, line_iterator_t&));
+	bool load_and_parse(const filesystem::path &path, const std::string &filename, void (ASCFile::*parser)(char *&, char *&, line_iterator_t&));
 	void update_counts();
 
   protected:
@@ -3,7 +3,6 @@
 #include "BRDFileBase.h"
 
 struct BDVFile : public BRDFileBase {
-	BDVFile(std::vector<char> &buf);
+	BDVFile(const BufferSpan &buf);
 
-	static bool verifyFormat(std::vector<char> &buf);
 };
@@ -7,34 +7,32 @@
 #include <cstring>
 #include <unordered_map>
 
-bool BRD2File::verifyFormat(std::vector<char> &buf) {
-	return find_str_in_buf("BRDOUT:", buf) && find_str_in_buf("NETS:", buf);
-}
-
-BRD2File::BRD2File(std::vector<char> &buf) {
+BRD2File::BRD2File(const BufferSpan &buf) {
 	auto buffer_size = buf.size();
 	std::unordered_map<int, char *> nets; // Map between net id and net name
 	unsigned int num_nets = 0;
 	BRDPoint max{0, 0}; // Top-right board boundary
 
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
-	// This is for fixing degenerate utf8
-	char *arena     = &file_buf[buffer_size + 1];
-	char *arena_end = file_buf + file_buf_size - 1;
-	*arena_end      = 0;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
 
 	int current_block = 0;
 
 	std::vector<char *>  lines;
-	stringfile(file_buf, lines);
-
-	for (char *line : lines) {
+	stringfile(file_buf, buffer_size, lines);
+
+	// Pins and nails make most of the file, their blocks are parsed once the nets are known
+	std::vector<std::pair<size_t, size_t>> pin_blocks, nail_blocks;
+	size_t block_begin = 0;
+	auto set_block     = [&](int block, size_t i) {
+		if (current_block == 4) pin_blocks.push_back({block_begin, i});
+		if (current_block == 5) nail_blocks.push_back({block_begin, i});
+		current_block = block;
+		block_begin   = i + 1;
+	};
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		char *line = lines[i];
 		while (isspace((uint8_t)*line)) line++;
 		if (!line[0]) continue;
 
@@ -42,7 +40,7 @@ BRD2File::BRD2File(std::vector<char> &buf) {
 		char *s;
 
 		if (strstr(line, "BRDOUT:") == line) {
-			current_block = 1;
+			set_block(1, i);
 			p += 7; // Skip "BRDOUT:"
 			num_format = READ_UINT();
 			max.x      = READ_INT();
@@ -50,25 +48,25 @@ BRD2File::BRD2File(std::vector<char> &buf) {
 			continue;
 		}
 		if (strstr(line, "NETS:") == line) {
-			current_block = 2;
+			set_block(2, i);
 			p += 5; // Skip "NETS:"
 			num_nets = READ_UINT();
 			continue;
 		}
 		if (strstr(line, "PARTS:") == line) {
-			current_block = 3;
+			set_block(3, i);
 			p += 6; // Skip "PARTS:"
 			num_parts = READ_UINT();
 			continue;
 		}
 		if (strstr(line, "PINS:") == line) {
-			current_block = 4;
+			set_block(4, i);
 			p += 5; // Skip "PINS:"
 			num_pins = READ_UINT();
 			continue;
 		}
 		if (strstr(line, "NAILS:") == line) {
-			current_block = 5;
+			set_block(5, i);
 			p += 6; // Skip "NAILS:"
 			num_nails = READ_UINT();
 			continue;
@@ -112,63 +110,65 @@ BRD2File::BRD2File(std::vector<char> &buf) {
 
 				parts.push_back(part);
 			} break;
-
-			case 4: { // PINS
-				ENSURE(pins.size() < num_pins, error_msg);
-				BRDPin pin;
-
-				pin.pos.x = READ_INT();
-				pin.pos.y = READ_INT();
-				int netid = READ_UINT();
-				unsigned int side  = READ_UINT();
-				if (side == 1)
-					pin.side = BRDPinSide::Top;
-				else if (side == 2)
-					pin.side = BRDPinSide::Bottom;
-				else //0
-					pin.side = BRDPinSide::Both;
-
-				try {
-					pin.net = nets.at(netid);
-				} catch (const std::out_of_range &e) {
-					pin.net = "";
-				}
-
-				pin.probe = 1;
-				pin.part  = 0;
-				pins.push_back(pin);
-			} break;
-
-			case 5: { // NAILS
-				ENSURE(nails.size() < num_nails, error_msg);
-				BRDNail nail;
-
-				nail.probe = READ_UINT();
-				nail.pos.x = READ_INT();
-				nail.pos.y = READ_INT();
-				int netid  = READ_UINT();
-
-				auto inet = nets.find(netid);
-				if (inet != nets.end())
-					nail.net = inet->second;
-				else {
-					nail.net = "UNCONNECTED";
-					std::cerr << "Missing net id: " << netid << std::endl;
-				}
-
-				bool nail_is_top = READ_UINT() == 1;
-				if (nail_is_top) {
-					nail.side = BRDPartMountingSide::Top;
-				} else {
-					nail.side = BRDPartMountingSide::Bottom;
-					nail.pos.y = max.y - nail.pos.y;
-				}
-				nails.push_back(nail);
-
-			} break;
 			default: continue;
 		}
 	}
+	bool has_blocks = current_block != 0;
+	set_block(0, lines.size());
+
+	for (auto &block : pin_blocks) {
+		ParseLines(lines, block.first, block.second, pins, [&](char *line, std::vector<BRDPin> &out, StringArena &, std::string &error_msg) {
+			char *p = line;
+			BRDPin pin;
+
+			pin.pos.x = READ_INT();
+			pin.pos.y = READ_INT();
+			int netid = READ_UINT();
+			unsigned int side  = READ_UINT();
+			if (side == 1)
+				pin.side = BRDPinSide::Top;
+			else if (side == 2)
+				pin.side = BRDPinSide::Bottom;
+			else //0
+				pin.side = BRDPinSide::Both;
+
+			auto inet = nets.find(netid);
+			pin.net   = inet != nets.end() ? inet->second : "";
+
+			pin.probe = 1;
+			pin.part  = 0;
+			out.push_back(pin);
+		});
+	}
+
+	for (auto &block : nail_blocks) {
+		ParseLines(lines, block.first, block.second, nails, [&](char *line, std::vector<BRDNail> &out, StringArena &, std::string &error_msg) {
+			char *p = line;
+			BRDNail nail;
+
+			nail.probe = READ_UINT();
+			nail.pos.x = READ_INT();
+			nail.pos.y = READ_INT();
+			int netid  = READ_UINT();
+
+			auto inet = nets.find(netid);
+			if (inet != nets.end())
+				nail.net = inet->second;
+			else {
+				nail.net = "UNCONNECTED";
+				std::cerr << "Missing net id: " << netid << std::endl;
+			}
+
+			bool nail_is_top = READ_UINT() == 1;
+			if (nail_is_top) {
+				nail.side = BRDPartMountingSide::Top;
+			} else {
+				nail.side = BRDPartMountingSide::Bottom;
+				nail.pos.y = max.y - nail.pos.y;
+			}
+			out.push_back(nail);
+		});
+	}
 
 	ENSURE(num_format == format.size(), error_msg);
 	ENSURE(num_nets == nets.size(), error_msg);
@@ -230,5 +230,5 @@ BRD2File::BRD2File(std::vector<char> &buf) {
 
 	AddNailsAsPins();
 
-	valid = current_block != 0;
+	valid = has_blocks;
 }
@@ -2,7 +2,6 @@
 
 #include "BRDFileBase.h"
 struct BRD2File : public BRDFileBase {
-	BRD2File(std::vector<char> &buf);
+	BRD2File(const BufferSpan &buf);
 
-	static bool verifyFormat(std::vector<char> &buf);
 };
@@ -14,28 +14,17 @@ decltype(BRDFile::signature) constexpr BRDFile::signature;
  * Returns true if the file format seems to be BRD.
  * Uses std::string::find() on a std::string rather than strstr() on the buffer because the latter expects a null-terminated string.
  */
-bool BRDFile::verifyFormat(std::vector<char> &buf) {
+bool BRDFile::hasEncodedHeader(const BufferSpan &buf) {
 	if (buf.size() < signature.size()) return false; // C++14 implements a safer std::equal where this is not needed
-	if (std::equal(signature.begin(), signature.end(), buf.begin(), [](const uint8_t &i, const char &j) {
-		    return i == reinterpret_cast<const uint8_t &>(j);
-		}))
-		return true;
-	return find_str_in_buf("str_length:", buf) && find_str_in_buf("var_data:", buf);
+	return std::equal(signature.begin(), signature.end(), buf.begin(), [](const uint8_t &i, const char &j) {
+		return i == reinterpret_cast<const uint8_t &>(j);
+	});
 }
 
-BRDFile::BRDFile(std::vector<char> &buf) {
+BRDFile::BRDFile(const BufferSpan &buf) {
 	auto buffer_size = buf.size();
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
-	// This is for fixing degenerate utf8
-	char *arena     = &file_buf[buffer_size + 1];
-	char *arena_end = file_buf + file_buf_size - 1;
-	*arena_end      = 0;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
 
 	// decode the file if it appears to be encoded:
 	static const uint8_t encoded_header[] = {0x23, 0xe2, 0x63, 0x28};
@@ -52,33 +41,44 @@ BRDFile::BRDFile(std::vector<char> &buf) {
 
 	int current_block = 0;
 	std::vector<char*> lines;
-	stringfile(file_buf, lines);
+	stringfile(file_buf, buffer_size, lines);
+
+	// Pins and nails make most of the file, their blocks are parsed once all the others are known
+	std::vector<std::pair<size_t, size_t>> pin_blocks, nail_blocks;
+	size_t block_begin = 0;
+	auto set_block     = [&](int block, size_t i) {
+		if (current_block == 5) pin_blocks.push_back({block_begin, i});
+		if (current_block == 6) nail_blocks.push_back({block_begin, i});
+		current_block = block;
+		block_begin   = i + 1;
+	};
 
-	for (char *line : lines) {
+	for (size_t i = 0; i < lines.size(); i++) {
+		char *line = lines[i];
 		while (isspace((uint8_t)*line)) line++;
 		if (!line[0]) continue;
 		if (!strcmp(line, "str_length:")) {
-			current_block = 1;
+			set_block(1, i);
 			continue;
 		}
 		if (!strcmp(line, "var_data:")) {
-			current_block = 2;
+			set_block(2, i);
 			continue;
 		}
 		if (!strcmp(line, "Format:") || !strcmp(line, "format:")) {
-			current_block = 3;
+			set_block(3, i);
 			continue;
 		}
 		if (!strcmp(line, "Parts:") || !strcmp(line, "Pins1:")) {
-			current_block = 4;
+			set_block(4, i);
 			continue;
 		}
 		if (!strcmp(line, "Pins:") || !strcmp(line, "Pins2:")) {
-			current_block = 5;
+			set_block(5, i);
 			continue;
 		}
 		if (!strcmp(line, "Nails:")) {
-			current_block = 6;
+			set_block(6, i);
 			continue;
 		}
 
@@ -112,29 +112,41 @@ BRDFile::BRDFile(std::vector<char> &buf) {
 				ENSURE(part.end_of_pins <= num_pins, error_msg);
 				parts.push_back(part);
 			} break;
-			case 5: { // Pins
-				ENSURE(pins.size() < num_pins, error_msg);
-				BRDPin pin;
-				pin.pos.x = READ_INT();
-				pin.pos.y = READ_INT();
-				pin.probe = READ_INT(); // Can be negative (-99)
-				pin.part  = READ_UINT();
-				ENSURE(pin.part <= num_parts, error_msg);
-				pin.net = READ_STR();
-				pins.push_back(pin);
-			} break;
-			case 6: { // Nails
-				ENSURE(nails.size() < num_nails, error_msg);
-				BRDNail nail;
-				nail.probe = READ_UINT();
-				nail.pos.x = READ_INT();
-				nail.pos.y = READ_INT();
-				nail.side  = READ_UINT() == 1 ? BRDPartMountingSide::Top : BRDPartMountingSide::Bottom;
-				nail.net   = READ_STR();
-				nails.push_back(nail);
-			} break;
 		}
 	}
+	bool has_blocks = current_block != 0;
+	set_block(0, lines.size());
+
+	for (auto &block : pin_blocks) {
+		ParseLines(lines, block.first, block.second, pins, [&](char *line, std::vector<BRDPin> &out, StringArena &arena, std::string &error_msg) {
+			char *p = line;
+			char *s;
+			BRDPin pin;
+			pin.pos.x = READ_INT();
+			pin.pos.y = READ_INT();
+			pin.probe = READ_INT(); // Can be negative (-99)
+			pin.part  = READ_UINT();
+			ENSURE(pin.part <= num_parts, error_msg);
+			pin.net = READ_STR();
+			out.push_back(pin);
+		});
+	}
+	ENSURE(pins.size() <= num_pins, error_msg);
+
+	for (auto &block : nail_blocks) {
+		ParseLines(lines, block.first, block.second, nails, [&](char *line, std::vector<BRDNail> &out, StringArena &arena, std::string &error_msg) {
+			char *p = line;
+			char *s;
+			BRDNail nail;
+			nail.probe = READ_UINT();
+			nail.pos.x = READ_INT();
+			nail.pos.y = READ_INT();
+			nail.side  = READ_UINT() == 1 ? BRDPartMountingSide::Top : BRDPartMountingSide::Bottom;
+			nail.net   = READ_STR();
+			out.push_back(nail);
+		});
+	}
+	ENSURE(nails.size() <= num_nails, error_msg);
 
 	// Lenovo brd variant, find net from nail
 	std::unordered_map<int, const char *> nailsToNets; // Map between net id and net name
@@ -157,5 +169,5 @@ BRDFile::BRDFile(std::vector<char> &buf) {
 		}
 	}
 
-	valid = current_block != 0;
+	valid = has_blocks;
 }
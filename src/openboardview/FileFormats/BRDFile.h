@@ -8,9 +8,10 @@
 
 class BRDFile : public BRDFileBase {
   public:
-	BRDFile(std::vector<char> &buf);
+	BRDFile(const BufferSpan &buf);
 
-	static bool verifyFormat(std::vector<char> &buf);
+	// Encoded files start with a fixed signature, see FormatRegistry for plain ones
+	static bool hasEncodedHeader(const BufferSpan &buf);
 
   private:
 	static constexpr std::array<uint8_t, 4> signature = {{0x23, 0xe2, 0x63, 0x28}};
@@ -1,74 +1,225 @@
 #include "BRDFileBase.h"
 
 #include "utf8/utf8.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
 
-// from stb.h
-void stringfile(char *buffer, std::vector<char*> &lines) {
-	char *s;
-	size_t count, i;
-
-	// two passes through: first time count lines, second time set them
-	for (i = 0; i < 2; ++i) {
-		s                   = buffer;
-		if (i == 1) lines[0] = s;
-		count               = 1; // was '1',  but C arrays are 0-indexed
-		while (*s) {
-			if (*s == '\n' || *s == '\r') {
-
-				// If this is the 2nd pass, then terminate the line at the first line break char
-				if (i == 1) *s = 0;
-
-				s++; // next char
-
-				// if the termination is a CRLF combo, then jump to the next char
-				if ((*s == '\r') || (*s == '\n')) s++;
-
-				// if the char is valid (first after line break), set up the next item in the line array
-				if (*s) { // it's not over yet
-					if (i == 1) {
-						lines[count] = s;
-						//					  list[count+1] = NULL;
-						// fprintf(stdout,"%s\n",list[count]);
-					}
-					++count;
-				}
-			}
-			s++;
-		} // while s
-
-		// Generate the required array to hold all the line starting points
-		if (i == 0) {
-			lines.resize(count);
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRINGFILE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__) // Runtime dispatch relies on the target attribute
+#define STRINGFILE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Buffers smaller than this are scanned on the calling thread only
+constexpr size_t stringfile_parallel_min_chunk = 8 * 1024 * 1024;
+
+inline unsigned ctz32(uint32_t v) {
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return i;
+#else
+	return __builtin_ctz(v);
+#endif
+}
+
+/*
+ * Line break candidates scanners: record the offset of every CR, LF and NUL in buffer[from, size)
+ */
+void scan_breaks_scalar(const char *buffer, size_t from, size_t size, std::vector<uint32_t> &breaks) {
+	for (size_t i = from; i < size; i++) {
+		char c = buffer[i];
+		if (c == '\n' || c == '\r' || c == '\0') breaks.push_back(i);
+	}
+}
+
+// Appends the offsets of the bits set in mask, relative to base
+inline void push_breaks_mask(size_t base, uint32_t mask, std::vector<uint32_t> &breaks) {
+	while (mask) {
+		breaks.push_back(base + ctz32(mask));
+		mask &= mask - 1;
+	}
+}
+
+#ifdef STRINGFILE_SSE2
+void scan_breaks_sse2(const char *buffer, size_t size, std::vector<uint32_t> &breaks) {
+	const __m128i cr  = _mm_set1_epi8('\r');
+	const __m128i lf  = _mm_set1_epi8('\n');
+	const __m128i nul = _mm_setzero_si128();
+	size_t i          = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + i));
+		__m128i m     = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)), _mm_cmpeq_epi8(v, nul));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(m));
+		if (mask) push_breaks_mask(i, mask, breaks);
+	}
+	scan_breaks_scalar(buffer, i, size, breaks);
+}
+#endif
+
+#ifdef STRINGFILE_AVX2
+__attribute__((target("avx2"))) void scan_breaks_avx2(const char *buffer, size_t size, std::vector<uint32_t> &breaks) {
+	const __m256i cr  = _mm256_set1_epi8('\r');
+	const __m256i lf  = _mm256_set1_epi8('\n');
+	const __m256i nul = _mm256_setzero_si256();
+	size_t i          = 0;
+	for (; i + 32 <= size; i += 32) {
+		__m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + i));
+		__m256i m     = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)), _mm256_cmpeq_epi8(v, nul));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+		if (mask) push_breaks_mask(i, mask, breaks);
+	}
+	scan_breaks_scalar(buffer, i, size, breaks);
+}
+#endif
+
+void scan_breaks(const char *buffer, size_t size, std::vector<uint32_t> &breaks) {
+#ifdef STRINGFILE_AVX2
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx2) {
+		scan_breaks_avx2(buffer, size, breaks);
+		return;
+	}
+#endif
+#ifdef STRINGFILE_SSE2
+	scan_breaks_sse2(buffer, size, breaks);
+#else
+	scan_breaks_scalar(buffer, 0, size, breaks);
+#endif
+}
+
+} // namespace
+
+/*
+ * Splits buffer in lines, originally from stb.h
+ * A line ends at the first CR or LF and the line break may be made of two of those (CRLF, LFCR, LFLF, CRCR).
+ * The first char of a line is never considered as a line break.
+ * Each line is NUL terminated in place, the text ends at the first other NUL and buffer[size] must be NUL.
+ *
+ * Line break candidates are found with SIMD, in parallel chunks for large buffers,
+ * then resolved in a single sequential pass over the candidates only.
+ */
+void stringfile(char *buffer, size_t size, std::vector<char *> &lines) {
+	size_t nchunks = 1;
+	if (size >= 2 * stringfile_parallel_min_chunk) {
+		size_t nthreads = std::max(1u, std::thread::hardware_concurrency());
+		nchunks         = std::min(nthreads, size / stringfile_parallel_min_chunk);
+	}
+	size_t chunk_size = (size + nchunks - 1) / nchunks;
+
+	std::vector<std::vector<uint32_t>> breaks(nchunks);
+	auto scan_chunk = [&](size_t c) {
+		size_t begin = c * chunk_size;
+		size_t end   = std::min(size, begin + chunk_size);
+		if (begin < end) scan_breaks(buffer + begin, end - begin, breaks[c]);
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t c = 1; c < nchunks; c++) workers.emplace_back(scan_chunk, c);
+	scan_chunk(0);
+	for (auto &w : workers) w.join();
+
+	size_t count = 1;
+	for (auto &b : breaks) count += b.size();
+	lines.clear();
+	lines.reserve(count);
+	lines.push_back(buffer);
+
+	size_t next = 0; // First offset that may start a line break
+	for (size_t c = 0; c < nchunks; c++) {
+		size_t base = c * chunk_size;
+		for (uint32_t offset : breaks[c]) {
+			size_t i = base + offset;
+			if (i < next) continue; // Part of the previous line break or first char of a line
+			if (!buffer[i]) return; // End of text
+
+			// Terminate the line at the first line break char, skip the second one of a CRLF combo
+			buffer[i++] = 0;
+			if ((buffer[i] == '\r') || (buffer[i] == '\n')) i++;
+			if (i >= size) return; // It's over
+
+			// A NUL right after a line break does not end the text (as in stb.h), but does not start a line either
+			if (buffer[i]) lines.push_back(buffer + i);
+			next = i + 1;
 		}
 	}
 }
 
-char *fix_to_utf8(char *s, char **arena, char *arena_end) {
+constexpr size_t StringArena::chunk_size;
+
+char *StringArena::allocate(size_t size) {
+	if (static_cast<size_t>(end - current) < size) {
+		size_t n = std::max(size, chunk_size);
+		chunks.emplace_back(new char[n]);
+		current = chunks.back().get();
+		end     = current + n;
+	}
+	char *p = current;
+	current += size;
+	return p;
+}
+
+void StringArena::merge(StringArena &&other) {
+	for (auto &chunk : other.chunks) chunks.push_back(std::move(chunk));
+	other.chunks.clear();
+	other.current = other.end = nullptr;
+}
+
+char *fix_to_utf8(char *s, StringArena &arena) {
 	if (!utf8valid(s)) {
 		return s;
 	}
-	char *p     = *arena;
+	// Every byte is re-encoded as latin1, which takes at most 2 bytes in UTF-8
+	char *p     = arena.allocate(2 * strlen(s) + 1);
 	char *begin = p;
 	while (*s) {
 		uint32_t c = (uint8_t)*s;
 		if (c < 0x80) {
-			if (p + 1 >= arena_end) goto done;
 			*p++ = c;
 		} else {
-			if (p + 2 >= arena_end) goto done;
 			*p++ = 0xc0 | (c >> 6);
 			*p++ = 0x80 | (c & 0x3f);
 		}
 		++s;
 	}
-	if (p + 1 >= arena_end) goto done;
-	*p++ = 0;
-done:
-	*arena = p;
+	*p = 0;
 	return begin;
 }
 
+static size_t forced_chunk_count = 0;
+
+void force_chunk_count(size_t nchunks) {
+	forced_chunk_count = nchunks;
+}
+
+std::vector<size_t> chunk_bounds(size_t count, size_t min_size) {
+	size_t nchunks = 1;
+	if (forced_chunk_count) {
+		nchunks = forced_chunk_count;
+	} else if (count >= 2 * min_size) {
+		size_t nthreads = std::max(1u, std::thread::hardware_concurrency());
+		nchunks         = std::min(nthreads, count / min_size);
+	}
+	std::vector<size_t> bounds;
+	for (size_t c = 0; c <= nchunks; c++) bounds.push_back(count * c / nchunks);
+	return bounds;
+}
+
+void BRDFileBase::AttachSource(MappedFile &&source) {
+	sources.push_back(std::move(source));
+}
+
 void BRDFileBase::AddNailsAsPins() {
 	for (auto &nail : nails) {
 		BRDPin pin;
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <cctype>
+#include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "MappedFile.h"
+
 #define READ_INT() strtol(p, &p, 10);
 // Warning: read as int then cast to uint if positive
 #define READ_UINT                                \
@@ -20,7 +27,7 @@
 		while ((*p) && (!isspace((uint8_t)*p))) ++p; \
 		*p = 0;                                      \
 		p++;                                         \
-		return fix_to_utf8(s, &arena, arena_end);    \
+		return fix_to_utf8(s, arena);                \
 	}
 
 struct BRDPoint {
@@ -78,6 +85,31 @@ struct BRDNail {
 	const char *net = "UNCONNECTED";
 };
 
+// Storage for the strings fix_to_utf8() has to re-encode.
+// Chunks are allocated on demand since most files are valid UTF-8 and never need it.
+class StringArena {
+  public:
+	char *allocate(size_t size);
+	// Takes over the chunks of other, the strings it handed out stay valid
+	void merge(StringArena &&other);
+
+  private:
+	static constexpr size_t chunk_size = 64 * 1024;
+	std::vector<std::unique_ptr<char[]>> chunks;
+	char *current = nullptr;
+	char *end     = nullptr;
+};
+
+// Stages of a board load, in order, see BoardLoader
+enum class LoadStage { Idle, Read, Decrypt, Decompress, Parse, Model, Geometry, Index, Done };
+
+// Shared between the loading thread and the UI.
+// Parsers with several expensive steps report them through stage and may stop early once cancelled is set.
+struct LoadProgress {
+	std::atomic<LoadStage> stage{LoadStage::Idle};
+	std::atomic<bool> cancelled{false};
+};
+
 class BRDFileBase {
   public:
 	unsigned int num_format = 0;
@@ -94,18 +126,73 @@ class BRDFileBase {
 	bool valid = false;
 	std::string error_msg = "";
 
-	virtual ~BRDFileBase()
-	{
-		free(file_buf);
-		file_buf = nullptr;
-	}
+	virtual ~BRDFileBase() {}
+
+	// Parsers work in place on the buffer they are given and the parsed strings point into it,
+	// so the caller hands its ownership over once parsing is done.
+	void AttachSource(MappedFile &&source);
+
   protected:
 	void AddNailsAsPins();
 	BRDFileBase() {}
-	// file_buf is used by some implementations. But since the derived class constructurs
-	// are already passed a memory buffer most usages are "historic unneeded extra copies".
-	char *file_buf = nullptr;
+
+	template <class T, class Parse>
+	void ParseLines(const std::vector<char *> &lines, size_t begin, size_t end, std::vector<T> &out, Parse parse);
+
+	std::vector<MappedFile> sources;
+	StringArena arena; // Re-encoded strings, see fix_to_utf8()
 };
 
-void stringfile(char *buffer, std::vector<char*> &lines);
-char *fix_to_utf8(char *s, char **arena, char *arena_end);
+void stringfile(char *buffer, size_t size, std::vector<char *> &lines);
+char *fix_to_utf8(char *s, StringArena &arena);
+
+// Splits count items in ranges of at least min_size items, at most one per hardware thread.
+// Range c is [bounds[c], bounds[c + 1]).
+std::vector<size_t> chunk_bounds(size_t count, size_t min_size);
+// Makes chunk_bounds() split any range in nchunks chunks whatever its size, so that tests can compare chunked parsing
+// with a single chunk. 0 goes back to the default.
+void force_chunk_count(size_t nchunks);
+
+// Calls run(c) for every chunk, the first one on the calling thread and the others on their own threads
+template <class Run>
+void run_chunks(size_t nchunks, Run run) {
+	std::vector<std::thread> workers;
+	for (size_t c = 1; c < nchunks; c++) workers.emplace_back(run, c);
+	if (nchunks > 0) run(0);
+	for (auto &w : workers) w.join();
+}
+
+/*
+ * Parses lines[begin, end) with parse(line, out, arena, error_msg), one item per line, blank lines skipped.
+ * Large blocks are split in chunks parsed concurrently, each into its own vector, arena and error message,
+ * then merged in order, so parse must only read the state shared between lines.
+ */
+template <class T, class Parse>
+void BRDFileBase::ParseLines(const std::vector<char *> &lines, size_t begin, size_t end, std::vector<T> &out, Parse parse) {
+	static const size_t parallel_min_lines = 16 * 1024;
+
+	auto bounds    = chunk_bounds(end - begin, parallel_min_lines);
+	size_t nchunks = bounds.size() - 1;
+	std::vector<std::vector<T>> outs(nchunks);
+	std::vector<StringArena> arenas(nchunks);
+	std::vector<std::string> errors(nchunks);
+
+	run_chunks(nchunks, [&](size_t c) {
+		outs[c].reserve(bounds[c + 1] - bounds[c]);
+		for (size_t i = begin + bounds[c]; i < begin + bounds[c + 1]; i++) {
+			char *line = lines[i];
+			while (isspace((uint8_t)*line)) line++;
+			if (!line[0]) continue;
+			parse(line, outs[c], arenas[c], errors[c]);
+		}
+	});
+
+	size_t count = out.size();
+	for (auto &o : outs) count += o.size();
+	out.reserve(count);
+	for (size_t c = 0; c < nchunks; c++) {
+		out.insert(out.end(), outs[c].begin(), outs[c].end());
+		arena.merge(std::move(arenas[c]));
+		if (!errors[c].empty()) error_msg = errors[c]; // Last one, as when parsed in a single pass
+	}
+}
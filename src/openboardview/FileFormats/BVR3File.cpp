@@ -9,114 +9,161 @@
 #include <list>
 #include <algorithm>
 
+namespace {
+
+// Files with more lines than twice this are parsed in parallel chunks
+constexpr size_t parallel_min_lines = 16 * 1024;
+
+// Parts and pins of a range of lines, part indices and end_of_pins relative to the range
+struct Chunk {
+	std::vector<BRDPart> parts;
+	std::vector<BRDPin> pins;
+	std::vector<char *> outline_lines;
+	StringArena arena;
+};
+
+} // namespace
+
 int manhattan_distance(const BRDPoint &p1, const BRDPoint &p2) {
 	return abs(p1.x - p2.x) + abs(p1.y - p2.y);
 }
 
-bool BVR3File::verifyFormat(std::vector<char> &buf) {
-	return find_str_in_buf("BVRAW_FORMAT_3", buf);
-}
-
-BVR3File::BVR3File(std::vector<char> &buf) {
+BVR3File::BVR3File(const BufferSpan &buf) {
 	auto buffer_size = buf.size();
 
 	char *saved_locale = setlocale(LC_NUMERIC, "C"); // Use '.' as delimiter for strtod
 
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
-	// This is for fixing degenerate utf8
-	char *arena     = &file_buf[buffer_size + 1];
-	char *arena_end = file_buf + file_buf_size - 1;
-	*arena_end      = 0;
-
-	BRDPart blank_part;
-	BRDPin blank_pin;
-	BRDPart part;
-	BRDPin pin;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
+
 	std::list<std::pair<BRDPoint, BRDPoint>> outline_segments;
 
 	std::vector<char *> lines;
-	stringfile(file_buf, lines);
+	stringfile(file_buf, buffer_size, lines);
+
+	// Parts are parsed in parallel chunks of lines, split after a PART_END
+	auto bounds = chunk_bounds(lines.size(), parallel_min_lines);
+	for (size_t c = 1; c + 1 < bounds.size(); c++) {
+		size_t &i = bounds[c];
+		i         = std::max(i, bounds[c - 1]);
+		while (i < lines.size()) {
+			char *line = lines[i++];
+			while (isspace((uint8_t)*line)) line++;
+			if (!strcmp(line, "PART_END")) break;
+		}
+	}
+	size_t nchunks = bounds.size() - 1;
+	std::vector<Chunk> chunks(nchunks);
 
-	for (char *line : lines) {
-		while (isspace((uint8_t)*line)) line++;
-		if (!line[0]) continue;
+	run_chunks(nchunks, [&](size_t c) {
+		Chunk &chunk       = chunks[c];
+		StringArena &arena = chunk.arena;
+		BRDPart blank_part;
+		BRDPin blank_pin;
+		BRDPart part;
+		BRDPin pin;
 
-		char *p = line;
-		char *s;
-
-		if (!strncmp(line, "PART_NAME ", 10)) {
-			p += 10;
-			part.name = READ_STR();
-		} else if (!strncmp(line, "PART_SIDE ", 10)) {
-			p += 10;
-			char *side = READ_STR();
-			if (!strcmp(side, "T"))
-				part.mounting_side = BRDPartMountingSide::Top;
-			else if (!strcmp(side, "B"))
-				part.mounting_side = BRDPartMountingSide::Bottom;
-			else if (!strcmp(side, "O"))
-				part.mounting_side = BRDPartMountingSide::Both;
-		} else if (!strncmp(line, "PART_ORIGIN ", 12)) {
-			// Value ignored, used as reference point for relative pin placements, not currently supported
-		} else if (!strncmp(line, "PART_MOUNT ", 11)) {
-			p += 11;
-			char *mount = READ_STR();
-			if (!strcmp(mount, "SMD"))
-				part.part_type = BRDPartType::SMD;
-			else
-				part.part_type = BRDPartType::ThroughHole;
-		} else if (!strncmp(line, "PART_OUTLINE_RELATIVE ", 22)) {
-			// Value ignored, custom outline for parts not yet supported
-		} else if (!strncmp(line, "PIN_ID ", 7)) {
-			// Value ignored, not currently relevant for BRDPin
-		} else if (!strncmp(line, "PIN_NUMBER ", 11)) {
-			p += 11;
-			pin.snum = READ_STR();
-		} else if (!strncmp(line, "PIN_NAME ", 9)) {
-			p += 9;
-			pin.name = READ_STR();
-		} else if (!strncmp(line, "PIN_SIDE ", 9)) {
-			p += 9;
-			char *side = READ_STR();
-			if (!strcmp(side, "T"))
-				pin.side = BRDPinSide::Top;
-			else if (!strcmp(side, "B"))
-				pin.side = BRDPinSide::Bottom;
-			else if (!strcmp(side, "O"))
-				pin.side = BRDPinSide::Both;
-		} else if (!strncmp(line, "PIN_ORIGIN ", 11)) {
-			p += 11;
-			double origin_x = READ_DOUBLE();
-			pin.pos.x = trunc(origin_x);
-			double origin_y = READ_DOUBLE();
-			pin.pos.y = trunc(origin_y);
-		} else if (!strncmp(line, "PIN_RADIUS ", 11)) {
-			p += 11;
-			pin.radius = READ_DOUBLE();
-		} else if (!strncmp(line, "PIN_NET ", 8)) {
-			p += 8;
-			pin.net = READ_STR();
-		} else if (!strncmp(line, "PIN_TYPE ", 9)) {
-			// Value ignored, not currently relevant for BRDPin
-		} else if (!strncmp(line, "PIN_COMMENT ", 12)) {
-			// Value ignored, not currently relevant for BRDPin
-		} else if (!strncmp(line, "PIN_OUTLINE_RELATIVE ", 21)) {
-			// Value ignored, custom outline for pins not yet supported
-		} else if (!strcmp(line, "PIN_END")) {
-			pin.part = parts.size() + 1; // pin is for current part, which will not yet have been added to parts vector
-			pins.push_back(pin);
-			pin = blank_pin;
-		} else if (!strcmp(line, "PART_END")) {
-			part.end_of_pins = pins.size();
+		for (size_t i = bounds[c]; i < bounds[c + 1]; i++) {
+			char *line = lines[i];
+			while (isspace((uint8_t)*line)) line++;
+			if (!line[0]) continue;
+
+			char *p = line;
+			char *s;
+
+			if (!strncmp(line, "PART_NAME ", 10)) {
+				p += 10;
+				part.name = READ_STR();
+			} else if (!strncmp(line, "PART_SIDE ", 10)) {
+				p += 10;
+				char *side = READ_STR();
+				if (!strcmp(side, "T"))
+					part.mounting_side = BRDPartMountingSide::Top;
+				else if (!strcmp(side, "B"))
+					part.mounting_side = BRDPartMountingSide::Bottom;
+				else if (!strcmp(side, "O"))
+					part.mounting_side = BRDPartMountingSide::Both;
+			} else if (!strncmp(line, "PART_ORIGIN ", 12)) {
+				// Value ignored, used as reference point for relative pin placements, not currently supported
+			} else if (!strncmp(line, "PART_MOUNT ", 11)) {
+				p += 11;
+				char *mount = READ_STR();
+				if (!strcmp(mount, "SMD"))
+					part.part_type = BRDPartType::SMD;
+				else
+					part.part_type = BRDPartType::ThroughHole;
+			} else if (!strncmp(line, "PART_OUTLINE_RELATIVE ", 22)) {
+				// Value ignored, custom outline for parts not yet supported
+			} else if (!strncmp(line, "PIN_ID ", 7)) {
+				// Value ignored, not currently relevant for BRDPin
+			} else if (!strncmp(line, "PIN_NUMBER ", 11)) {
+				p += 11;
+				pin.snum = READ_STR();
+			} else if (!strncmp(line, "PIN_NAME ", 9)) {
+				p += 9;
+				pin.name = READ_STR();
+			} else if (!strncmp(line, "PIN_SIDE ", 9)) {
+				p += 9;
+				char *side = READ_STR();
+				if (!strcmp(side, "T"))
+					pin.side = BRDPinSide::Top;
+				else if (!strcmp(side, "B"))
+					pin.side = BRDPinSide::Bottom;
+				else if (!strcmp(side, "O"))
+					pin.side = BRDPinSide::Both;
+			} else if (!strncmp(line, "PIN_ORIGIN ", 11)) {
+				p += 11;
+				double origin_x = READ_DOUBLE();
+				pin.pos.x = trunc(origin_x);
+				double origin_y = READ_DOUBLE();
+				pin.pos.y = trunc(origin_y);
+			} else if (!strncmp(line, "PIN_RADIUS ", 11)) {
+				p += 11;
+				pin.radius = READ_DOUBLE();
+			} else if (!strncmp(line, "PIN_NET ", 8)) {
+				p += 8;
+				pin.net = READ_STR();
+			} else if (!strncmp(line, "PIN_TYPE ", 9)) {
+				// Value ignored, not currently relevant for BRDPin
+			} else if (!strncmp(line, "PIN_COMMENT ", 12)) {
+				// Value ignored, not currently relevant for BRDPin
+			} else if (!strncmp(line, "PIN_OUTLINE_RELATIVE ", 21)) {
+				// Value ignored, custom outline for pins not yet supported
+			} else if (!strcmp(line, "PIN_END")) {
+				pin.part = chunk.parts.size() + 1; // pin is for current part, which will not yet have been added to parts vector
+				chunk.pins.push_back(pin);
+				pin = blank_pin;
+			} else if (!strcmp(line, "PART_END")) {
+				part.end_of_pins = chunk.pins.size();
+				chunk.parts.push_back(part);
+				part = blank_part;
+			} else if (!strncmp(line, "OUTLINE_POINTS ", 15) || !strncmp(line, "OUTLINE_SEGMENTED ", 18)) {
+				chunk.outline_lines.push_back(line); // Segments may span several lines, see below
+			}
+		}
+	});
+
+	// Part and pin indices are relative to their chunk
+	std::vector<char *> outline_lines;
+	for (auto &chunk : chunks) {
+		unsigned int part_offset = parts.size();
+		unsigned int pin_offset  = pins.size();
+		for (auto &part : chunk.parts) {
+			part.end_of_pins += pin_offset;
 			parts.push_back(part);
-			part = blank_part;
-		} else if (!strncmp(line, "OUTLINE_POINTS ", 15)) {
+		}
+		for (auto &pin : chunk.pins) {
+			pin.part += part_offset;
+			pins.push_back(pin);
+		}
+		outline_lines.insert(outline_lines.end(), chunk.outline_lines.begin(), chunk.outline_lines.end());
+		arena.merge(std::move(chunk.arena));
+	}
+
+	for (char *line : outline_lines) {
+		char *p = line;
+
+		if (!strncmp(line, "OUTLINE_POINTS ", 15)) {
 			p += 15;
 			while (p[0]) {
 				auto pold = p;
@@ -3,7 +3,6 @@
 #include "BRDFileBase.h"
 
 struct BVR3File : public BRDFileBase {
-	BVR3File(std::vector<char> &buf);
+	BVR3File(const BufferSpan &buf);
 
-	static bool verifyFormat(std::vector<char> &buf);
 };
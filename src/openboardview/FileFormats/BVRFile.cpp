@@ -17,11 +17,7 @@ char *nextfield(char *p) {
 	return p;
 }
 
-bool BVRFile::verifyFormat(std::vector<char> &buf) {
-	return find_str_in_buf("BVRAW_FORMAT_1", buf);
-}
-
-BVRFile::BVRFile(std::vector<char> &buf) {
+BVRFile::BVRFile(const BufferSpan &buf) {
 	auto buffer_size = buf.size();
 
 	char *saved_locale;
@@ -29,21 +25,12 @@ BVRFile::BVRFile(std::vector<char> &buf) {
 	saved_locale  = setlocale(LC_NUMERIC, "C"); // Use '.' as delimiter for strtod
 
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
-	// This is for fixing degenerate utf8
-	char *arena     = &file_buf[buffer_size + 1];
-	char *arena_end = file_buf + file_buf_size - 1;
-	*arena_end      = 0;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
 
 	int current_block = 0;
 
 	std::vector<char *> lines;
-	stringfile(file_buf, lines);
+	stringfile(file_buf, buffer_size, lines);
 
 	std::vector<char *>::iterator line_it = lines.begin();
 	while (line_it < lines.end()) {
@@ -3,7 +3,6 @@
 #include "BRDFileBase.h"
 
 struct BVRFile : public BRDFileBase {
-	BVRFile(std::vector<char> &buf);
+	BVRFile(const BufferSpan &buf);
 
-	static bool verifyFormat(std::vector<char> &buf);
 };
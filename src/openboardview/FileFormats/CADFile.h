@@ -3,7 +3,7 @@
 #include "BRDFileBase.h"
 
 struct CADFile : public BRDFileBase {
-	CADFile(std::vector<char> &buf);
+	CADFile(const BufferSpan &buf);
 	enum Block {
 		Invalid,
 		None,
@@ -13,7 +13,6 @@ struct CADFile : public BRDFileBase {
 		Vias
 	};
 
-	static bool verifyFormat(std::vector<char> &buf);
 	private:
 		void gen_outline();
 };
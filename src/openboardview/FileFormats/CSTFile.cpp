@@ -61,16 +61,11 @@ std::string read_string(char *&p, int size) {
 	return s;
 }
 
-CSTFile::CSTFile(std::vector<char> &buf) {
+CSTFile::CSTFile(const BufferSpan &buf) {
 	auto buffer_size = buf.size();
 
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
 
 
 	short string_length;
@@ -8,25 +8,25 @@
 #include <cstring>
 #include <iomanip>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <zlib.h>
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) // Runtime dispatch relies on the target attribute
+#define FZFILE_AVX2
+#include <immintrin.h>
+#endif
+
 // Decoding an .fz file. You still need the key of course.
 // https://en.wikipedia.org/wiki/RC6 here you can read it all up.
 
 // Looking at the paper the algo is straight forward, not sure about endianness.
 // This will put out some .bin file you would decompress using zlib.
-// constexpr uint32_t FZFile::key[44];
-uint32_t FZFile::key[44];
 
 #if __cplusplus < 201703L
 constexpr const std::array<uint32_t, 44> FZFile::key_parity;
 #endif
 
-static inline uint32_t rotl32(uint32_t a, int32_t b) {
-	return (a << b) | (a >> (32 - b));
-}
-
 std::string FZFile::fz_key_to_string(const uint32_t fzkey[44]) {
 		std::stringstream sstr;
 		for (size_t i = 0; i < 44; i += 4) {
@@ -53,63 +53,157 @@ bool FZFile::check_fz_key(const uint32_t fzkey[44]) {
 		return valid_key;
 }
 
+namespace {
+
+// Buffers smaller than this are decrypted on the calling thread only
+constexpr size_t decode_parallel_min_chunk = 1024 * 1024;
+// Positions encrypted together, one per SIMD lane
+constexpr size_t decode_lanes = 8;
+
+inline uint32_t rotl32_masked(uint32_t a, uint32_t b) {
+	b &= 31; // As the x86 shift instructions of the original implementation do
+	return (a << b) | (a >> ((32 - b) & 31));
+}
+
+// Little endian words of the blocks made of window[j..j+15], for j in [0, n)
+inline void load_blocks(const uint8_t *window, size_t n, uint32_t (&words)[4][decode_lanes]) {
+	for (size_t j = 0; j < decode_lanes; j++) {
+		const uint8_t *p = window + (j < n ? j : 0);
+		for (size_t w = 0; w < 4; w++) {
+			words[w][j] = p[4 * w] | p[4 * w + 1] << 8 | p[4 * w + 2] << 16 | static_cast<uint32_t>(p[4 * w + 3]) << 24;
+		}
+	}
+}
+
 /*
- * Decrypt an RC6 encrypted buffer using key
+ * Keystream bytes: low byte of A after the RC6 encryption of each block.
+ * Along the lines of http://people.csail.mit.edu/rivest/pubs/RRSY98.pdf (page 3, 2.2), 20 rounds, w = 32
  */
-void FZFile::decode(char *source, size_t size) {
-	// Along the lines of http://people.csail.mit.edu/rivest/pubs/RRSY98.pdf
-	// (page 3, 2.2)
-	int32_t logw = 5;
-	uint32_t r   = 20;
-
-	uint32_t A = 0;
-	uint32_t B = 0;
-	uint32_t C = 0;
-	uint32_t D = 0;
-
-	uint8_t currentByte;
-	uint8_t ibuf[16] = {0}; // you'll see
-
-	// RC6 algo from the paper, basically 1:1
-	for (size_t pos = 0; pos < size; ++pos) {
-		B = B + key[0];
-		D = D + key[1];
-		for (uint32_t i = 1; i < (r + 1); ++i) { // loop offset by 1
-			uint32_t t = rotl32(B * (2 * B + 1), logw);
-			uint32_t u = rotl32(D * (2 * D + 1), logw);
-			A          = rotl32(A ^ t, u) + key[2 * i];
-			C          = rotl32(C ^ u, t) + key[2 * i + 1];
-
-			uint32_t tmp = A;
-			A            = B;
-			B            = C;
-			C            = D;
-			D            = tmp;
+void keystream_scalar(const uint8_t *window, size_t n, const uint32_t key[44], uint8_t *out) {
+	uint32_t v[4][decode_lanes];
+	load_blocks(window, n, v);
+	uint32_t(&A)[decode_lanes] = v[0];
+	uint32_t(&B)[decode_lanes] = v[1];
+	uint32_t(&C)[decode_lanes] = v[2];
+	uint32_t(&D)[decode_lanes] = v[3];
+
+	// Lanes are independent, so the rounds of each interleave with the others
+	for (size_t j = 0; j < decode_lanes; j++) {
+		B[j] += key[0];
+		D[j] += key[1];
+	}
+	for (uint32_t i = 1; i <= 20; ++i) {
+		for (size_t j = 0; j < decode_lanes; j++) {
+			uint32_t t = rotl32_masked(B[j] * (2 * B[j] + 1), 5);
+			uint32_t u = rotl32_masked(D[j] * (2 * D[j] + 1), 5);
+			uint32_t a = rotl32_masked(A[j] ^ t, u) + key[2 * i];
+			uint32_t c = rotl32_masked(C[j] ^ u, t) + key[2 * i + 1];
+			A[j]       = B[j];
+			B[j]       = c;
+			C[j]       = D[j];
+			D[j]       = a;
 		}
-		A = A + key[2 * r + 2];
-		C = C + key[2 * r + 3]; // not used I guess
-
-		// rolling over the the uint8_t string
-		// buf[pos] xor A -> is our resulting byte
-		currentByte = source[pos];
-		source[pos] = ((uint8_t)(currentByte ^ (A & 0xFF)));
-		// fprintf(stdout,"%c",source[pos]);
-
-		// pushing in a stream of buf[pos] chars 'from the right'
-		// and shift whole array 8 bits to the left
-		for (uint32_t i = 0; i < 15; ++i) {
-			ibuf[i] = ibuf[i + 1];
+	}
+	for (size_t j = 0; j < n; j++) out[j] = static_cast<uint8_t>(A[j] + key[42]);
+}
+
+#ifdef FZFILE_AVX2
+__attribute__((target("avx2"))) inline __m256i rotl32_avx2(__m256i a, __m256i b) {
+	b = _mm256_and_si256(b, _mm256_set1_epi32(31));
+	// Variable shifts by 32 give 0, matching rotl32_masked() when b is 0
+	return _mm256_or_si256(_mm256_sllv_epi32(a, b), _mm256_srlv_epi32(a, _mm256_sub_epi32(_mm256_set1_epi32(32), b)));
+}
+
+__attribute__((target("avx2"))) void keystream_avx2(const uint8_t *window, size_t n, const uint32_t key[44], uint8_t *out) {
+	uint32_t v[4][decode_lanes];
+	load_blocks(window, n, v);
+	__m256i A = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v[0]));
+	__m256i B = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v[1]));
+	__m256i C = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v[2]));
+	__m256i D = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v[3]));
+
+	const __m256i one  = _mm256_set1_epi32(1);
+	const __m256i five = _mm256_set1_epi32(5);
+	B                  = _mm256_add_epi32(B, _mm256_set1_epi32(key[0]));
+	D                  = _mm256_add_epi32(D, _mm256_set1_epi32(key[1]));
+	for (uint32_t i = 1; i <= 20; ++i) {
+		__m256i t = rotl32_avx2(_mm256_mullo_epi32(B, _mm256_add_epi32(_mm256_add_epi32(B, B), one)), five);
+		__m256i u = rotl32_avx2(_mm256_mullo_epi32(D, _mm256_add_epi32(_mm256_add_epi32(D, D), one)), five);
+		__m256i a = _mm256_add_epi32(rotl32_avx2(_mm256_xor_si256(A, t), u), _mm256_set1_epi32(key[2 * i]));
+		__m256i c = _mm256_add_epi32(rotl32_avx2(_mm256_xor_si256(C, u), t), _mm256_set1_epi32(key[2 * i + 1]));
+		A         = B;
+		B         = c;
+		C         = D;
+		D         = a;
+	}
+	A = _mm256_add_epi32(A, _mm256_set1_epi32(key[42]));
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(v[0]), A);
+	for (size_t j = 0; j < n; j++) out[j] = static_cast<uint8_t>(v[0][j]);
+}
+#endif
+
+typedef void (*keystream_fn)(const uint8_t *window, size_t n, const uint32_t key[44], uint8_t *out);
+
+keystream_fn select_keystream() {
+#ifdef FZFILE_AVX2
+	if (__builtin_cpu_supports("avx2")) return keystream_avx2;
+#endif
+	return keystream_scalar;
+}
+
+// Decrypts source[begin, end) in place, prev holds the ciphertext bytes right before begin
+void decode_chunk(char *source, size_t begin, size_t end, const std::array<uint8_t, 16> &prev, const uint32_t key[44]) {
+	static const keystream_fn keystream = select_keystream();
+
+	// Ciphertext from 16 bytes before the current batch up to its end, kept aside as the batch is decrypted in place
+	uint8_t window[16 + decode_lanes];
+	uint8_t stream[decode_lanes];
+	std::copy(prev.begin(), prev.end(), window);
+	for (size_t pos = begin; pos < end; pos += decode_lanes) {
+		size_t n = std::min(decode_lanes, end - pos);
+		memcpy(window + 16, source + pos, n);
+		keystream(window, n, key, stream);
+		for (size_t j = 0; j < n; j++) source[pos + j] ^= stream[j];
+		memmove(window, window + n, 16);
+	}
+}
+
+} // namespace
+
+/*
+ * Decrypt an RC6 encrypted buffer using fzkey
+ *
+ * Each byte is XORed with the low byte of the RC6 encryption of the 16 ciphertext bytes before it
+ * (zeroes before the start). The keystream only depends on the ciphertext, so positions are decrypted
+ * in SIMD batches and large buffers in parallel chunks.
+ */
+void FZFile::decode(char *source, size_t size, const uint32_t fzkey[44], unsigned int threads) {
+	size_t nchunks = 1;
+	if (size >= 2 * decode_parallel_min_chunk) {
+		size_t nthreads = std::max(1u, threads ? threads : std::thread::hardware_concurrency());
+		nchunks         = std::min(nthreads, size / decode_parallel_min_chunk);
+	}
+	size_t chunk_size = (size + nchunks - 1) / nchunks;
+
+	// Ciphertext before each chunk, saved before any chunk gets decrypted
+	std::vector<std::array<uint8_t, 16>> prev(nchunks);
+	for (size_t c = 0; c < nchunks; c++) {
+		size_t begin = c * chunk_size;
+		for (size_t k = 0; k < 16; k++) {
+			prev[c][k] = begin + k >= 16 ? static_cast<uint8_t>(source[begin + k - 16]) : 0;
 		}
-		ibuf[15] = currentByte;
-
-		// align 4 consequent int32s to that buffer
-		// (A, B, C, D) = (buf[0], buf[1], buf[2], buf[3])
-		// byte order?!
-		A = ibuf[0] | ibuf[1] << 8 | ibuf[2] << 16 | ibuf[3] << 24;
-		B = ibuf[4] | ibuf[5] << 8 | ibuf[6] << 16 | ibuf[7] << 24;
-		C = ibuf[8] | ibuf[9] << 8 | ibuf[10] << 16 | ibuf[11] << 24;
-		D = ibuf[12] | ibuf[13] << 8 | ibuf[14] << 16 | ibuf[15] << 24;
 	}
+
+	auto decode_part = [&](size_t c) {
+		size_t begin = c * chunk_size;
+		size_t end   = std::min(size, begin + chunk_size);
+		if (begin < end) decode_chunk(source, begin, end, prev[c], fzkey);
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t c = 1; c < nchunks; c++) workers.emplace_back(decode_part, c);
+	decode_part(0);
+	for (auto &w : workers) w.join();
 }
 
 /*
@@ -128,50 +222,50 @@ char *FZFile::split(char *file_buf, size_t buffer_size, size_t &content_size, ch
 }
 
 /*
- * Inflates the zlib compressed data from buffer
+ * Inflates the zlib compressed data from buffer into output, which ends up NUL terminated
+ * Returns the inflated data or nullptr if the stream could not be read at all.
+ * A truncated or corrupt stream gives what could be inflated and sets error_msg.
  */
-char *FZFile::decompress(char *file_buf, size_t buffer_size, size_t &output_size) {
-	output_size = buffer_size;
+char *FZFile::decompress(const char *file_buf, size_t buffer_size, std::vector<char> &output, size_t &output_size,
+                         std::string &error_msg) {
+	output_size = 0;
+	output.clear();
 	if (buffer_size == 0) return nullptr;
 
-	char *output = (char *)calloc(output_size, sizeof(char));
-
 	z_stream zst;
-	zst.next_in   = (Bytef *)file_buf;
-	zst.avail_in  = buffer_size;
-	zst.total_out = 0;
-	zst.zalloc    = Z_NULL;
-	zst.zfree     = Z_NULL;
-
-	if (inflateInit(&zst) != Z_OK) {
-		free(output);
-		return nullptr;
-	}
-
-	int ret;
-	do {
-		// If our output buffer is too small
-		if (zst.total_out >= output_size) {
-			// Increase size of output buffer
-			char *buf = (char *)calloc(output_size + buffer_size / 2, sizeof(char));
-			memcpy(buf, output, output_size);
-			output_size += buffer_size / 2;
-			free(output);
-			output = buf;
-		}
+	zst.next_in  = (Bytef *)file_buf;
+	zst.avail_in = buffer_size;
+	zst.zalloc   = Z_NULL;
+	zst.zfree    = Z_NULL;
+	zst.opaque   = Z_NULL;
 
-		zst.next_out  = (Bytef *)(output + zst.total_out);
-		zst.avail_out = output_size - zst.total_out;
-	} while ((ret = inflate(&zst, Z_SYNC_FLUSH)) == Z_OK);
+	if (inflateInit(&zst) != Z_OK) return nullptr;
 
-	if (ret != Z_STREAM_END) printf("Error %d: %s\n", ret, zst.msg);
+	// Boardview text usually compresses 8 to 10 times, then grow geometrically.
+	// Inflating through a chunk appended to output keeps the room reserved ahead from being zero filled.
+	output.reserve(std::max<size_t>(buffer_size * 8, 64 * 1024) + 1);
+	std::vector<char> chunk(256 * 1024);
 
-	if (inflateEnd(&zst) != Z_OK) {
-		free(output);
-		return nullptr;
+	int ret;
+	do {
+		zst.next_out  = (Bytef *)chunk.data();
+		zst.avail_out = chunk.size();
+		ret           = inflate(&zst, Z_NO_FLUSH);
+		output.insert(output.end(), chunk.data(), chunk.data() + chunk.size() - zst.avail_out);
+	} while (ret == Z_OK);
+
+	if (ret != Z_STREAM_END) {
+		error_msg = "Error " + std::to_string(ret) + " inflating FZ data: " + (zst.msg ? zst.msg : "truncated stream");
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
 	}
 
-	return output;
+	output_size = output.size();
+	output.push_back(0);
+	// The estimate or the last doubling may have left a lot unused, the data is kept as long as the file
+	if (output.capacity() - output.size() > output.size() / 8) output.shrink_to_fit();
+
+	inflateEnd(&zst);
+	return output.data();
 }
 
 /*
@@ -206,7 +300,7 @@ void FZFile::update_counts() {
 	num_nails  = nails.size();
 }
 
-FZFile::FZFile(std::vector<char> &buf, uint32_t fzkey[44]) {
+FZFile::FZFile(const BufferSpan &buf, uint32_t fzkey[44], LoadProgress *progress) {
 	auto buffer_size = buf.size();
 	char *saved_locale;
 	float multiplier = 1.0f;
@@ -220,20 +314,9 @@ FZFile::FZFile(std::vector<char> &buf, uint32_t fzkey[44]) {
 		return;
 	}
 
-	memcpy(key, fzkey, sizeof(key));
-
 
 	ENSURE_OR_FAIL(buffer_size > 4, error_msg, return);
-	size_t file_buf_size = 3 * (1 + buffer_size);
-	file_buf             = (char *)calloc(1, file_buf_size);
-	ENSURE_OR_FAIL(file_buf != nullptr, error_msg, return);
-
-	std::copy(buf.begin(), buf.end(), file_buf);
-	file_buf[buffer_size] = 0;
-	// This is for fixing degenerate utf8
-	char *arena     = &file_buf[buffer_size + 1];
-	char *arena_end = file_buf + file_buf_size - 1;
-	*arena_end      = 0;
+	char *file_buf = buf.data(); // Parsed in place, buf is NUL terminated (see MappedFile)
 
 	/*
 	 * Some non-encrypted, but zip-encoded files are popping up now and then.
@@ -254,8 +337,9 @@ FZFile::FZFile(std::vector<char> &buf, uint32_t fzkey[44]) {
 		 *
 		 * 1 in ~2^16 chance of a false hit.
 		 */
-		FZFile::decode(file_buf, buffer_size); // RC6 decryption
-		                                       // fprintf(stderr,"FZFile:Decoded\n");
+		if (progress) progress->stage = LoadStage::Decrypt;
+		FZFile::decode(file_buf, buffer_size, fzkey); // RC6 decryption
+		                                              // fprintf(stderr,"FZFile:Decoded\n");
 	}
 
 	size_t content_size = 0;
@@ -273,25 +357,38 @@ FZFile::FZFile(std::vector<char> &buf, uint32_t fzkey[44]) {
 
 	ENSURE_OR_FAIL(content != nullptr, error_msg, return);
 	ENSURE_OR_FAIL(content_size > 0, error_msg, return);
-	content = FZFile::decompress(content, content_size, content_size); // decompress zlib content data
-	ENSURE_OR_FAIL(content != nullptr, error_msg, return);
-	ENSURE_OR_FAIL(content_size > 0, error_msg, return);
-
 	ENSURE_OR_FAIL(content != descr, error_msg, return);
 	ENSURE_OR_FAIL(descr_size > 0, error_msg, return);
-	descr = FZFile::decompress(descr, descr_size, descr_size);
+	if (progress) {
+		if (progress->cancelled) return;
+		progress->stage = LoadStage::Decompress;
+	}
+
+	// The description is inflated and split in lines on its own thread while the content is
+	std::vector<char *> lines_descr;
+	std::string descr_error;
+	std::thread descr_worker([&]() {
+		descr = FZFile::decompress(descr, descr_size, descr_buf, descr_size, descr_error);
+		if (descr) stringfile(descr, descr_size, lines_descr);
+	});
+	content = FZFile::decompress(content, content_size, content_buf, content_size, error_msg); // decompress zlib content data
+	std::vector<char *> lines_content;
+	if (content) stringfile(content, content_size, lines_content);
+	descr_worker.join();
+	if (!descr_error.empty()) error_msg = descr_error;
+
+	ENSURE_OR_FAIL(content != nullptr, error_msg, return);
+	ENSURE_OR_FAIL(content_size > 0, error_msg, return);
 	ENSURE_OR_FAIL(descr != nullptr, error_msg, return);
 	ENSURE_OR_FAIL(descr_size > 0, error_msg, return);
+	if (progress) {
+		if (progress->cancelled) return;
+		progress->stage = LoadStage::Parse;
+	}
 
 	int current_block = 0;
 	std::unordered_map<std::string, int> parts_id; // map between part name and part number
 
-	std::vector<char *> lines_content;
-	stringfile(content, lines_content);
-
-	std::vector<char *> lines_descr;
-	stringfile(descr, lines_descr);
-
 	// For some reason, some boards have COMMAs as decimal separators. Will wonders ever cease ( I realise this is a regional thing
 	// )?
 	std::replace(content, content + content_size, ',', '.');
@@ -457,6 +554,6 @@ FZFile::FZFile(std::vector<char> &buf, uint32_t fzkey[44]) {
 	valid = current_block != 0;
 
 	if (!valid) {
-		error_msg += "FZ Key:\n" + fz_key_to_string(key);
+		error_msg += "FZ Key:\n" + fz_key_to_string(fzkey);
 	}
 }
@@ -35,7 +35,7 @@
 		while ((*p) && (*p != '!')) ++p;            \
 		*p = 0;                                     \
 		p++;                                        \
-		return fix_to_utf8(s, &arena, arena_end);   \
+		return fix_to_utf8(s, arena);               \
 	}
 
 /* '\t' is the delimiter for the descr part */
@@ -53,7 +53,7 @@
 		while ((*p) && (*p != '\t')) ++p;                           \
 		*p = 0;                                                     \
 		p++;                                                        \
-		return fix_to_utf8(s, &arena, arena_end);                   \
+		return fix_to_utf8(s, arena);                               \
 	}
 
 struct FZPartDesc {
@@ -66,26 +66,30 @@ struct FZPartDesc {
 
 class FZFile : public BRDFileBase {
   public:
-	FZFile(std::vector<char> &buf, uint32_t fzkey[44]);
+	FZFile(const BufferSpan &buf, uint32_t fzkey[44], LoadProgress *progress = nullptr);
 
 	void SetKey(char *keytext);
 
+	// RC6 decryption of source in place, the same as the original byte at a time loop.
+	// Large buffers are split among threads, one per core when 0.
+	static void decode(char *source, size_t size, const uint32_t fzkey[44], unsigned int threads = 0);
+
   private:
 	std::vector<FZPartDesc> partsDesc;
+	// Inflated content and description, the parsed strings point into them
+	std::vector<char> content_buf;
+	std::vector<char> descr_buf;
 
 	static std::string fz_key_to_string(const uint32_t fzkey[44]);
 	static bool check_fz_key(const uint32_t fzkey[44]);
 
-	static void decode(char *source, size_t size);
 	static char *split(char *file_buf, size_t buffer_size, size_t &content_size, char *&descr, size_t &descr_size);
-	static char *decompress(char *file_buf, size_t buffer_size, size_t &output_size);
+	static char *decompress(const char *file_buf, size_t buffer_size, std::vector<char> &output, size_t &output_size,
+	                        std::string &error_msg);
 	void gen_outline();
 	void update_counts();
 
-	// Put your key here.
+	// The key is passed to the constructor, so that loads on several threads can each use their own
 	// uint32_t keylength = 2*r + 4; // i.e. buf[0..2r+3]
-	// static constexpr uint32_t key[44] = {0};
-	// static uint32_t key[44] = {0};
-	static uint32_t key[44];
 	static constexpr const std::array<uint32_t, 44> key_parity = {{0, 1, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1}};
 };
@@ -0,0 +1,223 @@
+#include "FormatRegistry.h"
+
+#include "ADFile.h"
+#include "ASCFile.h"
+#include "BDVFile.h"
+#include "BRD2File.h"
+#include "BRDAllegroFile.h"
+#include "BRDFile.h"
+#include "BVR3File.h"
+#include "BVRFile.h"
+#include "CADFile.h"
+#include "CSTFile.h"
+#include "FZFile.h"
+#include "GenCADFile.h"
+#include "OBVFile.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+
+const std::vector<FileFormat> &FormatRegistry::formats() {
+	// Signatures found in the header of the file are limited to this many bytes
+	static const size_t header = 64 * 1024;
+
+	// clang-format off
+	static const std::vector<FileFormat> formats = {
+		{"OBV", {".obv"}, {}, {}, OBVFile::verifyFormat,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new OBVFile(buf); }},
+		{"FZ", {".fz"}, {}, {}, nullptr, // Encrypted, trust the extension
+			[](const BufferSpan &buf, const FormatContext &context) -> BRDFileBase * { return new FZFile(buf, context.fzKey, context.progress); }},
+		{"ASC", {".asc", ".bom"}, {}, {}, nullptr, // Several files, trust the extension
+			[](const BufferSpan &buf, const FormatContext &context) -> BRDFileBase * { return new ASCFile(buf, context.filepath); }},
+		{"GenCAD", {}, {{{"GENCAD", header}, {"$BOARD", 0}}, {{"GENCAD", header}, {"$PADS", 0}}}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new GenCADFile(buf); }},
+		{"AD", {}, {{{"|KIND=Protel_Advanced_PCB", 0}}}, {{"Binary", 0}}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new ADFile(buf); }},
+		{"CAD", {}, {{{"###Panel Added", 0}, {"C_PIN", 0}}}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new CADFile(buf); }},
+		{"CST", {".cst"}, {}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new CSTFile(buf); }},
+		{"BRD", {}, {{{"str_length:", 0}, {"var_data:", 0}}}, {}, BRDFile::hasEncodedHeader,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new BRDFile(buf); }},
+		{"BRD2", {}, {{{"BRDOUT:", 0}, {"NETS:", 0}}}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new BRD2File(buf); }},
+		{"BDV", {}, {{{"dd:1.3?,r?-=bb", header}}, {{"<<format.asc>>", 0}, {"<<pins.asc>>", 0}}}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new BDVFile(buf); }},
+		{"BVR", {}, {{{"BVRAW_FORMAT_1", header}}}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new BVRFile(buf); }},
+		{"BVR3", {}, {{{"BVRAW_FORMAT_3", header}}}, {}, nullptr,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new BVR3File(buf); }},
+		{"Allegro", {}, {}, {}, BRDAllegroFile::verifyFormat,
+			[](const BufferSpan &buf, const FormatContext &) -> BRDFileBase * { return new BRDAllegroFile(buf); }},
+	};
+	// clang-format on
+
+	return formats;
+}
+
+namespace {
+
+// Multiple pattern search: a bitmap of the first two bytes of every pattern filters the positions worth a full compare.
+// Only a few short signatures are searched, so this is faster than walking an automaton byte by byte.
+class SignatureMatcher {
+  public:
+	explicit SignatureMatcher(const std::vector<std::string> &patterns) : patterns(patterns) {
+		for (uint32_t id = 0; id < patterns.size(); id++) {
+			uint16_t pair = head(patterns[id].data());
+			filter[pair >> 6] |= uint64_t{1} << (pair & 63);
+			heads.push_back({pair, id});
+		}
+		std::sort(heads.begin(), heads.end());
+	}
+
+	// Calls match(id, pos) for every pattern found at pos with pos in [begin, end).
+	// data[size] must be readable, see BufferSpan.
+	template <class Match>
+	void search(const char *data, size_t size, size_t begin, size_t end, Match match) const {
+		for (size_t i = begin; i < end; i++) {
+			uint16_t pair = head(data + i);
+			if (!(filter[pair >> 6] & (uint64_t{1} << (pair & 63)))) continue;
+			auto range = std::equal_range(heads.begin(), heads.end(), std::make_pair(pair, uint32_t{0}), [](const std::pair<uint16_t, uint32_t> &a, const std::pair<uint16_t, uint32_t> &b) {
+				return a.first < b.first;
+			});
+			for (auto it = range.first; it != range.second; ++it) {
+				const std::string &pattern = patterns[it->second];
+				if (pattern.size() <= size - i && !memcmp(data + i, pattern.data(), pattern.size())) match(it->second, i);
+			}
+		}
+	}
+
+  private:
+	static uint16_t head(const char *p) {
+		return static_cast<uint8_t>(p[0]) | static_cast<uint8_t>(p[1]) << 8;
+	}
+
+	std::vector<std::string> patterns; // At least 2 characters each
+	uint64_t filter[65536 / 64] = {};
+	std::vector<std::pair<uint16_t, uint32_t>> heads; // First two bytes and pattern id, sorted
+};
+
+// Formats of the registry with their signatures as pattern ids
+struct CompiledFormats {
+	struct Format {
+		std::vector<std::vector<uint32_t>> signatures;
+		std::vector<uint32_t> rejects;
+	};
+
+	std::vector<std::string> patterns;
+	std::vector<size_t> prefixes; // Per pattern
+	std::vector<Format> formats;
+	SignatureMatcher matcher;
+
+	CompiledFormats() : matcher(compile()) {}
+
+	uint32_t patternId(const FormatSignature &signature) {
+		for (uint32_t id = 0; id < patterns.size(); id++) {
+			if (patterns[id] == signature.text && prefixes[id] == signature.prefix) return id;
+		}
+		patterns.push_back(signature.text);
+		prefixes.push_back(signature.prefix);
+		return patterns.size() - 1;
+	}
+
+	const std::vector<std::string> &compile() {
+		for (auto &format : FormatRegistry::formats()) {
+			Format compiled;
+			for (auto &group : format.signatures) {
+				compiled.signatures.emplace_back();
+				for (auto &signature : group) compiled.signatures.back().push_back(patternId(signature));
+			}
+			for (auto &signature : format.rejects) compiled.rejects.push_back(patternId(signature));
+			formats.push_back(compiled);
+		}
+		return patterns;
+	}
+};
+
+enum class Outcome { Matched, Rejected, Unknown };
+
+} // namespace
+
+std::vector<FormatScore> FormatRegistry::detect(const BufferSpan &buf, const filesystem::path &filepath) {
+	static const CompiledFormats compiled;
+	static const size_t chunk_size = 64 * 1024; // Outcomes are checked between chunks
+
+	auto &formats = FormatRegistry::formats();
+	std::vector<bool> found(compiled.patterns.size(), false);
+	size_t scanned = 0;
+
+	// Matched by extension or at fixed offsets, no need to look for signatures
+	std::vector<bool> trusted(formats.size(), false);
+	for (size_t i = 0; i < formats.size(); i++) {
+		for (auto &ext : formats[i].extensions) trusted[i] = trusted[i] || check_fileext(filepath, ext);
+		if (!trusted[i] && formats[i].check) trusted[i] = formats[i].check(buf);
+	}
+
+	// Whether the pattern may still be found in the rest of the file
+	auto pending = [&](uint32_t id) {
+		return !found[id] && scanned < buf.size() && (!compiled.prefixes[id] || scanned < compiled.prefixes[id]);
+	};
+	auto outcome = [&](size_t i) {
+		if (trusted[i]) return Outcome::Matched;
+		auto &format = compiled.formats[i];
+		bool rejects_pending = false;
+		for (uint32_t id : format.rejects) {
+			if (found[id]) return Outcome::Rejected;
+			rejects_pending = rejects_pending || pending(id);
+		}
+		bool matched = false, possible = false;
+		for (auto &group : format.signatures) {
+			bool all_found = true, all_possible = true;
+			for (uint32_t id : group) {
+				all_found    = all_found && found[id];
+				all_possible = all_possible && (found[id] || pending(id));
+			}
+			matched  = matched || all_found;
+			possible = possible || all_possible;
+		}
+		if (matched && !rejects_pending) return Outcome::Matched;
+		return possible ? Outcome::Unknown : Outcome::Rejected;
+	};
+	// Done when the first format that is not rejected is matched, or all are rejected
+	auto decided = [&]() {
+		for (size_t i = 0; i < formats.size(); i++) {
+			Outcome o = outcome(i);
+			if (o != Outcome::Rejected) return o == Outcome::Matched;
+		}
+		return true;
+	};
+
+	while (!decided()) {
+		size_t end = std::min(buf.size(), scanned + chunk_size);
+		compiled.matcher.search(buf.data(), buf.size(), scanned, end, [&](uint32_t id, size_t pos) {
+			size_t prefix = compiled.prefixes[id];
+			if (!prefix || pos + compiled.patterns[id].size() <= prefix) found[id] = true;
+		});
+		scanned = end;
+	}
+
+	std::vector<FormatScore> scores;
+	for (size_t i = 0; i < formats.size(); i++) {
+		int confidence = 0;
+		auto &format   = compiled.formats[i];
+		if (outcome(i) == Outcome::Matched) {
+			confidence = 100;
+		} else if (std::none_of(format.rejects.begin(), format.rejects.end(), [&](uint32_t id) { return found[id]; })) {
+			// Partial match, share of the best signature set found
+			for (auto &group : format.signatures) {
+				size_t n   = std::count_if(group.begin(), group.end(), [&](uint32_t id) { return found[id]; });
+				confidence = std::max(confidence, static_cast<int>(n * 100 / group.size()));
+			}
+			confidence = std::min(confidence, 99);
+		}
+		scores.push_back({&formats[i], confidence});
+	}
+	return scores;
+}
+
+const FileFormat *FormatRegistry::best(const std::vector<FormatScore> &scores) {
+	for (auto &score : scores) {
+		if (score.confidence == 100) return score.format;
+	}
+	return nullptr;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "BRDFileBase.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "filesystem_impl.h"
+
+// What a parser may need besides the file content
+struct FormatContext {
+	filesystem::path filepath;
+	uint32_t *fzKey;
+	LoadProgress *progress;
+};
+
+struct FormatSignature {
+	std::string text;
+	size_t prefix; // Only searched in the first prefix bytes of the file, 0 for the whole file
+};
+
+struct FileFormat {
+	const char *name;
+	// Trusted over the content, for encrypted formats and formats spread over several files
+	std::vector<std::string> extensions;
+	// Alternative sets of strings, the file must contain all the strings of one of them
+	std::vector<std::vector<FormatSignature>> signatures;
+	// Strings ruling the format out
+	std::vector<FormatSignature> rejects;
+	// Test at fixed offsets, enough on its own when it succeeds
+	bool (*check)(const BufferSpan &buf);
+	BRDFileBase *(*create)(const BufferSpan &buf, const FormatContext &context);
+};
+
+struct FormatScore {
+	const FileFormat *format;
+	int confidence; // 0 to 100, 100 when the file fully matches the format
+};
+
+/*
+ * Known board file formats, in detection priority order.
+ * All the signatures are searched at once in a single pass over the file,
+ * stopping early when no later match could change the outcome.
+ * Add new formats to the list in FormatRegistry.cpp.
+ */
+class FormatRegistry {
+  public:
+	static const std::vector<FileFormat> &formats();
+
+	// Confidence for every format, in registry order.
+	// The scan may stop once the best format is known, later formats can then be underrated.
+	static std::vector<FormatScore> detect(const BufferSpan &buf, const filesystem::path &filepath);
+
+	// First format with the highest confidence, nullptr if none fully matches
+	static const FileFormat *best(const std::vector<FormatScore> &scores);
+};
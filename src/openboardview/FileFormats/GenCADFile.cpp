@@ -4,23 +4,495 @@
 #include "utils.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <unordered_map>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-bool GenCADFile::verifyFormat(const std::vector<char> &buf) {
-	return find_str_in_buf("GENCAD", buf) && (find_str_in_buf("$BOARD", buf) || find_str_in_buf("$PADS", buf));
+GenCADFile::GenCADFile(const BufferSpan &buf, Parser parser) {
+	if (parser != Parser::Grammar) {
+		valid = parse_file_fast(buf);
+		if (valid || parser == Parser::Fast) return;
+		SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "GenCAD file not handled by the fast parser, trying the grammar");
+	}
+	valid = parse_file(buf);
 }
 
-GenCADFile::GenCADFile(const std::vector<char> &buf) {
-	valid = parse_file(buf);
+namespace {
+
+// Token of a GenCAD line, quoted strings are given without their quotes
+struct GenCADToken {
+	const char *data = nullptr;
+	size_t size      = 0;
+	bool quoted      = false;
+
+	bool empty() const {
+		return !data;
+	}
+	bool is(const char *text) const {
+		return !quoted && size == strlen(text) && !memcmp(data, text, size);
+	}
+	double number() const {
+		return data ? strtod(data, nullptr) : 0.0;
+	}
+	std::string str() const {
+		return std::string(data, size);
+	}
+};
+
+// Splits a GenCAD file in lines and tokens without modifying it, so that the grammar can still parse it afterwards
+class GenCADReader {
+  public:
+	GenCADReader(const char *data, size_t size) : next(data), end(data + size) {}
+
+	// Moves to the next line that is not blank, false at the end of the file
+	bool next_line() {
+		while (next < end) {
+			p        = next;
+			line_end = static_cast<const char *>(memchr(p, '\n', end - p));
+			next     = line_end ? line_end + 1 : end;
+			if (!line_end) line_end = end;
+			if (line_end > p && line_end[-1] == '\r') line_end--;
+			skip_blanks();
+			if (p < line_end) return true;
+		}
+		return false;
+	}
+
+	// Next token of the line, empty at the end of the line
+	GenCADToken token() {
+		GenCADToken t;
+		skip_blanks();
+		if (p >= line_end) return t;
+		if (*p == '"') {
+			const char *close = static_cast<const char *>(memchr(p + 1, '"', line_end - p - 1));
+			if (!close) close = line_end;
+			t.data   = p + 1;
+			t.size   = close - t.data;
+			t.quoted = true;
+			p        = close < line_end ? close + 1 : close;
+		} else {
+			t.data = p;
+			while (p < line_end && *p != ' ' && *p != '\t' && *p != '"') p++;
+			t.size = p - t.data;
+		}
+		return t;
+	}
+
+	// Rest of the line as the grammar's wrapper_to_end: a quoted string, or everything up to the end of the line or a '$'
+	GenCADToken rest() {
+		skip_blanks();
+		if (p < line_end && *p == '"') return token();
+		GenCADToken t;
+		t.data = p;
+		while (p < line_end && *p != '$') p++;
+		t.size = p - t.data;
+		return t;
+	}
+
+  private:
+	void skip_blanks() {
+		while (p < line_end && (*p == ' ' || *p == '\t')) p++;
+	}
+
+	const char *next;
+	const char *end;
+	const char *p        = nullptr;
+	const char *line_end = nullptr;
+};
+
+struct GenCADPadstack {
+	bool drilled = false;
+	bool top     = false;
+	bool bottom  = false;
+};
+
+struct GenCADShapePin {
+	const char *name;
+	GenCADToken pad;
+	BRDPoint pos;
+};
+
+struct GenCADShape {
+	std::vector<GenCADShapePin> pins;
+};
+
+struct GenCADComponent {
+	const char *name;
+	GenCADToken device, layer, shape, mirror, flip;
+	BRDPoint place;
+	bool has_place    = false;
+	bool has_rotation = false;
+	double rotation   = 0.0;
+};
+
+enum class GenCADSection { None, Header, Board, Pads, Padstacks, Shapes, Components, Devices, Signals, Routes, Other };
+
+} // namespace
+
+const char *GenCADFile::copy_string(const char *s, size_t size) {
+	char *copy = arena.allocate(size + 1);
+	memcpy(copy, s, size);
+	copy[size] = 0;
+	return copy;
 }
 
-bool GenCADFile::parse_file(const std::vector<char> &buf) {
+/*
+ * Reads the file line by line and only keeps what the board needs, where the grammar builds a tree of the whole file first.
+ * Signals come after the components in the file, so components are kept aside and their pins placed at the end.
+ * The buffer is left untouched, files this cannot make sense of are left to parse_file().
+ */
+bool GenCADFile::parse_file_fast(const BufferSpan &buf) {
+	GenCADReader reader(buf.data(), buf.size());
+	if (!reader.next_line() || !reader.token().is("$HEADER")) return false;
+
+	GenCADSection section = GenCADSection::Header;
+	std::vector<GenCADSection> found;
+	std::vector<std::pair<BRDPoint, BRDPoint>> outline;
+	bool in_board_item = false; // Geometry of a board CUTOUT, MASK or ARTWORK is not part of the outline
+
+	std::unordered_map<std::string, GenCADPadstack> padstacks;
+	GenCADPadstack *padstack = nullptr;
+	std::unordered_map<std::string, GenCADShape> shapes;
+	GenCADShape *shape = nullptr;
+	std::vector<GenCADComponent> components;
+	std::unordered_map<std::string, const char *> signals; // Component name, NUL, pin name to signal name
+	GenCADToken signal_name;
+	const char *signal = nullptr;
+	GenCADToken route_name;
+	const char *route = nullptr;
+
+	auto read_point = [&](BRDPoint &point) {
+		double x = reader.token().number();
+		double y = reader.token().number();
+		point.x  = board_unit_to_brd_coordinate(x);
+		point.y  = board_unit_to_brd_coordinate(y);
+	};
+
+	m_dimension = INVALID;
+	do {
+		GenCADToken keyword = reader.token();
+		if (!keyword.quoted && keyword.size > 1 && keyword.data[0] == '$') {
+			static const std::pair<const char *, GenCADSection> names[] = {
+			    {"$HEADER", GenCADSection::Header},
+			    {"$BOARD", GenCADSection::Board},
+			    {"$PADS", GenCADSection::Pads},
+			    {"$PADSTACKS", GenCADSection::Padstacks},
+			    {"$SHAPES", GenCADSection::Shapes},
+			    {"$COMPONENTS", GenCADSection::Components},
+			    {"$DEVICES", GenCADSection::Devices},
+			    {"$SIGNALS", GenCADSection::Signals},
+			    {"$ROUTES", GenCADSection::Routes},
+			};
+			section = keyword.size > 4 && !memcmp(keyword.data, "$END", 4) ? GenCADSection::None : GenCADSection::Other;
+			for (auto &name : names) {
+				if (keyword.is(name.first)) section = name.second;
+			}
+			found.push_back(section);
+			continue;
+		}
+
+		switch (section) {
+			case GenCADSection::Header:
+				if (keyword.is("UNITS")) {
+					GenCADToken unit = reader.token();
+					if (unit.is("INCH"))
+						m_dimension = INCH;
+					else if (unit.is("THOU"))
+						m_dimension = THOU;
+					else if (unit.is("MM"))
+						m_dimension = MM;
+					else if (unit.is("MM100"))
+						m_dimension = MM100;
+					else if (unit.is("USER"))
+						m_dimension = USER;
+					else if (unit.is("USERM"))
+						m_dimension = USERCM;
+					else if (unit.is("USERMM"))
+						m_dimension = USERMM;
+					if (m_dimension == USER || m_dimension == USERCM || m_dimension == USERMM)
+						m_dimension_unit = atoi(reader.token().str().c_str());
+				}
+				break;
+
+			case GenCADSection::Board:
+				if (keyword.is("CUTOUT") || keyword.is("MASK") || keyword.is("ARTWORK")) {
+					in_board_item = true;
+				} else if (keyword.is("ATTRIBUTE") || keyword.is("TEXT") || keyword.is("THICKNESS")) {
+					in_board_item = false;
+				} else if (in_board_item) {
+					break;
+				} else if (keyword.is("LINE")) {
+					BRDPoint p1, p2;
+					read_point(p1);
+					read_point(p2);
+					outline.push_back({p1, p2});
+				} else if (keyword.is("RECTANGLE")) {
+					BRDPoint p1;
+					read_point(p1);
+					int w = board_unit_to_brd_coordinate(reader.token().number());
+					int h = board_unit_to_brd_coordinate(reader.token().number());
+					BRDPoint p2{p1.x, p1.y + h}, p3{p1.x + w, p1.y + h}, p4{p1.x + w, p1.y};
+					outline.push_back({p1, p2});
+					outline.push_back({p2, p3});
+					outline.push_back({p3, p4});
+					outline.push_back({p4, p1});
+				} else if (keyword.is("ARC")) {
+					// TODO add support for ellipse arcs (which have arc_p1 and arc_p2)
+					BRDPoint start, stop, center;
+					read_point(start);
+					read_point(stop);
+					read_point(center);
+					auto arc = arc_to_segments(start, stop, center);
+					outline.insert(outline.end(), arc.begin(), arc.end());
+				}
+				break;
+
+			case GenCADSection::Padstacks:
+				if (keyword.is("PADSTACK")) {
+					std::string name = reader.token().str();
+					GenCADPadstack p;
+					p.drilled = reader.token().number() != 0.0;
+					padstack  = &padstacks.emplace(name, p).first->second; // First one wins, as in get_padstack_by_name()
+				} else if (keyword.is("PAD") && padstack) {
+					reader.token(); // Pad name
+					GenCADToken layer = reader.token();
+					padstack->top     = padstack->top || layer.is("TOP");
+					padstack->bottom  = padstack->bottom || layer.is("BOTTOM");
+				}
+				break;
+
+			case GenCADSection::Shapes:
+				if (keyword.is("SHAPE")) {
+					auto inserted = shapes.emplace(reader.token().str(), GenCADShape());
+					shape         = inserted.second ? &inserted.first->second : nullptr; // First one wins
+				} else if (keyword.is("PIN") && shape) {
+					GenCADToken name = reader.token();
+					GenCADShapePin pin;
+					pin.name = copy_string(name.data, name.size);
+					pin.pad  = reader.token();
+					read_point(pin.pos);
+					shape->pins.push_back(pin);
+				}
+				break;
+
+			case GenCADSection::Components:
+				if (keyword.is("COMPONENT")) {
+					GenCADToken name = reader.token();
+					components.emplace_back();
+					components.back().name = copy_string(name.data, name.size);
+				} else if (!components.empty()) {
+					// Only the first of each is used, as with the grammar
+					GenCADComponent &c = components.back();
+					if (keyword.is("DEVICE") && c.device.empty()) {
+						c.device = reader.rest();
+					} else if (keyword.is("PLACE") && !c.has_place) {
+						read_point(c.place);
+						c.has_place = true;
+					} else if (keyword.is("LAYER") && c.layer.empty()) {
+						c.layer = reader.token();
+					} else if (keyword.is("ROTATION") && !c.has_rotation) {
+						c.rotation     = reader.token().number();
+						c.has_rotation = true;
+					} else if (keyword.is("SHAPE") && c.shape.empty()) {
+						c.shape  = reader.token();
+						c.mirror = reader.token();
+						c.flip   = reader.token();
+					}
+				}
+				break;
+
+			case GenCADSection::Signals:
+				if (keyword.is("SIGNAL")) {
+					signal_name = reader.rest();
+					signal      = nullptr;
+				} else if (keyword.is("NODE") && !signal_name.empty()) {
+					if (!signal) signal = copy_string(signal_name.data, signal_name.size);
+					std::string key = reader.token().str();
+					key += '\0';
+					GenCADToken pin = reader.token();
+					key.append(pin.data, pin.size);
+					signals[key] = signal; // Last one wins
+				}
+				break;
+
+			case GenCADSection::Routes:
+				if (keyword.is("ROUTE")) {
+					route_name = reader.rest();
+					route      = nullptr;
+				} else if (keyword.is("VIA") && !route_name.empty()) {
+					if (!route) route = copy_string(route_name.data, route_name.size);
+					reader.token(); // Pad name
+					BRDNail nail{};
+					nail.side  = BRDPartMountingSide::Both;
+					nail.net   = route;
+					nail.probe = 1;
+					read_point(nail.pos);
+					nails.push_back(nail);
+					num_nails++;
+				}
+				break;
+
+			default: break;
+		}
+	} while (reader.next_line());
+
+	// Same required sections as the grammar, which reports the missing one
+	for (auto required : {GenCADSection::Pads,
+	                      GenCADSection::Padstacks,
+	                      GenCADSection::Shapes,
+	                      GenCADSection::Components,
+	                      GenCADSection::Devices,
+	                      GenCADSection::Signals}) {
+		if (std::find(found.begin(), found.end(), required) == found.end()) {
+			nails.clear();
+			num_nails = 0;
+			return false;
+		}
+	}
+
+	outline_segments = std::move(outline);
+
+	auto find_padstack = [&](const GenCADToken &name) -> const GenCADPadstack * {
+		auto it = padstacks.find(name.str());
+		return it != padstacks.end() ? &it->second : nullptr;
+	};
+
+	for (auto &c : components) {
+		BRDPart brd_part;
+		brd_part.name = c.name;
+		if (c.has_place) brd_part.p1 = brd_part.p2 = c.place;
+
+		if (c.layer.is("TOP")) {
+			brd_part.mounting_side = BRDPartMountingSide::Top;
+		} else if (c.layer.is("BOTTOM")) {
+			brd_part.mounting_side = BRDPartMountingSide::Bottom;
+		}
+
+		if (!c.device.empty()) {
+			// workaround for RSI-TRANSLATOR CAMCAD bad COMPONENT -> DEVICE references
+			brd_part.mfgcode = c.device.str();
+			std::replace(brd_part.mfgcode.begin(), brd_part.mfgcode.end(), ' ', '_');
+		}
+
+		if (c.shape.size) {
+			if (!brd_part.mfgcode.empty()) {
+				brd_part.mfgcode += " SHAPE ";
+			}
+			brd_part.mfgcode += c.shape.str();
+
+			auto found_shape = shapes.find(c.shape.str());
+			if (found_shape != shapes.end()) {
+				auto &shape_pins = found_shape->second.pins;
+
+				bool smd = std::none_of(shape_pins.begin(), shape_pins.end(), [&](const GenCADShapePin &pin) {
+					auto p = find_padstack(pin.pad);
+					return p && p->drilled;
+				});
+				brd_part.part_type = smd ? BRDPartType::SMD : BRDPartType::ThroughHole;
+
+				// Same placement as parse_shape_pins_to_component()
+				double rotation_in_rads = (c.rotation * (M_PI / 180.0));
+				int mirror_x_sign       = c.mirror.is("MIRRORX") ? (-1) : 1;
+				int mirror_y_sign       = c.mirror.is("MIRRORY") ? (-1) : 1;
+				bool flip               = c.flip.is("FLIP");
+				if (mirror_x_sign * mirror_y_sign == -1) // exatly one mirror
+				{
+					rotation_in_rads = M_PI - rotation_in_rads;
+				}
+				double cos_ = cos(rotation_in_rads);
+				double sin_ = sin(rotation_in_rads);
+
+				std::string key = brd_part.name;
+				key += '\0';
+				size_t key_size = key.size();
+
+				for (auto &shape_pin : shape_pins) {
+					BRDPin pin;
+					pin.radius = 0.5;
+					pin.part   = static_cast<unsigned int>(parts.size() + 1);
+					pin.pos.x  = brd_part.p1.x;
+					pin.pos.y  = brd_part.p1.y;
+					pin.snum   = shape_pin.name;
+
+					pin.pos.x += mirror_x_sign * (shape_pin.pos.x * cos_ - shape_pin.pos.y * sin_);
+					pin.pos.y += mirror_y_sign * (shape_pin.pos.x * sin_ + shape_pin.pos.y * cos_);
+
+					key.resize(key_size);
+					key += shape_pin.name;
+					auto found_signal = signals.find(key);
+					if (found_signal != signals.end()) {
+						pin.net = found_signal->second;
+					} else {
+						char *tmp = arena.allocate(32);
+						snprintf(tmp, 32, "NC@%d", nc_counter);
+						pin.net = tmp;
+						nc_counter++;
+					}
+
+					// As in parse_shape_pins_to_component(), quoted pad names are not looked up
+					const GenCADPadstack *p = shape_pin.pad.quoted ? nullptr : find_padstack(shape_pin.pad);
+					if (p) {
+						if (p->top && p->bottom) {
+							pin.side = BRDPinSide::Both;
+						} else if (p->top) {
+							pin.side = BRDPinSide::Top;
+						} else if (p->bottom) {
+							pin.side = BRDPinSide::Bottom;
+						} else {
+							// Inner layers only not handled, might still be useful so show on both sides as well
+							pin.side = BRDPinSide::Both;
+						}
+					} else {
+						switch (brd_part.mounting_side) {
+							case BRDPartMountingSide::Top:    pin.side = BRDPinSide::Top;    break;
+							case BRDPartMountingSide::Bottom: pin.side = BRDPinSide::Bottom; break;
+							case BRDPartMountingSide::Both:   pin.side = BRDPinSide::Both;   break;
+						}
+					}
+
+					// Flipped shape also flips pin side
+					if (flip) {
+						if (pin.side == BRDPinSide::Top) {
+							pin.side = BRDPinSide::Bottom;
+						} else if (pin.side == BRDPinSide::Bottom) {
+							pin.side = BRDPinSide::Top;
+						}
+					}
+
+					pins.push_back(pin);
+					num_pins++;
+				}
+
+				if (brd_part.part_type == BRDPartType::ThroughHole) {
+					brd_part.mounting_side = BRDPartMountingSide::Both;
+				}
+				brd_part.end_of_pins = num_pins - 1;
+			}
+		}
+		parts.push_back(brd_part);
+		num_parts++;
+	}
+
+	for (auto i = 1; i <= 2; i++) { // Add dummy parts for probe points on both sides
+		BRDPart part;
+		part.name = "...";
+		part.mounting_side =
+		    (i == 1 ? BRDPartMountingSide::Bottom : BRDPartMountingSide::Top); // First part is bottom, last is top.
+		part.end_of_pins = 0;                                                  // Unused
+		parts.push_back(part);
+	}
+
+	AddNailsAsPins();
+	return true;
+}
+
+bool GenCADFile::parse_file(const BufferSpan &buf) {
 	bool ret = false;
 #define X(CVAR, NAME) mpc_parser_t *CVAR = mpc_new((NAME));
 	X_MACRO_PARSE_VARS
@@ -468,6 +940,12 @@ std::vector<std::pair<BRDPoint, BRDPoint>> GenCADFile::arc_to_segments(mpc_ast_t
 
 	if (!x_y_ref_to_brd_point(center, &pc)) return arc_segments;
 
+	return arc_to_segments(p1, p2, pc);
+}
+
+std::vector<std::pair<BRDPoint, BRDPoint>> GenCADFile::arc_to_segments(BRDPoint p1, BRDPoint p2, BRDPoint pc) {
+	std::vector<std::pair<BRDPoint, BRDPoint>> arc_segments{};
+
 	double r = distance(p1, pc);
 
 	double startAngle = atan2(p1.y - pc.y, p1.x - pc.x);
@@ -20,9 +20,11 @@ enum ParseVarsCounterEnum {
 
 class GenCADFile : public BRDFileBase {
   public:
-	static bool verifyFormat(const std::vector<char> &buf);
 
-	GenCADFile(const std::vector<char> &buf);
+	// Parsers tried on the file, the grammar only runs on the files the fast one rejects unless asked for
+	enum class Parser { Any, Fast, Grammar };
+
+	GenCADFile(const BufferSpan &buf, Parser parser = Parser::Any);
 
 	enum Dimension {
 		INCH,   // Inches.
@@ -38,11 +40,15 @@ class GenCADFile : public BRDFileBase {
   private:
 	enum Dimension m_dimension = INCH;
 	int m_dimension_unit       = 0;
-	bool parse_file(const std::vector<char> &buf);
+	bool parse_file(const BufferSpan &buf);
+	// Hand-written single pass parser, parse_file() and its grammar only handle the files it rejects
+	bool parse_file_fast(const BufferSpan &buf);
+	const char *copy_string(const char *s, size_t size);
 
 	bool parse_dimension_units(mpc_ast_t *header_ast);
 	bool parse_board_outline(mpc_ast_t *board_ast);
 	std::vector<std::pair<BRDPoint, BRDPoint>> arc_to_segments(mpc_ast_t *start, mpc_ast_t *stop, mpc_ast_t *center);
+	std::vector<std::pair<BRDPoint, BRDPoint>> arc_to_segments(BRDPoint p1, BRDPoint p2, BRDPoint pc);
 	bool parse_vias(mpc_ast_t *routes_ast);
 	bool parse_route_vias(mpc_ast_t *route_ast);
 	bool parse_components();
@@ -0,0 +1,388 @@
+#include "OBVCacheFile.h"
+
+#include "utils.h"
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+constexpr uint32_t OBVCacheFile::version;
+
+namespace {
+
+/*
+ * On-disk layout, little-endian:
+ * header, format points, outline segments, parts, pins, nails then the NUL separated string table.
+ * Strings are stored as offsets in the string table, no_string stands for nullptr.
+ */
+constexpr char cache_magic[8] = {'O', 'B', 'V', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t no_string  = UINT32_MAX;
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t file_size;
+	int64_t mtime;
+	uint64_t content_hash;
+	uint32_t num_format, num_parts, num_pins, num_nails; // BRDFileBase counters
+	uint32_t format_count, outline_count, parts_count, pins_count, nails_count;
+	uint32_t padding;
+	uint64_t strings_size;
+};
+
+struct CachePoint {
+	int32_t x, y;
+};
+
+struct CachePart {
+	uint32_t name, mfgcode;
+	uint8_t mounting_side, part_type, padding[2];
+	uint32_t end_of_pins;
+	CachePoint p1, p2;
+};
+
+struct CachePin {
+	CachePoint pos;
+	int32_t probe;
+	uint32_t part;
+	uint8_t side, padding[3];
+	uint32_t net;
+	double radius;
+	uint32_t snum, name;
+};
+
+struct CacheNail {
+	uint32_t probe;
+	CachePoint pos;
+	uint8_t side, padding[3];
+	uint32_t net;
+};
+
+static_assert(sizeof(CacheHeader) == 88, "CacheHeader layout changed");
+static_assert(sizeof(CachePart) == 32, "CachePart layout changed");
+static_assert(sizeof(CachePin) == 40, "CachePin layout changed");
+static_assert(sizeof(CacheNail) == 20, "CacheNail layout changed");
+
+class StringTable {
+  public:
+	uint32_t intern(const char *s) {
+		if (!s) return no_string;
+		auto it = offsets.find(s);
+		if (it != offsets.end()) return it->second;
+		uint32_t offset = data.size();
+		data.append(s, strlen(s) + 1);
+		offsets.emplace(s, offset);
+		return offset;
+	}
+	std::string data;
+
+  private:
+	std::unordered_map<std::string, uint32_t> offsets;
+};
+
+inline uint64_t rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+template <typename T>
+void write_records(std::ofstream &out, const std::vector<T> &records) {
+	out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T));
+}
+
+// Stores the size and mtime of key in the header of an existing cache, the rest of the file is left as is
+bool rewrite_key(const filesystem::path &cachepath, const OBVCacheKey &key, std::string &error_msg) {
+	std::fstream file(cachepath.string(), std::ios::in | std::ios::out | std::ios::binary);
+	CacheHeader header;
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || memcmp(header.magic, cache_magic, sizeof(cache_magic))) {
+		error_msg = "Cannot update board cache " + cachepath.string();
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
+		return false;
+	}
+	header.file_size = key.file_size;
+	header.mtime     = key.mtime;
+	file.seekp(0);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	ENSURE_OR_FAIL(file.good(), error_msg, return false);
+	return true;
+}
+
+} // namespace
+
+/*
+ * 64-bit content hash, four independent multiply-rotate lanes over 32 byte blocks.
+ * Only needs to tell two versions of a board apart, not to be cryptographically strong.
+ */
+uint64_t OBVCacheFile::hash(const char *data, size_t size) {
+	const uint64_t p1 = 0x9E3779B185EBCA87ull;
+	const uint64_t p2 = 0xC2B2AE3D27D4EB4Full;
+	uint64_t lanes[4] = {p1 + p2, p2, 0, 0 - p1};
+	size_t i          = 0;
+	for (; i + 32 <= size; i += 32) {
+		for (int l = 0; l < 4; l++) {
+			uint64_t w;
+			memcpy(&w, data + i + 8 * l, sizeof(w));
+			lanes[l] = rotl64(lanes[l] + w * p2, 31) * p1;
+		}
+	}
+	uint64_t h = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+	h += size;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t w;
+		memcpy(&w, data + i, sizeof(w));
+		h = rotl64(h ^ (rotl64(w * p2, 31) * p1), 27) * p1;
+	}
+	for (; i < size; i++) {
+		h = rotl64(h ^ (static_cast<uint8_t>(data[i]) * p1), 11) * p2;
+	}
+	// Final avalanche
+	h ^= h >> 33;
+	h *= p2;
+	h ^= h >> 29;
+	h *= p1;
+	h ^= h >> 32;
+	return h;
+}
+
+filesystem::path OBVCacheFile::cachePath(const filesystem::path &cachedir, const filesystem::path &filepath) {
+	std::error_code ec;
+	std::string abspath = filesystem::absolute(filepath, ec).string();
+	if (ec) abspath = filepath.string();
+
+	std::stringstream name;
+	name << std::setfill('0') << std::setw(16) << std::hex << hash(abspath.data(), abspath.size()) << ".obvcache";
+	return cachedir / name.str();
+}
+
+OBVCacheKey OBVCacheFile::key(const filesystem::path &filepath, const BufferSpan &buf) {
+	OBVCacheKey key;
+	std::error_code ec;
+	key.file_size = buf.size();
+	auto mtime    = filesystem::last_write_time(filepath, ec);
+	if (!ec) key.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+	return key;
+}
+
+OBVCacheFile::OBVCacheFile(const filesystem::path &cachepath, OBVCacheKey &key, const BufferSpan &buf) {
+	std::error_code ec;
+	if (!filesystem::is_regular_file(cachepath, ec)) return;
+
+	MappedFile source;
+	if (!source.open(cachepath, error_msg)) return;
+	const char *p   = source.data();
+	const char *end = p + source.size();
+
+	CacheHeader header;
+	if (source.size() < sizeof(header)) return;
+	memcpy(&header, p, sizeof(header));
+	p += sizeof(header);
+	if (memcmp(header.magic, cache_magic, sizeof(cache_magic)) || header.version != version) return;
+	if (header.file_size != key.file_size) return;
+	bool touched = header.mtime != key.mtime;
+	if (touched) {
+		// Touched or copied, still valid if the content did not change
+		if (!key.content_hash) key.content_hash = hash(buf.data(), buf.size());
+		if (header.content_hash != key.content_hash) return;
+	}
+	key.content_hash = header.content_hash;
+
+	uint64_t expected_size = sizeof(header) + uint64_t(header.format_count) * sizeof(CachePoint) +
+	                         uint64_t(header.outline_count) * 2 * sizeof(CachePoint) + uint64_t(header.parts_count) * sizeof(CachePart) +
+	                         uint64_t(header.pins_count) * sizeof(CachePin) + uint64_t(header.nails_count) * sizeof(CacheNail) +
+	                         header.strings_size;
+	ENSURE_OR_FAIL(expected_size == source.size(), error_msg, return);
+	ENSURE_OR_FAIL(header.strings_size > 0 && end[-1] == '\0', error_msg, return);
+
+	const char *strings = end - header.strings_size;
+	bool strings_ok     = true;
+	auto string_at      = [&](uint32_t offset) -> const char * {
+		if (offset == no_string) return nullptr;
+		if (offset >= header.strings_size) {
+			strings_ok = false;
+			return "";
+		}
+		return strings + offset;
+	};
+	// BRDBoard trusts the enums and indexes its components with pin.part, a cache with values out of range is a miss too
+	bool values_ok = true;
+	auto enum_at   = [&](uint8_t value, uint8_t count) -> uint8_t {
+		if (value < count) return value;
+		values_ok = false;
+		return 0;
+	};
+
+	format.resize(header.format_count);
+	for (auto &point : format) {
+		CachePoint cp;
+		memcpy(&cp, p, sizeof(cp));
+		p += sizeof(cp);
+		point = {cp.x, cp.y};
+	}
+
+	outline_segments.resize(header.outline_count);
+	for (auto &segment : outline_segments) {
+		CachePoint cp[2];
+		memcpy(cp, p, sizeof(cp));
+		p += sizeof(cp);
+		segment = {{cp[0].x, cp[0].y}, {cp[1].x, cp[1].y}};
+	}
+
+	parts.resize(header.parts_count);
+	for (auto &part : parts) {
+		CachePart cp;
+		memcpy(&cp, p, sizeof(cp));
+		p += sizeof(cp);
+		part.name          = string_at(cp.name);
+		const char *mfg    = string_at(cp.mfgcode);
+		part.mfgcode       = mfg ? mfg : "";
+		part.mounting_side = static_cast<BRDPartMountingSide>(enum_at(cp.mounting_side, 3));
+		part.part_type     = static_cast<BRDPartType>(enum_at(cp.part_type, 2));
+		part.end_of_pins   = cp.end_of_pins;
+		part.p1            = {cp.p1.x, cp.p1.y};
+		part.p2            = {cp.p2.x, cp.p2.y};
+	}
+
+	pins.resize(header.pins_count);
+	for (auto &pin : pins) {
+		CachePin cp;
+		memcpy(&cp, p, sizeof(cp));
+		p += sizeof(cp);
+		pin.pos    = {cp.pos.x, cp.pos.y};
+		pin.probe  = cp.probe;
+		pin.part   = cp.part;
+		pin.side   = static_cast<BRDPinSide>(enum_at(cp.side, 3));
+		pin.net    = string_at(cp.net);
+		pin.radius = cp.radius;
+		pin.snum   = string_at(cp.snum);
+		pin.name   = string_at(cp.name);
+		if (pin.part == 0 || pin.part > header.parts_count) values_ok = false;
+	}
+
+	nails.resize(header.nails_count);
+	for (auto &nail : nails) {
+		CacheNail cn;
+		memcpy(&cn, p, sizeof(cn));
+		p += sizeof(cn);
+		nail.probe = cn.probe;
+		nail.pos   = {cn.pos.x, cn.pos.y};
+		nail.side  = static_cast<BRDPartMountingSide>(enum_at(cn.side, 3));
+		nail.net   = string_at(cn.net);
+	}
+	ENSURE_OR_FAIL(strings_ok, error_msg, return);
+	ENSURE_OR_FAIL(values_ok, error_msg, return);
+
+	num_format = header.num_format;
+	num_parts  = header.num_parts;
+	num_pins   = header.num_pins;
+	num_nails  = header.num_nails;
+
+	AttachSource(std::move(source));
+	valid = true;
+
+	// Hashing again on every open is only needed once
+	if (touched) {
+		std::string key_error;
+		rewrite_key(cachepath, key, key_error);
+	}
+}
+
+bool OBVCacheFile::write(const BRDFileBase &file, const filesystem::path &cachepath, const OBVCacheKey &key, std::string &error_msg) {
+	StringTable strings;
+
+	std::vector<CachePoint> cformat;
+	cformat.reserve(file.format.size());
+	for (auto &point : file.format) cformat.push_back({point.x, point.y});
+
+	std::vector<CachePoint> coutline;
+	coutline.reserve(2 * file.outline_segments.size());
+	for (auto &segment : file.outline_segments) {
+		coutline.push_back({segment.first.x, segment.first.y});
+		coutline.push_back({segment.second.x, segment.second.y});
+	}
+
+	std::vector<CachePart> cparts(file.parts.size());
+	for (size_t i = 0; i < file.parts.size(); i++) {
+		auto &part              = file.parts[i];
+		cparts[i].name          = strings.intern(part.name);
+		cparts[i].mfgcode       = strings.intern(part.mfgcode.c_str());
+		cparts[i].mounting_side = static_cast<uint8_t>(part.mounting_side);
+		cparts[i].part_type     = static_cast<uint8_t>(part.part_type);
+		cparts[i].end_of_pins   = part.end_of_pins;
+		cparts[i].p1            = {part.p1.x, part.p1.y};
+		cparts[i].p2            = {part.p2.x, part.p2.y};
+	}
+
+	std::vector<CachePin> cpins(file.pins.size());
+	for (size_t i = 0; i < file.pins.size(); i++) {
+		auto &pin       = file.pins[i];
+		cpins[i].pos    = {pin.pos.x, pin.pos.y};
+		cpins[i].probe  = pin.probe;
+		cpins[i].part   = pin.part;
+		cpins[i].side   = static_cast<uint8_t>(pin.side);
+		cpins[i].net    = strings.intern(pin.net);
+		cpins[i].radius = pin.radius;
+		cpins[i].snum   = strings.intern(pin.snum);
+		cpins[i].name   = strings.intern(pin.name);
+	}
+
+	std::vector<CacheNail> cnails(file.nails.size());
+	for (size_t i = 0; i < file.nails.size(); i++) {
+		auto &nail      = file.nails[i];
+		cnails[i].probe = nail.probe;
+		cnails[i].pos   = {nail.pos.x, nail.pos.y};
+		cnails[i].side  = static_cast<uint8_t>(nail.side);
+		cnails[i].net   = strings.intern(nail.net);
+	}
+	strings.intern(""); // Never empty, so the table always ends with a NUL
+
+	CacheHeader header{};
+	memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version       = version;
+	header.file_size     = key.file_size;
+	header.mtime         = key.mtime;
+	header.content_hash  = key.content_hash;
+	header.num_format    = file.num_format;
+	header.num_parts     = file.num_parts;
+	header.num_pins      = file.num_pins;
+	header.num_nails     = file.num_nails;
+	header.format_count  = cformat.size();
+	header.outline_count = file.outline_segments.size();
+	header.parts_count   = cparts.size();
+	header.pins_count    = cpins.size();
+	header.nails_count   = cnails.size();
+	header.strings_size  = strings.data.size();
+
+	std::error_code ec;
+	filesystem::create_directories(cachepath.parent_path(), ec);
+
+	// Write to a temporary file first so a partially written cache is never picked up
+	filesystem::path tmppath = cachepath;
+	tmppath += ".tmp";
+	{
+		std::ofstream out(tmppath.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			error_msg = "Cannot write board cache " + tmppath.string();
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
+			return false;
+		}
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		write_records(out, cformat);
+		write_records(out, coutline);
+		write_records(out, cparts);
+		write_records(out, cpins);
+		write_records(out, cnails);
+		out.write(strings.data.data(), strings.data.size());
+		ENSURE_OR_FAIL(out.good(), error_msg, filesystem::remove(tmppath, ec); return false);
+	}
+
+	filesystem::rename(tmppath, cachepath, ec);
+	if (ec) {
+		error_msg = "Cannot write board cache " + cachepath.string() + ": " + ec.message();
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
+		filesystem::remove(tmppath, ec);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "BRDFileBase.h"
+
+#include <cstdint>
+
+#include "filesystem_impl.h"
+
+// Identifies the board file a cache was built from
+struct OBVCacheKey {
+	uint64_t file_size    = 0;
+	int64_t mtime         = 0;
+	uint64_t content_hash = 0; // 0 until computed, see OBVCacheFile::hash()
+};
+
+/*
+ * Binary cache of a parsed board (.obvcache).
+ * Stores the BRDFileBase result (format, outline, parts, pins, nails) with interned strings,
+ * so reopening an unchanged board maps the cache instead of detecting, decoding and parsing it again.
+ */
+class OBVCacheFile : public BRDFileBase {
+  public:
+	// Bump whenever the cache layout or the output of a parser changes
+	static constexpr uint32_t version = 1;
+
+	// Loads the cache if it was built from the board file identified by key, valid is false otherwise.
+	// buf is the untouched content of the board file, only hashed when the mtime differs.
+	// A cache found valid that way gets the new mtime, so that the next load does not hash again.
+	OBVCacheFile(const filesystem::path &cachepath, OBVCacheKey &key, const BufferSpan &buf);
+
+	static bool write(const BRDFileBase &file, const filesystem::path &cachepath, const OBVCacheKey &key, std::string &error_msg);
+
+	// Cache file for filepath in cachedir
+	static filesystem::path cachePath(const filesystem::path &cachedir, const filesystem::path &filepath);
+	// Size and mtime of filepath, the content hash is computed on demand
+	static OBVCacheKey key(const filesystem::path &filepath, const BufferSpan &buf);
+	static uint64_t hash(const char *data, size_t size);
+};
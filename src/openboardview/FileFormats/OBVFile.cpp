@@ -0,0 +1,351 @@
+#include "OBVFile.h"
+
+#include "utils.h"
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <unordered_map>
+#include <zlib.h>
+
+constexpr uint32_t OBVFile::version;
+
+namespace {
+
+/*
+ * On-disk layout, little-endian:
+ * header, then the payload, deflated when flag_compressed is set.
+ * The payload is made of the columns listed in NativeColumns, each 8 byte aligned, and ends with the NUL separated string table.
+ * Strings are stored as offsets in the string table, no_string stands for nullptr.
+ */
+constexpr char native_magic[8]     = {'O', 'B', 'V', 'B', 'O', 'A', 'R', 'D'};
+constexpr uint32_t flag_compressed = 1;
+constexpr uint32_t no_string       = UINT32_MAX;
+
+// Deflate cannot shrink data more than about 1032 to 1, larger payload sizes in a header are bogus
+constexpr uint64_t max_deflate_ratio = 1032;
+
+struct NativeHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+	uint32_t num_format, num_parts, num_pins, num_nails; // BRDFileBase counters
+	uint32_t format_count, outline_count, parts_count, pins_count, nails_count;
+	uint32_t reserved;
+	uint64_t strings_size;
+	uint64_t payload_size; // Uncompressed
+	uint64_t stored_size;  // Bytes following the header
+};
+
+static_assert(sizeof(NativeHeader) == 80, "NativeHeader layout changed");
+
+// Offsets of the columns in the payload
+struct NativeColumns {
+	uint64_t format_x, format_y;
+	uint64_t outline_x1, outline_y1, outline_x2, outline_y2;
+	uint64_t part_name, part_mfgcode, part_mounting_side, part_type, part_end_of_pins, part_p1_x, part_p1_y, part_p2_x, part_p2_y;
+	uint64_t pin_x, pin_y, pin_probe, pin_part, pin_side, pin_net, pin_radius, pin_snum, pin_name;
+	uint64_t nail_probe, nail_x, nail_y, nail_side, nail_net;
+	uint64_t strings;
+	uint64_t size;
+
+	explicit NativeColumns(const NativeHeader &h) {
+		uint64_t offset = 0;
+		auto column     = [&](uint64_t count, size_t size) {
+			uint64_t begin = offset;
+			offset         = (offset + count * size + 7) & ~uint64_t{7};
+			return begin;
+		};
+
+		format_x = column(h.format_count, sizeof(int32_t));
+		format_y = column(h.format_count, sizeof(int32_t));
+
+		outline_x1 = column(h.outline_count, sizeof(int32_t));
+		outline_y1 = column(h.outline_count, sizeof(int32_t));
+		outline_x2 = column(h.outline_count, sizeof(int32_t));
+		outline_y2 = column(h.outline_count, sizeof(int32_t));
+
+		part_name          = column(h.parts_count, sizeof(uint32_t));
+		part_mfgcode       = column(h.parts_count, sizeof(uint32_t));
+		part_mounting_side = column(h.parts_count, sizeof(uint8_t));
+		part_type          = column(h.parts_count, sizeof(uint8_t));
+		part_end_of_pins   = column(h.parts_count, sizeof(uint32_t));
+		part_p1_x          = column(h.parts_count, sizeof(int32_t));
+		part_p1_y          = column(h.parts_count, sizeof(int32_t));
+		part_p2_x          = column(h.parts_count, sizeof(int32_t));
+		part_p2_y          = column(h.parts_count, sizeof(int32_t));
+
+		pin_x      = column(h.pins_count, sizeof(int32_t));
+		pin_y      = column(h.pins_count, sizeof(int32_t));
+		pin_probe  = column(h.pins_count, sizeof(int32_t));
+		pin_part   = column(h.pins_count, sizeof(uint32_t));
+		pin_side   = column(h.pins_count, sizeof(uint8_t));
+		pin_net    = column(h.pins_count, sizeof(uint32_t));
+		pin_radius = column(h.pins_count, sizeof(double));
+		pin_snum   = column(h.pins_count, sizeof(uint32_t));
+		pin_name   = column(h.pins_count, sizeof(uint32_t));
+
+		nail_probe = column(h.nails_count, sizeof(uint32_t));
+		nail_x     = column(h.nails_count, sizeof(int32_t));
+		nail_y     = column(h.nails_count, sizeof(int32_t));
+		nail_side  = column(h.nails_count, sizeof(uint8_t));
+		nail_net   = column(h.nails_count, sizeof(uint32_t));
+
+		strings = offset;
+		size    = strings + h.strings_size;
+	}
+};
+
+template <typename T>
+void put(std::vector<char> &payload, uint64_t column, size_t i, T value) {
+	memcpy(payload.data() + column + i * sizeof(T), &value, sizeof(T));
+}
+
+template <typename T>
+T get(const char *payload, uint64_t column, size_t i) {
+	T value;
+	memcpy(&value, payload + column + i * sizeof(T), sizeof(T));
+	return value;
+}
+
+class StringTable {
+  public:
+	uint32_t intern(const char *s) {
+		if (!s) return no_string;
+		auto it = offsets.find(s);
+		if (it != offsets.end()) return it->second;
+		uint32_t offset = data.size();
+		data.append(s, strlen(s) + 1);
+		offsets.emplace(s, offset);
+		return offset;
+	}
+	std::string data;
+
+  private:
+	std::unordered_map<std::string, uint32_t> offsets;
+};
+
+} // namespace
+
+bool OBVFile::verifyFormat(const BufferSpan &buf) {
+	return buf.size() >= sizeof(NativeHeader) && !memcmp(buf.data(), native_magic, sizeof(native_magic));
+}
+
+OBVFile::OBVFile(const BufferSpan &buf) {
+	NativeHeader header;
+	ENSURE_OR_FAIL(verifyFormat(buf), error_msg, return);
+	memcpy(&header, buf.data(), sizeof(header));
+	if (header.version != version) {
+		error_msg = "Unsupported native board version " + std::to_string(header.version) + ", expected " + std::to_string(version);
+		return;
+	}
+
+	NativeColumns columns(header);
+	ENSURE_OR_FAIL(header.payload_size == columns.size, error_msg, return);
+	ENSURE_OR_FAIL(header.stored_size == buf.size() - sizeof(header), error_msg, return);
+	ENSURE_OR_FAIL(header.strings_size > 0 && header.strings_size <= header.payload_size, error_msg, return);
+
+	const char *data = buf.data() + sizeof(header);
+	if (header.flags & flag_compressed) {
+		ENSURE_OR_FAIL(header.payload_size <= header.stored_size * max_deflate_ratio, error_msg, return);
+		try {
+			payload.resize(header.payload_size);
+		} catch (const std::bad_alloc &) {
+			error_msg = "Not enough memory for the " + std::to_string(header.payload_size) + " bytes of the native board";
+			return;
+		}
+		uLongf size = payload.size();
+		int ret     = uncompress(reinterpret_cast<Bytef *>(payload.data()), &size, reinterpret_cast<const Bytef *>(data), header.stored_size);
+		ENSURE_OR_FAIL(ret == Z_OK && size == payload.size(), error_msg, return);
+		data = payload.data();
+	} else {
+		ENSURE_OR_FAIL(header.stored_size == header.payload_size, error_msg, return);
+	}
+
+	const char *strings = data + columns.strings;
+	ENSURE_OR_FAIL(strings[header.strings_size - 1] == '\0', error_msg, return);
+	bool strings_ok = true;
+	auto string_at  = [&](uint32_t offset) -> const char * {
+		if (offset == no_string) return nullptr;
+		if (offset >= header.strings_size) {
+			strings_ok = false;
+			return "";
+		}
+		return strings + offset;
+	};
+	// BRDBoard trusts the enums and indexes its components with pin.part, out of range values are rejected the same way
+	bool values_ok = true;
+	auto enum_at   = [&](uint64_t column, size_t i, uint8_t count) -> uint8_t {
+		uint8_t value = get<uint8_t>(data, column, i);
+		if (value >= count) {
+			values_ok = false;
+			return 0;
+		}
+		return value;
+	};
+
+	format.resize(header.format_count);
+	for (size_t i = 0; i < format.size(); i++) {
+		format[i] = {get<int32_t>(data, columns.format_x, i), get<int32_t>(data, columns.format_y, i)};
+	}
+
+	outline_segments.resize(header.outline_count);
+	for (size_t i = 0; i < outline_segments.size(); i++) {
+		outline_segments[i] = {{get<int32_t>(data, columns.outline_x1, i), get<int32_t>(data, columns.outline_y1, i)},
+		                       {get<int32_t>(data, columns.outline_x2, i), get<int32_t>(data, columns.outline_y2, i)}};
+	}
+
+	parts.resize(header.parts_count);
+	for (size_t i = 0; i < parts.size(); i++) {
+		auto &part         = parts[i];
+		part.name          = string_at(get<uint32_t>(data, columns.part_name, i));
+		const char *mfg    = string_at(get<uint32_t>(data, columns.part_mfgcode, i));
+		part.mfgcode       = mfg ? mfg : "";
+		part.mounting_side = static_cast<BRDPartMountingSide>(enum_at(columns.part_mounting_side, i, 3));
+		part.part_type     = static_cast<BRDPartType>(enum_at(columns.part_type, i, 2));
+		part.end_of_pins   = get<uint32_t>(data, columns.part_end_of_pins, i);
+		part.p1            = {get<int32_t>(data, columns.part_p1_x, i), get<int32_t>(data, columns.part_p1_y, i)};
+		part.p2            = {get<int32_t>(data, columns.part_p2_x, i), get<int32_t>(data, columns.part_p2_y, i)};
+	}
+
+	pins.resize(header.pins_count);
+	for (size_t i = 0; i < pins.size(); i++) {
+		auto &pin  = pins[i];
+		pin.pos    = {get<int32_t>(data, columns.pin_x, i), get<int32_t>(data, columns.pin_y, i)};
+		pin.probe  = get<int32_t>(data, columns.pin_probe, i);
+		pin.part   = get<uint32_t>(data, columns.pin_part, i);
+		pin.side   = static_cast<BRDPinSide>(enum_at(columns.pin_side, i, 3));
+		pin.net    = string_at(get<uint32_t>(data, columns.pin_net, i));
+		pin.radius = get<double>(data, columns.pin_radius, i);
+		pin.snum   = string_at(get<uint32_t>(data, columns.pin_snum, i));
+		pin.name   = string_at(get<uint32_t>(data, columns.pin_name, i));
+		if (pin.part == 0 || pin.part > header.parts_count) values_ok = false;
+	}
+
+	nails.resize(header.nails_count);
+	for (size_t i = 0; i < nails.size(); i++) {
+		auto &nail = nails[i];
+		nail.probe = get<uint32_t>(data, columns.nail_probe, i);
+		nail.pos   = {get<int32_t>(data, columns.nail_x, i), get<int32_t>(data, columns.nail_y, i)};
+		nail.side  = static_cast<BRDPartMountingSide>(enum_at(columns.nail_side, i, 3));
+		nail.net   = string_at(get<uint32_t>(data, columns.nail_net, i));
+	}
+	ENSURE_OR_FAIL(strings_ok, error_msg, return);
+	ENSURE_OR_FAIL(values_ok, error_msg, return);
+
+	num_format = header.num_format;
+	num_parts  = header.num_parts;
+	num_pins   = header.num_pins;
+	num_nails  = header.num_nails;
+
+	valid = true;
+}
+
+bool OBVFile::write(const BRDFileBase &file, const filesystem::path &filepath, bool compress, std::string &error_msg) {
+	StringTable strings;
+	NativeHeader header{};
+	memcpy(header.magic, native_magic, sizeof(native_magic));
+	header.version       = version;
+	header.flags         = compress ? flag_compressed : 0;
+	header.num_format    = file.num_format;
+	header.num_parts     = file.num_parts;
+	header.num_pins      = file.num_pins;
+	header.num_nails     = file.num_nails;
+	header.format_count  = file.format.size();
+	header.outline_count = file.outline_segments.size();
+	header.parts_count   = file.parts.size();
+	header.pins_count    = file.pins.size();
+	header.nails_count   = file.nails.size();
+
+	// The string table size is only known once every string is interned, so the columns are filled from offset 0
+	// and the string table appended after them.
+	NativeColumns columns(header);
+	std::vector<char> payload(columns.strings);
+
+	for (size_t i = 0; i < file.format.size(); i++) {
+		put<int32_t>(payload, columns.format_x, i, file.format[i].x);
+		put<int32_t>(payload, columns.format_y, i, file.format[i].y);
+	}
+
+	for (size_t i = 0; i < file.outline_segments.size(); i++) {
+		auto &segment = file.outline_segments[i];
+		put<int32_t>(payload, columns.outline_x1, i, segment.first.x);
+		put<int32_t>(payload, columns.outline_y1, i, segment.first.y);
+		put<int32_t>(payload, columns.outline_x2, i, segment.second.x);
+		put<int32_t>(payload, columns.outline_y2, i, segment.second.y);
+	}
+
+	for (size_t i = 0; i < file.parts.size(); i++) {
+		auto &part = file.parts[i];
+		put<uint32_t>(payload, columns.part_name, i, strings.intern(part.name));
+		put<uint32_t>(payload, columns.part_mfgcode, i, strings.intern(part.mfgcode.c_str()));
+		put<uint8_t>(payload, columns.part_mounting_side, i, static_cast<uint8_t>(part.mounting_side));
+		put<uint8_t>(payload, columns.part_type, i, static_cast<uint8_t>(part.part_type));
+		put<uint32_t>(payload, columns.part_end_of_pins, i, part.end_of_pins);
+		put<int32_t>(payload, columns.part_p1_x, i, part.p1.x);
+		put<int32_t>(payload, columns.part_p1_y, i, part.p1.y);
+		put<int32_t>(payload, columns.part_p2_x, i, part.p2.x);
+		put<int32_t>(payload, columns.part_p2_y, i, part.p2.y);
+	}
+
+	for (size_t i = 0; i < file.pins.size(); i++) {
+		auto &pin = file.pins[i];
+		put<int32_t>(payload, columns.pin_x, i, pin.pos.x);
+		put<int32_t>(payload, columns.pin_y, i, pin.pos.y);
+		put<int32_t>(payload, columns.pin_probe, i, pin.probe);
+		put<uint32_t>(payload, columns.pin_part, i, pin.part);
+		put<uint8_t>(payload, columns.pin_side, i, static_cast<uint8_t>(pin.side));
+		put<uint32_t>(payload, columns.pin_net, i, strings.intern(pin.net));
+		put<double>(payload, columns.pin_radius, i, pin.radius);
+		put<uint32_t>(payload, columns.pin_snum, i, strings.intern(pin.snum));
+		put<uint32_t>(payload, columns.pin_name, i, strings.intern(pin.name));
+	}
+
+	for (size_t i = 0; i < file.nails.size(); i++) {
+		auto &nail = file.nails[i];
+		put<uint32_t>(payload, columns.nail_probe, i, nail.probe);
+		put<int32_t>(payload, columns.nail_x, i, nail.pos.x);
+		put<int32_t>(payload, columns.nail_y, i, nail.pos.y);
+		put<uint8_t>(payload, columns.nail_side, i, static_cast<uint8_t>(nail.side));
+		put<uint32_t>(payload, columns.nail_net, i, strings.intern(nail.net));
+	}
+	strings.intern(""); // Never empty, so the table always ends with a NUL
+
+	payload.insert(payload.end(), strings.data.begin(), strings.data.end());
+	header.strings_size = strings.data.size();
+	header.payload_size = payload.size();
+
+	if (compress) {
+		std::vector<char> deflated(compressBound(payload.size()));
+		uLongf size = deflated.size();
+		int ret     = compress2(reinterpret_cast<Bytef *>(deflated.data()), &size, reinterpret_cast<const Bytef *>(payload.data()), payload.size(), Z_DEFAULT_COMPRESSION);
+		ENSURE_OR_FAIL(ret == Z_OK, error_msg, return false);
+		deflated.resize(size);
+		payload.swap(deflated);
+	}
+	header.stored_size = payload.size();
+
+	// Write to a temporary file first so that a board being shared is never seen half written
+	std::error_code ec;
+	filesystem::path tmppath = filepath;
+	tmppath += ".tmp";
+	{
+		std::ofstream out(tmppath.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			error_msg = "Cannot write " + tmppath.string();
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
+			return false;
+		}
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(payload.data(), payload.size());
+		ENSURE_OR_FAIL(out.good(), error_msg, filesystem::remove(tmppath, ec); return false);
+	}
+
+	filesystem::rename(tmppath, filepath, ec);
+	if (ec) {
+		error_msg = "Cannot write " + filepath.string() + ": " + ec.message();
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
+		filesystem::remove(tmppath, ec);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "BRDFileBase.h"
+
+#include <cstdint>
+
+#include "filesystem_impl.h"
+
+/*
+ * OpenBoardView native board format (.obv).
+ * A little-endian columnar dump of BRDFileBase: one array per field of the format points, outline segments,
+ * parts, pins and nails, then a string table the string fields are offsets in.
+ * The columns can be stored deflated, otherwise the file is used in place with no per element parsing.
+ */
+class OBVFile : public BRDFileBase {
+  public:
+	// Bump whenever the layout changes
+	static constexpr uint32_t version = 1;
+
+	OBVFile(const BufferSpan &buf);
+
+	static bool verifyFormat(const BufferSpan &buf);
+	static bool write(const BRDFileBase &file, const filesystem::path &filepath, bool compress, std::string &error_msg);
+
+  private:
+	std::vector<char> payload; // Inflated columns when the file is compressed, strings point into it
+};
@@ -0,0 +1,153 @@
+#include "platform.h" // Must be first, sets up windows.h
+
+#include "MappedFile.h"
+
+#include "utils.h"
+#include <SDL.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_mapped_size, other.m_mapped_size);
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const filesystem::path &filepath, std::string &error_msg) {
+	close();
+
+	if (!filesystem::is_regular_file(filepath)) {
+		error_msg = "Not a regular file";
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Error opening %s: %s", filepath.string().c_str(), error_msg.c_str());
+		return false;
+	}
+
+	if (map(filepath)) return true;
+
+	return read(filepath, error_msg);
+}
+
+void MappedFile::close() {
+	if (m_mapped_size) {
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+#else
+		munmap(m_data, m_mapped_size);
+#endif
+	} else {
+		free(m_data);
+	}
+	m_data        = nullptr;
+	m_size        = 0;
+	m_mapped_size = 0;
+}
+
+#ifdef _WIN32
+bool MappedFile::map(const filesystem::path &filepath) {
+	HANDLE file = CreateFileW(filepath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER filesize;
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	// The view is only followed by zeroes if the file does not end on a page boundary
+	if (!GetFileSizeEx(file, &filesize) || filesize.QuadPart == 0 || filesize.QuadPart % si.dwPageSize == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping) return false;
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping); // The view keeps a reference to the mapping
+	if (!view) return false;
+
+	m_data        = static_cast<char *>(view);
+	m_size        = static_cast<size_t>(filesize.QuadPart);
+	m_mapped_size = m_size;
+	return true;
+}
+#else
+bool MappedFile::map(const filesystem::path &filepath) {
+	int fd = ::open(filepath.string().c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	size_t filesize = static_cast<size_t>(st.st_size);
+
+	// Reserve one extra byte of anonymous zeroed memory then map the file over the start of it,
+	// so the data is NUL terminated even when the file ends on a page boundary.
+	size_t mapped_size = filesize + 1;
+	void *base         = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		::close(fd);
+		return false;
+	}
+	void *view = mmap(base, filesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+	::close(fd); // The mapping keeps a reference to the file
+	if (view == MAP_FAILED) {
+		munmap(base, mapped_size);
+		return false;
+	}
+	madvise(view, filesize, MADV_SEQUENTIAL);
+
+	m_data        = static_cast<char *>(view);
+	m_size        = filesize;
+	m_mapped_size = mapped_size;
+	return true;
+}
+#endif
+
+// Fallback for files that cannot be mapped (empty files, special filesystems)
+bool MappedFile::read(const filesystem::path &filepath, std::string &error_msg) {
+	ifstream file;
+	file.open(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+
+	if (!file.is_open()) {
+		error_msg = strerror(errno);
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Error opening %s: %s", filepath.string().c_str(), error_msg.c_str());
+		return false;
+	}
+
+	std::streampos sz = file.tellg();
+	ENSURE_OR_FAIL(sz >= 0, error_msg, return false);
+	file.seekg(0, std::ios_base::beg);
+
+	m_size = static_cast<size_t>(sz);
+	m_data = static_cast<char *>(malloc(m_size + 1));
+	ENSURE_OR_FAIL(m_data != nullptr, error_msg, m_size = 0; return false);
+
+	file.read(m_data, m_size);
+	m_data[m_size] = 0;
+	ENSURE_OR_FAIL(file.gcount() == static_cast<std::streamsize>(m_size), error_msg, close(); return false);
+
+	return true;
+}
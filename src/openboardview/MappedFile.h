@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "filesystem_impl.h"
+
+// Non-owning view over a contiguous writable byte range, typically a MappedFile.
+// data()[size()] must be readable and NUL so text parsers can work on the buffer in place.
+class BufferSpan {
+  public:
+	BufferSpan() = default;
+	BufferSpan(char *data, size_t size) : m_data(data), m_size(size) {}
+
+	char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	char *begin() const { return m_data; }
+	char *end() const { return m_data + m_size; }
+	char &operator[](size_t i) const { return m_data[i]; }
+
+  private:
+	char *m_data  = nullptr;
+	size_t m_size = 0;
+};
+
+// Read-only file source backed by a private copy-on-write mapping.
+// Writes (NUL terminators, in-place decoding) only touch the pages they hit and never reach the file on disk.
+// The mapped bytes are always followed by a NUL byte.
+// Falls back to reading the file into memory when it cannot be mapped.
+class MappedFile {
+  public:
+	MappedFile() = default;
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	bool open(const filesystem::path &filepath, std::string &error_msg);
+	void close();
+
+	char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	BufferSpan span() const { return {m_data, m_size}; }
+
+  private:
+	bool map(const filesystem::path &filepath);
+	bool read(const filesystem::path &filepath, std::string &error_msg);
+
+	char *m_data         = nullptr;
+	size_t m_size        = 0;
+	size_t m_mapped_size = 0; // 0 if m_data was allocated on the heap
+};
@@ -1,12 +1,109 @@
-#include "platform.h"
 #include "Searcher.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// Recent searches kept, for the three search columns, typing and backspace
+const size_t kCacheSize = 32;
+
+// Same folding as strcasestr() in the C locale
+inline char fold(char c) {
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+std::string fold(const std::string &s) {
+	std::string result(s);
+	for (auto &c : result) c = fold(c);
+	return result;
+}
+
+// Three characters in one key
+inline uint32_t trigram(const char *s) {
+	return static_cast<uint8_t>(s[0]) << 16 | static_cast<uint8_t>(s[1]) << 8 | static_cast<uint8_t>(s[2]);
+}
+
+// Byte order, then shorter first
+int compare(const char *a, size_t asize, const char *b, size_t bsize) {
+	int r = memcmp(a, b, std::min(asize, bsize));
+	if (r) return r;
+	return asize < bsize ? -1 : asize > bsize;
+}
+
+} // namespace
+
+template<class T> void Searcher::buildIndex(Index &index, const std::vector<T> &v) {
+	index = Index();
+
+	auto add = [&index](uint32_t element, const std::string &s) {
+		index.offset.push_back(index.text.size());
+		index.owner.push_back(element);
+		index.text += s;
+	};
+
+	std::vector<std::string> details;
+	for (uint32_t i = 0; i < v.size(); i++) {
+		index.first.push_back(index.owner.size());
+		add(i, fold(v[i]->name));
+
+		// A net has the same pin names many times, each is searched once
+		details.clear();
+		for (auto s : v[i]->searchableStringDetails()) details.push_back(fold(*s));
+		std::sort(details.begin(), details.end());
+		details.erase(std::unique(details.begin(), details.end()), details.end());
+		for (auto &s : details) add(i, s);
+	}
+	index.first.push_back(index.owner.size());
+	index.offset.push_back(index.text.size());
+
+	uint32_t count   = index.owner.size();
+	const char *text = index.text.data();
+	auto &offset     = index.offset;
+
+	index.sorted.resize(count);
+	std::iota(index.sorted.begin(), index.sorted.end(), 0);
+	std::sort(index.sorted.begin(), index.sorted.end(), [&](uint32_t a, uint32_t b) {
+		return compare(text + offset[a], offset[a + 1] - offset[a], text + offset[b], offset[b + 1] - offset[b]) < 0;
+	});
+
+	// Trigram and string pairs, sorted by trigram then string
+	std::vector<uint64_t> grams;
+	for (uint32_t s = 0; s < count; s++) {
+		uint32_t previous = UINT32_MAX;
+		for (uint32_t k = offset[s]; k + 3 <= offset[s + 1]; k++) {
+			uint32_t gram = trigram(text + k);
+			if (gram != previous) grams.push_back(uint64_t{gram} << 32 | s);
+			previous = gram;
+		}
+	}
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+	index.gramStrings.reserve(grams.size());
+	for (uint64_t g : grams) {
+		uint32_t gram = g >> 32;
+		if (index.gramKeys.empty() || index.gramKeys.back() != gram) {
+			index.gramKeys.push_back(gram);
+			index.gramStart.push_back(index.gramStrings.size());
+		}
+		index.gramStrings.push_back(static_cast<uint32_t>(g));
+	}
+	index.gramStart.push_back(index.gramStrings.size());
+}
+
 void Searcher::setNets(SharedVector<Net> nets) {
 	this->m_nets = nets;
+	buildIndex(m_netIndex, m_nets);
+	m_cache.clear();
 }
 
 void Searcher::setParts(SharedVector<Component> components) {
 	this->m_parts = components;
+	buildIndex(m_partIndex, m_parts);
+	m_cache.clear();
 }
 
 bool Searcher::isMode(SearchMode sm) {
@@ -17,48 +114,158 @@ void Searcher::setMode(SearchMode sm) {
 	m_searchMode = sm;
 }
 
-bool Searcher::strstrModeSearch(const std::string &strhaystack, const std::string &strneedle) {
-	size_t nl = strneedle.size();
-	size_t hl = strhaystack.size();
-	const char *needle = strneedle.c_str();
-	const char *haystack = strhaystack.c_str();
-	const char *sr;
+bool Searcher::searchable(const Index &index, uint32_t s) const {
+	// Details only count when asked for, names come first in their element
+	return m_search_details || index.first[index.owner[s]] == s;
+}
 
-	sr = strcasestr(haystack, needle);
-	if (sr) {
-		if ((m_searchMode == SearchMode::Sub) || ((m_searchMode == SearchMode::Prefix) && (sr == haystack)) ||
-		    ((m_searchMode == SearchMode::Whole) && (sr == haystack) && (nl == hl))) {
-			return true;
+bool Searcher::matchString(const Index &index, uint32_t s, const std::string &needle) const {
+	const char *begin = index.text.data() + index.offset[s];
+	const char *end   = index.text.data() + index.offset[s + 1];
+	size_t len        = end - begin;
+	switch (m_searchMode) {
+		case SearchMode::Sub: return std::search(begin, end, needle.begin(), needle.end()) != end;
+		case SearchMode::Prefix: return len >= needle.size() && !memcmp(begin, needle.data(), needle.size());
+		case SearchMode::Whole: return len == needle.size() && !memcmp(begin, needle.data(), needle.size());
+	}
+	return false;
+}
+
+uint32_t Searcher::scan(const Index &index, const std::string &needle, uint32_t from, size_t max, std::vector<uint32_t> &results) const {
+	uint32_t count   = index.first.size() - 1;
+	uint32_t strings = index.owner.size();
+	const char *text = index.text.data();
+	auto &offset     = index.offset;
+
+	// Adds the element of string s if it matches, true once max elements are found
+	auto visit = [&](uint32_t s) {
+		uint32_t element = index.owner[s];
+		if (element < from || (!results.empty() && results.back() == element)) return false;
+		if (!searchable(index, s) || !matchString(index, s, needle)) return false;
+		results.push_back(element);
+		return results.size() >= max;
+	};
+	// Strings in order are the elements in order
+	auto visitAll = [&]() {
+		for (uint32_t s = index.first[from]; s < strings; s++) {
+			if (visit(s)) return index.owner[s] + 1;
 		}
+		return count;
+	};
+
+	if (m_searchMode == SearchMode::Sub) {
+		// Strings having the least common trigram of the needle, all of them if the needle is too short
+		const uint32_t *candidates = nullptr;
+		size_t candidates_count    = 0;
+		for (size_t k = 0; k + 3 <= needle.size(); k++) {
+			uint32_t gram = trigram(needle.data() + k);
+			auto it       = std::lower_bound(index.gramKeys.begin(), index.gramKeys.end(), gram);
+			if (it == index.gramKeys.end() || *it != gram) return count;
+			size_t g = it - index.gramKeys.begin();
+			if (!candidates || index.gramStart[g + 1] - index.gramStart[g] < candidates_count) {
+				candidates       = index.gramStrings.data() + index.gramStart[g];
+				candidates_count = index.gramStart[g + 1] - index.gramStart[g];
+			}
+		}
+		if (!candidates) return visitAll();
+
+		// Candidates are in string order
+		const uint32_t *end = candidates + candidates_count;
+		for (const uint32_t *c = std::lower_bound(candidates, end, index.first[from]); c != end; ++c) {
+			if (visit(*c)) return index.owner[*c] + 1;
+		}
+		return count;
 	}
 
-	return false;
+	// Strings starting with the needle follow each other in sorted order, the ones equal to it first
+	auto lo = std::lower_bound(index.sorted.begin(), index.sorted.end(), needle, [&](uint32_t s, const std::string &key) {
+		return compare(text + offset[s], offset[s + 1] - offset[s], key.data(), key.size()) < 0;
+	});
+	auto hi     = std::partition_point(lo, index.sorted.end(), [&](uint32_t s) { return matchString(index, s, needle); });
+	size_t hits = hi - lo;
+	if (!hits) return count;
+
+	// A few results out of many hits come sooner going through the strings in order
+	if (max != SIZE_MAX && static_cast<double>(max - results.size()) * (strings - index.first[from]) / hits < hits) return visitAll();
+
+	std::vector<uint64_t> found((count + 63) / 64, 0);
+	for (auto it = lo; it != hi; ++it) {
+		uint32_t element = index.owner[*it];
+		if (element >= from && searchable(index, *it)) found[element / 64] |= uint64_t{1} << (element % 64);
+	}
+	for (uint32_t w = from / 64; w < found.size(); w++) {
+		if (!found[w]) continue;
+		for (uint32_t b = 0; b < 64; b++) {
+			if (!(found[w] >> b & 1)) continue;
+			results.push_back(w * 64 + b);
+			if (results.size() >= max) return w * 64 + b + 1;
+		}
+	}
+	return count;
 }
 
-template<class T> std::vector<T> Searcher::searchFor(const std::string& search, std::vector<T> v,  int limit) {
-	std::vector<T> results;
+std::vector<uint32_t> Searcher::matches(const Index &index, const std::string &search, int limit) {
+	std::vector<uint32_t> results;
 
-	if (search.empty()) return results;
+	if (search.empty() || index.owner.empty()) return results;
+
+	std::string needle = fold(search);
+	size_t max         = limit > 0 ? limit : SIZE_MAX;
+	uint32_t count     = index.first.size() - 1;
+
+	// Any element matching the needle matched a recent search of a part of it (Sub) or of its start (Prefix)
+	auto base = m_cache.end();
+	for (auto c = m_cache.begin(); c != m_cache.end(); ++c) {
+		if (c->index != &index || c->mode != m_searchMode || c->details != m_search_details) continue;
+		bool refined = c->needle == needle || (m_searchMode == SearchMode::Sub && needle.find(c->needle) != std::string::npos) ||
+		               (m_searchMode == SearchMode::Prefix && !needle.compare(0, c->needle.size(), c->needle));
+		if (refined && (base == m_cache.end() || c->needle.size() > base->needle.size())) base = c;
+	}
 
-	for (auto &p : v) {
-		bool match = strstrModeSearch(p->name, search);
-		if (m_search_details && !match) {
-			const auto details = p->searchableStringDetails();
-			for (auto s = details.begin(); s != details.end() && !match; ++s) {
-				match |= strstrModeSearch(**s, search);
+	bool again               = base != m_cache.end() && base->needle == needle;
+	CachedSearch search_done = {&index, m_searchMode, m_search_details, needle, {}, count};
+	if (again && (base->next == count || base->results.size() >= max)) {
+		// Same search again
+		search_done = std::move(*base);
+	} else {
+		uint32_t from = 0;
+		if (base != m_cache.end()) {
+			// Only the elements found by the previous search are looked at again
+			for (uint32_t element : base->results) {
+				bool match = false;
+				for (uint32_t s = index.first[element]; s < index.first[element + 1] && !match; s++) {
+					match = searchable(index, s) && matchString(index, s, needle);
+				}
+				if (!match) continue;
+				search_done.results.push_back(element);
+				if (search_done.results.size() >= max) break;
 			}
+			from = search_done.results.size() >= max ? search_done.results.back() + 1 : base->next;
 		}
-		if (match) {
-			results.push_back(p);
-			limit--;
+		if (search_done.results.size() < max) {
+			search_done.next = scan(index, needle, from, max, search_done.results);
+		} else {
+			search_done.next = from;
 		}
-		if (limit == 0) return results;
 	}
+
+	if (again) m_cache.erase(base);
+	m_cache.insert(m_cache.begin(), std::move(search_done));
+	if (m_cache.size() > kCacheSize) m_cache.pop_back();
+
+	auto &found = m_cache.front().results;
+	results.assign(found.begin(), found.begin() + std::min(max, found.size()));
+	return results;
+}
+
+template<class T> std::vector<T> Searcher::searchFor(const std::string& search, const std::vector<T> &v, const Index &index, int limit) {
+	std::vector<T> results;
+	for (uint32_t i : matches(index, search, limit)) results.push_back(v[i]);
 	return results;
 }
 
 SharedVector<Component> Searcher::parts(const std::string& search, int limit) {
-	return searchFor(search, m_parts, limit);
+	return searchFor(search, m_parts, m_partIndex, limit);
 }
 
 SharedVector<Component> Searcher::parts(const std::string& search) {
@@ -66,7 +273,7 @@ SharedVector<Component> Searcher::parts(const std::string& search) {
 }
 
 SharedVector<Net> Searcher::nets(const std::string& search, int limit) {
-	return searchFor(search, m_nets, limit);
+	return searchFor(search, m_nets, m_netIndex, limit);
 }
 
 SharedVector<Net> Searcher::nets(const std::string& search) {
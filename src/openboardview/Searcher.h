@@ -1,5 +1,9 @@
 #include "BRDBoard.h"
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 enum class SearchMode {
 	Sub,
 	Prefix,
@@ -7,14 +11,49 @@ enum class SearchMode {
 };
 
 class Searcher {
+	/*
+	 * Case folded names and details of the parts or the nets, built once per board.
+	 * Strings are numbered element after element, the name of an element first, so that
+	 * going through strings in order goes through the elements in order.
+	 */
+	struct Index {
+		std::string text;                  // All the strings, one after the other
+		std::vector<uint32_t> offset;      // Start of each string in text, plus the end of the last one
+		std::vector<uint32_t> owner;       // Element of each string
+		std::vector<uint32_t> first;       // Name string of each element, plus the number of strings
+		std::vector<uint32_t> sorted;      // Strings in text order, for Prefix and Whole searches
+		std::vector<uint32_t> gramKeys;    // Sorted trigrams found in the strings
+		std::vector<uint32_t> gramStart;   // Offsets into gramStrings per trigram, plus the end of the last one
+		std::vector<uint32_t> gramStrings; // Strings containing each trigram, in order
+	};
+
+	// A recent search, its elements also hold those of any search refining it
+	struct CachedSearch {
+		const Index *index;
+		SearchMode mode;
+		bool details;
+		std::string needle;            // Case folded
+		std::vector<uint32_t> results; // Matching elements before next, in order
+		uint32_t next;                 // First element not looked at, the number of elements if the search went through all
+	};
+
 	SearchMode m_searchMode = SearchMode::Sub;
 	bool m_search_details   = false;
 
 	SharedVector<Net> m_nets;
 	SharedVector<Component> m_parts;
+	Index m_netIndex;
+	Index m_partIndex;
+	std::vector<CachedSearch> m_cache; // Most recently used first
 
-	template<class T> std::vector<T> searchFor(const std::string& search, std::vector<T> v,  int limit);
-	bool strstrModeSearch(const std::string &strhaystack, const std::string &strneedle);
+	template<class T> static void buildIndex(Index &index, const std::vector<T> &v);
+	// Elements matching search, in order, at most limit of them if limit is positive
+	std::vector<uint32_t> matches(const Index &index, const std::string &search, int limit);
+	// Adds the elements from element from on matching needle to results, up to max of them, returns the next element to look at
+	uint32_t scan(const Index &index, const std::string &needle, uint32_t from, size_t max, std::vector<uint32_t> &results) const;
+	bool matchString(const Index &index, uint32_t s, const std::string &needle) const;
+	bool searchable(const Index &index, uint32_t s) const;
+	template<class T> std::vector<T> searchFor(const std::string& search, const std::vector<T> &v, const Index &index, int limit);
 public:
 	void setNets(SharedVector<Net> nets);
 	void setParts(SharedVector<Component> components);
@@ -0,0 +1,171 @@
+#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Grid size limit along each axis, boards with all their items on a line get one row of cells
+static const uint32_t kMaxCells = 4096;
+// Items spanning more cells are kept out of the grid, so a few board wide items do not fill every cell
+static const uint32_t kMaxItemCells = 64;
+// Cell entries flag the first column and row of their item, so queries report each item once without recomputing its cells
+static const uint32_t kFirstColumn = 1u << 31;
+static const uint32_t kFirstRow    = 1u << 30;
+static const uint32_t kItemMask    = kFirstRow - 1;
+
+// Index of the lowest bit set in a non zero word
+static inline uint32_t ctz64(uint64_t v) {
+#ifdef _MSC_VER
+	unsigned long i;
+	if (_BitScanForward(&i, static_cast<uint32_t>(v))) return i;
+	_BitScanForward(&i, static_cast<uint32_t>(v >> 32));
+	return i + 32;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+void SpatialIndex::build(const std::vector<Box> &boxes) {
+	clear();
+	m_boxes = boxes;
+
+	size_t count = 0;
+	m_minx = m_miny = FLT_MAX;
+	m_maxx = m_maxy = -FLT_MAX;
+	for (auto &b : m_boxes) {
+		if (b.isEmpty()) continue;
+		m_minx = std::min(m_minx, b.minx);
+		m_miny = std::min(m_miny, b.miny);
+		m_maxx = std::max(m_maxx, b.maxx);
+		m_maxy = std::max(m_maxy, b.maxy);
+		count++;
+	}
+	if (!count) {
+		m_boxes.clear();
+		return;
+	}
+
+	// About two items per cell if they were evenly spread
+	float w = m_maxx - m_minx, h = m_maxy - m_miny;
+	if (w > 0 && h > 0) {
+		m_cell = std::sqrt(2.0f * w * h / count);
+	} else {
+		m_cell = std::max(w, h) * 2.0f / count;
+	}
+	m_cell = std::max({m_cell, w / kMaxCells, h / kMaxCells, 1e-3f});
+	m_nx   = std::min(kMaxCells, static_cast<uint32_t>(w / m_cell) + 1);
+	m_ny   = std::min(kMaxCells, static_cast<uint32_t>(h / m_cell) + 1);
+
+	auto large = [&](const Box &b) {
+		return uint64_t{cellX(b.maxx) - cellX(b.minx) + 1} * (cellY(b.maxy) - cellY(b.miny) + 1) > kMaxItemCells;
+	};
+
+	// Counting sort of the items by cell
+	m_cellStart.assign(m_nx * m_ny + 1, 0);
+	for (uint32_t i = 0; i < m_boxes.size(); i++) {
+		const Box &b = m_boxes[i];
+		if (b.isEmpty()) continue;
+		if (large(b)) {
+			m_large.push_back(i);
+			continue;
+		}
+		for (uint32_t y = cellY(b.miny), ye = cellY(b.maxy); y <= ye; y++) {
+			for (uint32_t x = cellX(b.minx), xe = cellX(b.maxx); x <= xe; x++) m_cellStart[y * m_nx + x + 1]++;
+		}
+	}
+	for (size_t i = 1; i < m_cellStart.size(); i++) m_cellStart[i] += m_cellStart[i - 1];
+
+	m_items.resize(m_cellStart.back());
+	std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (uint32_t i = 0; i < m_boxes.size(); i++) {
+		const Box &b = m_boxes[i];
+		if (b.isEmpty() || large(b)) continue;
+		uint32_t x0 = cellX(b.minx), y0 = cellY(b.miny);
+		for (uint32_t y = y0, ye = cellY(b.maxy); y <= ye; y++) {
+			for (uint32_t x = x0, xe = cellX(b.maxx); x <= xe; x++) {
+				m_items[fill[y * m_nx + x]++] = i | (x == x0 ? kFirstColumn : 0) | (y == y0 ? kFirstRow : 0);
+			}
+		}
+	}
+}
+
+void SpatialIndex::clear() {
+	m_boxes.clear();
+	m_cellStart.clear();
+	m_items.clear();
+	m_large.clear();
+	m_nx = m_ny = 0;
+}
+
+uint32_t SpatialIndex::cellX(float x) const {
+	float c = (x - m_minx) / m_cell;
+	if (!(c > 0)) return 0; // Also NaN
+	return std::min(m_nx - 1, static_cast<uint32_t>(std::min(c, static_cast<float>(kMaxCells))));
+}
+
+uint32_t SpatialIndex::cellY(float y) const {
+	float c = (y - m_miny) / m_cell;
+	if (!(c > 0)) return 0;
+	return std::min(m_ny - 1, static_cast<uint32_t>(std::min(c, static_cast<float>(kMaxCells))));
+}
+
+std::vector<uint32_t> SpatialIndex::query(float minx, float miny, float maxx, float maxy) const {
+	std::vector<uint32_t> result;
+	if (m_boxes.empty() || minx > maxx || miny > maxy) return result;
+
+	auto overlaps = [&](const Box &b) { return b.minx <= maxx && b.maxx >= minx && b.miny <= maxy && b.maxy >= miny; };
+
+	// Everything, e.g. the whole board on screen
+	if (minx <= m_minx && miny <= m_miny && maxx >= m_maxx && maxy >= m_maxy) {
+		for (uint32_t i = 0; i < m_boxes.size(); i++) {
+			if (!m_boxes[i].isEmpty()) result.push_back(i);
+		}
+		return result;
+	}
+
+	for (uint32_t i : m_large) {
+		if (overlaps(m_boxes[i])) result.push_back(i);
+	}
+
+	uint32_t x0 = cellX(minx), x1 = cellX(maxx);
+	uint32_t y0 = cellY(miny), y1 = cellY(maxy);
+	for (uint32_t y = y0; y <= y1; y++) {
+		for (uint32_t x = x0; x <= x1; x++) {
+			uint32_t cell = y * m_nx + x;
+			// Items of inner cells are all inside, those of border cells are tested
+			bool border = x == x0 || x == x1 || y == y0 || y == y1;
+			for (uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++) {
+				uint32_t entry = m_items[k];
+				// Boxes spanning several cells are reported from the first cell both ranges share
+				if ((x != x0 && !(entry & kFirstColumn)) || (y != y0 && !(entry & kFirstRow))) continue;
+				uint32_t i = entry & kItemMask;
+				if (border && !overlaps(m_boxes[i])) continue;
+				result.push_back(i);
+			}
+		}
+	}
+
+	// Large results are put back in order through a bitmap, faster than sorting them
+	if (result.size() < m_boxes.size() / 64) {
+		std::sort(result.begin(), result.end());
+	} else {
+		std::vector<uint64_t> bits((m_boxes.size() + 63) / 64, 0);
+		for (uint32_t i : result) bits[i / 64] |= uint64_t{1} << (i % 64);
+		result.clear();
+		for (uint32_t w = 0; w < bits.size(); w++) {
+			for (uint64_t word = bits[w]; word; word &= word - 1) result.push_back(w * 64 + ctz64(word));
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> SpatialIndex::query(float x, float y) const {
+	return query(x, y, x, y);
+}
+
+std::vector<uint32_t> SpatialIndex::queryRadius(float x, float y, float radius) const {
+	return query(x - radius, y - radius, x + radius, y + radius);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Uniform grid over boxes in board coordinates, built once, for hit testing.
+ * Items are referred to by their position in the vector given to build(), up to 2^30 of them.
+ * The cost of a query depends on the number of items around it, not on the size of the board.
+ */
+class SpatialIndex {
+  public:
+	struct Box {
+		float minx, miny, maxx, maxy;
+
+		// For items left out of the index, e.g. those on the other side of the board
+		static Box empty() {
+			return {1.0f, 1.0f, 0.0f, 0.0f};
+		}
+		bool isEmpty() const {
+			return minx > maxx || miny > maxy;
+		}
+	};
+
+	// Replaces the content of the index, points are boxes of size 0
+	void build(const std::vector<Box> &boxes);
+	void clear();
+
+	// Items whose box intersects [minx, maxx] x [miny, maxy], sorted, each once
+	std::vector<uint32_t> query(float minx, float miny, float maxx, float maxy) const;
+	// Items whose box contains (x, y)
+	std::vector<uint32_t> query(float x, float y) const;
+	// Items whose box is at most radius away from (x, y) on each axis, callers test the exact distance
+	std::vector<uint32_t> queryRadius(float x, float y, float radius) const;
+
+	bool empty() const {
+		return m_boxes.empty();
+	}
+
+  private:
+	// Cell coordinate of x along an axis, clamped to the grid
+	uint32_t cellX(float x) const;
+	uint32_t cellY(float y) const;
+
+	std::vector<Box> m_boxes;
+	float m_minx = 0, m_miny = 0, m_maxx = 0, m_maxy = 0; // Bounds of the items
+	float m_cell = 1; // Cells are square
+	uint32_t m_nx = 0, m_ny = 0;
+	std::vector<uint32_t> m_cellStart; // m_nx * m_ny + 1 offsets into m_items
+	std::vector<uint32_t> m_items;     // Items of every cell they overlap, cell after cell, with flags in the high bits
+	std::vector<uint32_t> m_large;     // Items overlapping too many cells, tested by every query
+};
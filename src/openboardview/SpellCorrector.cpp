@@ -1,59 +1,105 @@
 #include "SpellCorrector.h"
 
+#include <cctype>
+#include <numeric>
+
+static std::string lowercase(const std::string &s) {
+	std::string result(s);
+	for (auto &c : result) c = tolower(static_cast<unsigned char>(c));
+	return result;
+}
+
 void SpellCorrector::setDictionary(const std::vector<std::string>& dictionary) {
 	this->dictionary = dictionary;
-}
 
-/**
- * From https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C.2B.2B
- * Added a limit parameter to limit the machting to n characters of the second string.
- */
-unsigned int SpellCorrector::levenshtein_distance(const std::string& s1, const std::string& s2, size_t limit) {
-	const std::size_t len1 = s1.size(), len2 = s2.size();
-	limit = std::min(limit, len2);
-	std::vector<unsigned int> col(limit+1), prevCol(limit+1);
-
-	for (unsigned int i = 0; i < prevCol.size(); i++)
-		prevCol[i] = i;
-	for (unsigned int i = 0; i < len1; i++) {
-		col[0] = i+1;
-		for (unsigned int j = 0; j < limit; j++)
-			col[j+1] = std::min({ prevCol[1 + j] + 1, col[j] + 1, prevCol[j] + (s1[i]==s2[j] ? 0 : 1) });
-		col.swap(prevCol);
+	std::vector<std::string> lower;
+	lower.reserve(dictionary.size());
+	for (auto &s : dictionary) lower.push_back(lowercase(s));
+
+	order.resize(dictionary.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return lower[a] < lower[b]; });
+
+	// Words in order share the start of the previous one, only the rest makes new nodes
+	nodes.assign(1, Node());
+	labels.assign(1, '\0');
+	std::vector<uint32_t> path     = {0}; // Nodes of the previous word, the root first
+	std::vector<uint32_t> children = {0}; // Last child of each node of path
+	const std::string *previous    = nullptr;
+	for (uint32_t i = 0; i < order.size(); i++) {
+		const std::string &word = lower[order[i]];
+		size_t common = 0;
+		if (previous) {
+			while (common < word.size() && common < previous->size() && word[common] == (*previous)[common]) common++;
+		}
+		path.resize(common + 1);
+		children.resize(common + 1);
+		for (size_t k = common; k < word.size(); k++) {
+			uint32_t node = nodes.size();
+			nodes.push_back(Node());
+			labels.push_back(word[k]);
+			nodes[node].first = i;
+			if (children.back()) {
+				nodes[children.back()].sibling = node;
+			} else {
+				nodes[path.back()].child = node;
+			}
+			children.back() = node;
+			path.push_back(node);
+			children.push_back(0);
+		}
+		for (uint32_t node : path) nodes[node].last = i + 1;
+		nodes[path.back()].ends++;
+		previous = &word;
 	}
-	return prevCol[limit];
 }
 
-/**
- * Compute the levenshtein distance with a limit to s1 length + 1 character.
- * Returns 0 (meaning not matched) when the distance is above the threshold.
+/*
+ * Goes through the trie with the distances from every start of the word to the start of the
+ * dictionary words ending at each node. Only the starts of the word within threshold of the size
+ * of column can be closer than threshold, branches too far away from all of them are left out.
  */
-unsigned int SpellCorrector::fuzzy_match(const std::string& s1, const std::string& s2) {
-	unsigned int score = levenshtein_distance(s1, s2, s1.size() + 1);
-	if (score > this->threshold) return 0;
-	return threshold - score;
-}
+void SpellCorrector::walk(uint32_t node, const EditDistance &word, const EditDistance::Column &column, std::vector<Match> &matches) {
+	size_t size    = word.size();
+	size_t depth   = column.size;
+	const Node &n  = nodes[node];
+	unsigned int d = column.distance;
 
-std::vector<std::string> SpellCorrector::suggest(const std::string& word) {
-	std::vector<std::string> suggestions; // What will actually be returned, a vector of matched words with levenshtein below the threshold
-	std::vector<std::pair<std::string, unsigned int>> scores; // Vector of pairs of matched words and their associated score
-	std::string wordLower = word;
-	std::transform(wordLower.begin(), wordLower.end(), wordLower.begin(), ::tolower); // Lowercase the word to search for
+	// Longer words are cut there, they are all as far
+	if (depth == size + 1) {
+		if (d < threshold) matches.push_back({d, n.first, n.last});
+		return;
+	}
+	if (n.ends && d < threshold) matches.push_back({d, n.first, n.first + n.ends});
 
-	for (auto &s : dictionary) {
-		std::string sLower = s;
-		std::transform(sLower.begin(), sLower.end(), sLower.begin(), ::tolower); // Lowercase the word from the dictionary
+	size_t lo = depth + 1 > threshold ? depth + 1 - threshold : 0;
+	size_t hi = std::min(size, depth + threshold - 1);
+	if (lo > hi || word.min(column, lo, hi) >= threshold) return;
 
-		unsigned int score = fuzzy_match(wordLower, sLower);
-		if (score) scores.push_back({s, score});
-	}
+	for (uint32_t child = n.child; child; child = nodes[child].sibling) walk(child, word, word.next(column, labels[child]), matches);
+}
+
+std::vector<std::string> SpellCorrector::suggest(const std::string& word, int limit) {
+	std::vector<std::string> suggestions;
+	if (nodes.empty()) return suggestions;
 
-	// Sort by score, descending
-	std::sort(scores.begin(), scores.end(), [] (const std::pair<std::string, unsigned int>& v1, const std::pair<std::string, unsigned int>& v2) {
-		return v1.second > v2.second;
-	});
+	// Search boxes hold less than EditDistance::kMaxSize characters
+	EditDistance distance(lowercase(word));
+	std::vector<Match> matches;
+	walk(0, distance, distance.start(), matches);
 
-	for (auto &p : scores) suggestions.push_back(p.first);
+	// Closest first, then in lowercase order
+	size_t max = limit > 0 ? limit : SIZE_MAX;
+	for (unsigned int distance = 0; distance < threshold; distance++) {
+		for (auto &m : matches) {
+			if (m.distance != distance) continue;
+			for (uint32_t i = m.first; i < m.last && suggestions.size() < max; i++) suggestions.push_back(dictionary[order[i]]);
+		}
+	}
 
 	return suggestions;
 }
+
+std::vector<std::string> SpellCorrector::suggest(const std::string& word) {
+	return suggest(word, -1);
+}
@@ -1,16 +1,42 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
 
+#include "EditDistance.h"
+
+/*
+ * Suggests dictionary words close to a misspelled one, ignoring case.
+ * A word is compared to the start of each dictionary word, one character longer than itself.
+ */
 class SpellCorrector {
-	unsigned int threshold = 3;
+	unsigned int threshold = 3; // Words this far away or further are not suggested
+
+	// Trie of the lowercased dictionary, children in character order
+	struct Node {
+		uint32_t child   = 0; // First child, 0 for none
+		uint32_t sibling = 0; // Next child of the same parent, 0 for none
+		uint32_t first   = 0; // Words starting with this node, a range of order
+		uint32_t last    = 0;
+		uint32_t ends    = 0; // Words ending at this node, they come first in the range
+	};
+	// Words found at distance, a range of order
+	struct Match {
+		unsigned int distance;
+		uint32_t first, last;
+	};
+
 	std::vector<std::string> dictionary;
+	std::vector<uint32_t> order; // Dictionary words in lowercase order
+	std::vector<Node> nodes;     // The root first
+	std::vector<char> labels;    // Character leading to each node
 
-	unsigned int levenshtein_distance(const std::string& s1, const std::string& s2, size_t limit);
-	unsigned int fuzzy_match(const std::string& s1, const std::string& s2);
+	void walk(uint32_t node, const EditDistance &word, const EditDistance::Column &column, std::vector<Match> &matches);
 
 public:
 	void setDictionary(const std::vector<std::string>& dictionnary);
 
+	// Closest words first, at most limit of them if limit is positive
+	std::vector<std::string> suggest(const std::string& word, int limit);
 	std::vector<std::string> suggest(const std::string& word);
 };
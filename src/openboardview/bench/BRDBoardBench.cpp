@@ -0,0 +1,118 @@
+/*
+ * Times BRDBoard construction on generated BRD boards, 100k and 1M pins unless pin counts are given,
+ * and measures the heap the board holds once built.
+ * Parts have 20 pins each, a tenth of the pins is on GND and the others spread over one net per 15 pins.
+ * Usage: brdboard_bench [pins...]
+ */
+#include "BRDBoard.h"
+#include "FileFormats/BRDFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// Bytes currently allocated with new, each block starts with its size
+static std::atomic<size_t> heap_bytes(0);
+
+void *operator new(size_t size) {
+	void *block = malloc(size + alignof(std::max_align_t));
+	if (!block) throw std::bad_alloc();
+	*static_cast<size_t *>(block) = size;
+	heap_bytes += size;
+	return static_cast<char *>(block) + alignof(std::max_align_t);
+}
+
+void operator delete(void *ptr) noexcept {
+	if (!ptr) return;
+	void *block = static_cast<char *>(ptr) - alignof(std::max_align_t);
+	heap_bytes -= *static_cast<size_t *>(block);
+	free(block);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+namespace {
+
+const unsigned int pins_per_part = 20;
+const unsigned int nail_count    = 2000;
+const int repeats                = 5;
+
+// BRD text of a board with the given number of pins, NUL terminated as BRDFile expects
+std::vector<char> generate(unsigned int npins) {
+	std::mt19937 random(npins);
+	auto uniform = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+
+	unsigned int nparts = (npins + pins_per_part - 1) / pins_per_part;
+	int nnets           = std::max(1u, npins / 15);
+	const int types[]   = {1, 2, 5, 9};
+
+	std::string text = "str_length:\r\n0\r\nvar_data:\r\n4 " + std::to_string(nparts) + " " + std::to_string(npins) + " " +
+	                   std::to_string(nail_count) + "\r\nFormat:\r\n0 0\r\n10000 0\r\n10000 10000\r\n0 10000\r\nParts:\r\n";
+	for (unsigned int i = 0; i < nparts; i++) {
+		unsigned int end_of_pins = std::min((i + 1) * pins_per_part, npins);
+		text += "U" + std::to_string(i) + " " + std::to_string(types[uniform(0, 3)]) + " " + std::to_string(end_of_pins) + "\r\n";
+	}
+	text += "Pins:\r\n";
+	for (unsigned int i = 0; i < npins; i++) {
+		int r = uniform(0, 99);
+		std::string net;
+		if (r < 10) {
+			net = "GND";
+		} else if (r < 12) {
+			net = "UNCONNECTED_" + std::to_string(i);
+		} else {
+			net = "NET_" + std::to_string(uniform(0, nnets));
+		}
+		text += std::to_string(uniform(0, 9999)) + " " + std::to_string(uniform(0, 9999)) + " " + std::to_string(uniform(-99, 5000)) +
+		        " " + std::to_string(i / pins_per_part + 1) + " " + net + "\r\n";
+	}
+	text += "Nails:\r\n";
+	for (unsigned int i = 0; i < nail_count; i++) {
+		text += std::to_string(i) + " " + std::to_string(uniform(0, 9999)) + " " + std::to_string(uniform(0, 9999)) + " " +
+		        std::to_string(uniform(1, 2)) + " NET_" + std::to_string(i) + "\r\n";
+	}
+
+	std::vector<char> buffer(text.begin(), text.end());
+	buffer.push_back('\0');
+	return buffer;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	std::vector<unsigned int> sizes;
+	for (int i = 1; i < argc; i++) sizes.push_back(strtoul(argv[i], nullptr, 10));
+	if (sizes.empty()) sizes = {100000, 1000000};
+
+	for (unsigned int npins : sizes) {
+		std::vector<char> buffer = generate(npins);
+		BRDFile file(BufferSpan(buffer.data(), buffer.size() - 1));
+		if (!file.valid) {
+			fprintf(stderr, "Generated board of %u pins not parsed: %s\n", npins, file.error_msg.c_str());
+			return 1;
+		}
+
+		double best = 0;
+		size_t nets = 0, bytes = 0;
+		for (int r = 0; r < repeats; r++) {
+			size_t before = heap_bytes;
+			auto start    = std::chrono::steady_clock::now();
+			BRDBoard board(&file);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (r == 0 || ms < best) best = ms;
+			nets  = board.Nets().size();
+			bytes = heap_bytes - before;
+		}
+		printf("%u pins, %zu nets: BRDBoard built in %.1f ms (best of %d), %.1f heap bytes per pin, sizeof(Pin) %zu\n", npins, nets,
+		       best, repeats, double(bytes) / npins, sizeof(Pin));
+	}
+	return 0;
+}
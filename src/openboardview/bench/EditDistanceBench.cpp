@@ -0,0 +1,102 @@
+/*
+ * EditDistance against the dynamic programming Levenshtein distance SpellCorrector used before, on random pairs of
+ * names up to 128 characters: a quarter unrelated, the others up to 5 edits apart. Checks both give the same distances
+ * and times them per pair, with a new pattern for every pair and with one pattern against every text.
+ * Usage: editdistance_bench
+ */
+#include "EditDistance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int pairs   = 4000;
+const int repeats = 5;
+
+// SpellCorrector::levenshtein_distance() before the bit-parallel kernel, kept as is
+unsigned int levenshtein_distance(const std::string& s1, const std::string& s2, size_t limit) {
+	const std::size_t len1 = s1.size(), len2 = s2.size();
+	limit = std::min(limit, len2);
+	std::vector<unsigned int> col(limit+1), prevCol(limit+1);
+
+	for (unsigned int i = 0; i < prevCol.size(); i++)
+		prevCol[i] = i;
+	for (unsigned int i = 0; i < len1; i++) {
+		col[0] = i+1;
+		for (unsigned int j = 0; j < limit; j++)
+			col[j+1] = std::min({ prevCol[1 + j] + 1, col[j] + 1, prevCol[j] + (s1[i]==s2[j] ? 0 : 1) });
+		col.swap(prevCol);
+	}
+	return prevCol[limit];
+}
+
+// Distance from text to the whole pattern
+unsigned int reference(const std::string &text, const std::string &pattern) {
+	return levenshtein_distance(text, pattern, pattern.size());
+}
+
+// Time of run(i) for every pair
+template <class Run>
+double ns_per_pair(Run run) {
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < pairs; i++) run(i);
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (repeats * pairs);
+}
+
+} // namespace
+
+int main() {
+	std::mt19937 random(7);
+	const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+	auto any_char         = [&]() { return alphabet[random() % (sizeof(alphabet) - 1)]; };
+
+	size_t mismatches = 0;
+	for (size_t length : {8, 16, 32, 64, 100, 128}) {
+		std::vector<std::string> patterns, texts;
+		for (int i = 0; i < pairs; i++) {
+			// Few letters in patterns, so that texts share a lot with them
+			std::string pattern;
+			for (size_t n = 1 + random() % length; n > 0; n--) pattern += alphabet[random() % 8];
+			std::string text = pattern;
+			for (int edits = random() % 6; edits > 0 && !text.empty(); edits--) {
+				size_t p = random() % text.size();
+				switch (random() % 3) {
+					case 0: text[p] = any_char(); break;
+					case 1: text.erase(p, 1); break;
+					default: text.insert(p, 1, any_char()); break;
+				}
+			}
+			if (random() % 4 == 0) {
+				text.clear();
+				for (size_t n = random() % (length + 1); n > 0; n--) text += any_char();
+			}
+			patterns.push_back(pattern);
+			texts.push_back(text);
+		}
+
+		EditDistance first(patterns[0]);
+		size_t length_mismatches = 0;
+		for (int i = 0; i < pairs; i++) {
+			if (EditDistance(patterns[i]).distance(texts[i]) != reference(texts[i], patterns[i])) length_mismatches++;
+			if (first.distance(texts[i]) != reference(texts[i], patterns[0])) length_mismatches++;
+		}
+		mismatches += length_mismatches;
+
+		unsigned long sink = 0; // Keeps the distances from being optimized out
+		double dp          = ns_per_pair([&](int i) { sink += reference(texts[i], patterns[i]); });
+		double bits        = ns_per_pair([&](int i) { sink += EditDistance(patterns[i]).distance(texts[i]); });
+		double dp_same     = ns_per_pair([&](int i) { sink += reference(texts[i], patterns[0]); });
+		double bits_same   = ns_per_pair([&](int i) { sink += first.distance(texts[i]); });
+
+		printf("length <= %3zu: %zu mismatches, per pair: DP %.0f ns, bits %.0f ns; same pattern: DP %.0f ns, bits %.0f ns (%lu)\n",
+		       length, length_mismatches, dp, bits, dp_same, bits_same, sink % 10);
+	}
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Parses GenCAD files with the fast parser and with the mpc grammar, times both and checks they give the same board.
+ * Usage: gencad_bench file.cad...
+ */
+#include "FileFormats/GenCADFile.h"
+#include "tests/BRDFileCompare.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+// Each parser gets its own mapping, so that neither sees what the other wrote to the buffer
+std::unique_ptr<GenCADFile> parse(const char *filename, GenCADFile::Parser parser, double &ms) {
+	MappedFile file;
+	std::string error_msg;
+	if (!file.open(filename, error_msg)) {
+		fprintf(stderr, "%s: %s\n", filename, error_msg.c_str());
+		return nullptr;
+	}
+	auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<GenCADFile> result(new GenCADFile(file.span(), parser));
+	ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result->AttachSource(std::move(file));
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s file.cad...\n", argv[0]);
+		return 2;
+	}
+
+	int failures = 0;
+	for (int i = 1; i < argc; i++) {
+		double fast_ms = 0, grammar_ms = 0;
+		auto fast      = parse(argv[i], GenCADFile::Parser::Fast, fast_ms);
+		auto grammar   = parse(argv[i], GenCADFile::Parser::Grammar, grammar_ms);
+		if (!fast || !grammar) {
+			failures++;
+			continue;
+		}
+
+		printf("%s: %u parts, %u pins, %u nails, fast %.1f ms, grammar %.1f ms\n", argv[i], fast->num_parts, fast->num_pins,
+		       fast->num_nails, fast_ms, grammar_ms);
+		if (!fast->valid || !grammar->valid) {
+			printf("  rejected by the %s parser: %s\n", fast->valid ? "grammar" : "fast",
+			       (fast->valid ? grammar : fast)->error_msg.c_str());
+			failures++;
+			continue;
+		}
+		size_t index;
+		if (const char *what = brd_file_difference(*fast, *grammar, index)) {
+			printf("  %s %zu differs\n", what, index);
+			failures++;
+		}
+	}
+	return failures ? 1 : 0;
+}
@@ -52,7 +52,6 @@ fillParts =		true\r\n\
 showPartName =  true\r\n\
 showPinName =  true\r\n\
 boardFill =		true\r\n\
-boardFillSpacing = 3\r\n\
 \r\n\
 zoomFactor = 5\r\n\
 zoomModifier = 5\r\n\
@@ -44,6 +44,8 @@
 struct globals {
 	char *input_file = nullptr;
 	char *config_file = nullptr;
+	char *output_file = nullptr;
+	bool compress = false;
 	bool slowCPU = false;
 	int width = 0;
 	int height = 0;
@@ -60,13 +62,15 @@ struct globals {
 static SDL_Window *window      = nullptr;
 
 char help[] =
-    " [-h] [-V] [-l] [-c <config file>] [-i <intput file>] [-x <width>] [-y <height>] [-z <fontsize>] [-p <dpi>] [-r <renderer>] [-d]\n\
+    " [-h] [-V] [-l] [-c <config file>] [-i <intput file>] [-o <output file> [-C]] [-x <width>] [-y <height>] [-z <fontsize>] [-p <dpi>] [-r <renderer>] [-d]\n\
 	-h : This help\n\
 	-V : Version information\n\
 	-l : slow CPU mode, disables AA and other items to try provide more FPS\n\
 	-c <config file> : alternative configuration file (default is ~/.config/" OBV_NAME
     "/obv.conf)\n\
 	-i <input file> : board file to load\n\
+	-o <output file> : convert the input file to the native .obv format and exit\n\
+	-C : compress the converted board\n\
 	-x <width> : Set window width\n\
 	-y <height> : Set window height\n\
 	-z <pixels> : Set font size\n\
@@ -109,6 +113,18 @@ int parse_parameters(int argc, char **argv, struct globals *g) {
 				exit(1);
 			}
 
+		} else if (strcmp(p, "-o") == 0) {
+			param++;
+			if ((param < argc)&&(argv[param][0] != '-')) {
+				g->output_file = argv[param];
+			} else {
+				SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Not enough paramters for -o <output file>\n\n%s %s", argv[0], help );
+				exit(1);
+			}
+
+		} else if (strcmp(p, "-C") == 0) {
+			g->compress = true;
+
 		} else if (strcmp(p, "-i") == 0) {
 			param++;
 			if ((param < argc)&&(argv[param][0] != '-')) {
@@ -226,17 +242,6 @@ int main(int argc, char **argv) {
 
 	app.debug = g.debug;
 
-	// Setup SDL
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
-		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Error: %s\n", SDL_GetError());
-		return -1;
-	}
-
-#if SDL_VERSION_ATLEAST(2, 0, 10)
-	// Enable touch gestures on multi-touch touchpads
-	SDL_SetHint(SDL_HINT_MOUSE_TOUCH_EVENTS, "1");
-#endif
-
 	// Load the configuration file
 	configDir = get_user_dir(UserDir::Config);
 	if (!configDir.empty()) app.obvconfig.Load(configDir + "obv.conf", true);
@@ -263,6 +268,32 @@ int main(int argc, char **argv) {
 	}
 #endif
 
+	// Convert the board to the native format, no window needed
+	if (g.output_file) {
+		if (!g.input_file) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "-o <output file> requires -i <input file>\n\n%s %s", argv[0], help);
+			return 1;
+		}
+		std::string error_msg;
+		app.SetFZKey(app.obvconfig.ParseStr("FZKey", ""));
+		if (!app.ConvertFile(filesystem::u8path(g.input_file), filesystem::u8path(g.output_file), g.compress, error_msg)) {
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", error_msg.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	// Setup SDL
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Error: %s\n", SDL_GetError());
+		return -1;
+	}
+
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+	// Enable touch gestures on multi-touch touchpads
+	SDL_SetHint(SDL_HINT_MOUSE_TOUCH_EVENTS, "1");
+#endif
+
 	// Apply the slowCPU flag if required.
 	app.slowCPU = g.slowCPU;
 
@@ -447,6 +478,9 @@ int main(int argc, char **argv) {
 			clear_color = ImColor(app.m_colors.backgroundColor);
 		}
 
+		// Keep drawing while a board loads in the background to show its progress
+		if (app.IsLoading()) sleepout = 30;
+
 		if (!(sleepout--)) {
 #ifdef _WIN32
 			Sleep(50);
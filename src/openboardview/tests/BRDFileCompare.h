@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FileFormats/BRDFileBase.h"
+
+#include <cstring>
+
+/*
+ * Field by field comparison of two parsed files, for the tests and benchmarks checking that two ways of reading a board agree.
+ * Returns the name of the first difference, setting index to the element it is in, or nullptr if the files are the same.
+ */
+inline const char *brd_file_difference(const BRDFileBase &a, const BRDFileBase &b, size_t &index) {
+	auto same_string = [](const char *s1, const char *s2) { return (!s1 || !s2) ? s1 == s2 : !strcmp(s1, s2); };
+	auto same_point  = [](const BRDPoint &p1, const BRDPoint &p2) { return p1.x == p2.x && p1.y == p2.y; };
+
+	index = 0;
+	if (a.num_format != b.num_format || a.format.size() != b.format.size()) return "format count";
+	if (a.num_parts != b.num_parts || a.parts.size() != b.parts.size()) return "part count";
+	if (a.num_pins != b.num_pins || a.pins.size() != b.pins.size()) return "pin count";
+	if (a.num_nails != b.num_nails || a.nails.size() != b.nails.size()) return "nail count";
+	if (a.outline_segments.size() != b.outline_segments.size()) return "outline segment count";
+
+	for (index = 0; index < a.format.size(); index++) {
+		if (!same_point(a.format[index], b.format[index])) return "format";
+	}
+	for (index = 0; index < a.outline_segments.size(); index++) {
+		auto &sa = a.outline_segments[index], &sb = b.outline_segments[index];
+		if (!same_point(sa.first, sb.first) || !same_point(sa.second, sb.second)) return "outline segment";
+	}
+	for (index = 0; index < a.parts.size(); index++) {
+		auto &pa = a.parts[index], &pb = b.parts[index];
+		if (!same_string(pa.name, pb.name) || pa.mfgcode != pb.mfgcode || pa.mounting_side != pb.mounting_side ||
+		    pa.part_type != pb.part_type || pa.end_of_pins != pb.end_of_pins || !same_point(pa.p1, pb.p1) ||
+		    !same_point(pa.p2, pb.p2))
+			return "part";
+	}
+	for (index = 0; index < a.pins.size(); index++) {
+		auto &pa = a.pins[index], &pb = b.pins[index];
+		if (!same_point(pa.pos, pb.pos) || pa.probe != pb.probe || pa.part != pb.part || pa.side != pb.side ||
+		    !same_string(pa.net, pb.net) || pa.radius != pb.radius || !same_string(pa.snum, pb.snum) ||
+		    !same_string(pa.name, pb.name))
+			return "pin";
+	}
+	for (index = 0; index < a.nails.size(); index++) {
+		auto &na = a.nails[index], &nb = b.nails[index];
+		if (na.probe != nb.probe || !same_point(na.pos, nb.pos) || na.side != nb.side || !same_string(na.net, nb.net))
+			return "nail";
+	}
+	return nullptr;
+}
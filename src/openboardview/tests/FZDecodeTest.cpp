@@ -0,0 +1,105 @@
+/*
+ * FZFile::decode() against the original byte at a time RC6 loop, on random keys and buffers.
+ * Sizes around the SIMD batch and the parallel chunk boundaries are checked on top of random ones.
+ */
+#include "FileFormats/FZFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static inline uint32_t rotl32(uint32_t a, int32_t b) {
+	return (a << b) | (a >> (32 - b));
+}
+
+// FZFile::decode() before it was batched, kept as is
+static void reference_decode(char *source, size_t size, const uint32_t key[44]) {
+	int32_t logw = 5;
+	uint32_t r   = 20;
+
+	uint32_t A = 0;
+	uint32_t B = 0;
+	uint32_t C = 0;
+	uint32_t D = 0;
+
+	uint8_t currentByte;
+	uint8_t ibuf[16] = {0};
+
+	for (size_t pos = 0; pos < size; ++pos) {
+		B = B + key[0];
+		D = D + key[1];
+		for (uint32_t i = 1; i < (r + 1); ++i) {
+			uint32_t t = rotl32(B * (2 * B + 1), logw);
+			uint32_t u = rotl32(D * (2 * D + 1), logw);
+			A          = rotl32(A ^ t, u) + key[2 * i];
+			C          = rotl32(C ^ u, t) + key[2 * i + 1];
+
+			uint32_t tmp = A;
+			A            = B;
+			B            = C;
+			C            = D;
+			D            = tmp;
+		}
+		A = A + key[2 * r + 2];
+		C = C + key[2 * r + 3];
+
+		currentByte = source[pos];
+		source[pos] = ((uint8_t)(currentByte ^ (A & 0xFF)));
+
+		for (uint32_t i = 0; i < 15; ++i) {
+			ibuf[i] = ibuf[i + 1];
+		}
+		ibuf[15] = currentByte;
+
+		A = ibuf[0] | ibuf[1] << 8 | ibuf[2] << 16 | ibuf[3] << 24;
+		B = ibuf[4] | ibuf[5] << 8 | ibuf[6] << 16 | ibuf[7] << 24;
+		C = ibuf[8] | ibuf[9] << 8 | ibuf[10] << 16 | ibuf[11] << 24;
+		D = ibuf[12] | ibuf[13] << 8 | ibuf[14] << 16 | ibuf[15] << 24;
+	}
+}
+
+int main() {
+	std::mt19937_64 rng(20240601);
+	const size_t MiB = 1024 * 1024;
+
+	// Empty, single bytes, around the 8 byte batches and the 16 byte window, then around the chunk sizes.
+	// decode() starts splitting from 2 MiB on, in chunks of at least 1 MiB.
+	std::vector<size_t> sizes = {0, 1, 2, 7, 8, 9, 15, 16, 17, 23, 24, 25, 31, 33, 63, 64, 65, 1000, 4097};
+	for (size_t s : {2 * MiB, 3 * MiB, 5 * MiB}) {
+		sizes.push_back(s - 1);
+		sizes.push_back(s);
+		sizes.push_back(s + 1);
+	}
+	sizes.push_back(2 * MiB + 7);
+	sizes.push_back(4 * MiB + 13);
+	for (int i = 0; i < 40; i++) sizes.push_back(rng() % 100000);
+	for (int i = 0; i < 4; i++) sizes.push_back(2 * MiB + rng() % (6 * MiB));
+
+	int failures = 0;
+	for (size_t size : sizes) {
+		uint32_t key[44];
+		for (auto &k : key) k = static_cast<uint32_t>(rng());
+
+		std::vector<char> source(size);
+		for (auto &c : source) c = static_cast<char>(rng());
+		std::vector<char> expected(source);
+		reference_decode(expected.data(), size, key);
+
+		// One chunk per thread, whatever the cores of the machine running the test
+		for (unsigned int threads : {1, 2, 3, 7}) {
+			std::vector<char> actual(source);
+			FZFile::decode(actual.data(), size, key, threads);
+			if (expected != actual) {
+				size_t at = 0;
+				while (expected[at] == actual[at]) at++;
+				fprintf(stderr, "size %zu, %u threads: first difference at byte %zu\n", size, threads, at);
+				failures++;
+			}
+		}
+	}
+
+	printf("%zu sizes, %d failures\n", sizes.size(), failures);
+	return failures ? 1 : 0;
+}
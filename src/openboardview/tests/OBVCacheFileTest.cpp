@@ -0,0 +1,99 @@
+/*
+ * Board cache round trip: a cache is only used for the board file it was built from, and gives back every field as written.
+ * Stale keys, truncated caches and out of range values must be misses, so that the board is parsed again.
+ */
+#include "FileFormats/OBVCacheFile.h"
+#include "tests/BRDFileCompare.h"
+#include "tests/TestBoard.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<char> read_bytes(const filesystem::path &path) {
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void write_bytes(const filesystem::path &path, const std::vector<char> &bytes) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(bytes.data(), bytes.size());
+}
+
+} // namespace
+
+int main() {
+	filesystem::path path = filesystem::temp_directory_path() / "openboardview_obvcachefile_test.obvcache";
+	int failures          = 0;
+	auto check            = [&](bool ok, const std::string &what) {
+		if (!ok) {
+			fprintf(stderr, "%s\n", what.c_str());
+			failures++;
+		}
+	};
+
+	// Stands for the board file the cache is built from
+	std::string content = "board file content";
+	std::string changed = "board file CONTENT";
+	BufferSpan buf(&content[0], content.size());
+	BufferSpan changed_buf(&changed[0], changed.size());
+
+	OBVCacheKey key;
+	key.file_size    = content.size();
+	key.mtime        = 1000;
+	key.content_hash = OBVCacheFile::hash(content.data(), content.size());
+
+	TestBoard board;
+	fill_board(board);
+	std::string error_msg;
+	check(OBVCacheFile::write(board, path, key, error_msg), "write: " + error_msg);
+	std::vector<char> bytes = read_bytes(path);
+
+	// Loads from a key as the loader makes it, without the hash
+	auto load = [&](uint64_t file_size, int64_t mtime, const BufferSpan &source, const BRDFileBase *expected) {
+		OBVCacheKey loaded;
+		loaded.file_size = file_size;
+		loaded.mtime     = mtime;
+		OBVCacheFile cache(path, loaded, source);
+		if (cache.valid && expected) {
+			size_t index;
+			if (const char *what = brd_file_difference(*expected, cache, index)) {
+				fprintf(stderr, "%s %zu differs\n", what, index);
+				return false;
+			}
+		}
+		return cache.valid;
+	};
+
+	check(load(key.file_size, key.mtime, buf, &board), "round trip");
+	check(!load(key.file_size + 1, key.mtime, buf, nullptr), "other file size used");
+	check(!load(key.file_size, key.mtime + 1, changed_buf, nullptr), "other content used");
+
+	// Touched but the same content: used, and the new mtime is stored so the content is not hashed again
+	check(load(key.file_size, key.mtime + 1, buf, &board), "touched file not used");
+	check(load(key.file_size, key.mtime + 1, changed_buf, &board), "touched file hashed again");
+	check(!load(key.file_size, key.mtime, changed_buf, nullptr), "old mtime used after the update");
+	write_bytes(path, bytes);
+
+	for (size_t size = 0; size < bytes.size(); size++) {
+		write_bytes(path, std::vector<char>(bytes.begin(), bytes.begin() + size));
+		check(!load(key.file_size, key.mtime, buf, nullptr), "cache truncated to " + std::to_string(size) + " bytes used");
+	}
+
+	for (int value = 0; value < broken_values; value++) {
+		TestBoard bad;
+		fill_board(bad);
+		break_board(bad, value);
+		check(OBVCacheFile::write(bad, path, key, error_msg), "write: " + error_msg);
+		check(!load(key.file_size, key.mtime, buf, nullptr), "out of range value " + std::to_string(value) + " used");
+	}
+
+	std::error_code ec;
+	filesystem::remove(path, ec);
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * OBVFile::write() then the OBVFile reader, with and without compression: every field must come back as written.
+ * Truncated files and out of range part numbers or enums must be rejected with an error rather than read.
+ */
+#include "FileFormats/OBVFile.h"
+#include "tests/BRDFileCompare.h"
+#include "tests/TestBoard.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<char> read_bytes(const filesystem::path &path) {
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Reads bytes as a native board, from a NUL terminated copy as the loader would give it
+bool read_board(std::vector<char> bytes, const BRDFileBase *expected, std::string &error_msg) {
+	size_t size = bytes.size();
+	bytes.push_back('\0');
+	OBVFile file(BufferSpan(bytes.data(), size));
+	error_msg = file.error_msg;
+	if (!file.valid) return false;
+	if (expected) {
+		size_t index;
+		if (const char *what = brd_file_difference(*expected, file, index)) {
+			error_msg = std::string(what) + " " + std::to_string(index) + " differs";
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+int main() {
+	filesystem::path path = filesystem::temp_directory_path() / "openboardview_obvfile_test.obv";
+	int failures          = 0;
+	auto check            = [&](bool ok, const std::string &what, const std::string &error_msg) {
+		if (!ok) {
+			fprintf(stderr, "%s: %s\n", what.c_str(), error_msg.c_str());
+			failures++;
+		}
+	};
+
+	for (bool compress : {false, true}) {
+		std::string mode = compress ? "compressed" : "uncompressed";
+		std::string error_msg;
+
+		TestBoard board;
+		fill_board(board);
+		check(OBVFile::write(board, path, compress, error_msg), mode + " write", error_msg);
+		std::vector<char> bytes = read_bytes(path);
+		check(read_board(bytes, &board, error_msg), mode + " round trip", error_msg);
+
+		// Cut anywhere, including inside the header, the columns and the string table
+		for (size_t size = 0; size < bytes.size(); size++) {
+			bool read = read_board(std::vector<char>(bytes.begin(), bytes.begin() + size), nullptr, error_msg);
+			check(!read && !error_msg.empty(), mode + " truncated to " + std::to_string(size) + " bytes", "read");
+		}
+
+		// Written as is, the reader has to catch them
+		for (int value = 0; value < broken_values; value++) {
+			TestBoard bad;
+			fill_board(bad);
+			break_board(bad, value);
+			check(OBVFile::write(bad, path, compress, error_msg), mode + " write", error_msg);
+			bool read = read_board(read_bytes(path), nullptr, error_msg);
+			check(!read && !error_msg.empty(), mode + " out of range value " + std::to_string(value), "read");
+		}
+	}
+
+	std::error_code ec;
+	filesystem::remove(path, ec);
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * BRD and BVR3 files parsed in several chunks must give the same result as a single chunk, whatever the chunk boundaries.
+ * The generated boards have blank lines and strings that are not UTF-8, re-encoded in the arena of each chunk.
+ */
+#include "FileFormats/BRDFile.h"
+#include "FileFormats/BVR3File.h"
+#include "tests/BRDFileCompare.h"
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const unsigned int pins_per_part = 7;
+
+std::string net_name(std::mt19937 &random) {
+	switch (random() % 8) {
+		case 0: return "GND";
+		case 1: return "N\xe9T_" + std::to_string(random() % 50); // Latin-1
+		default: return "NET_" + std::to_string(random() % 200);
+	}
+}
+
+std::string generate_brd(unsigned int nparts) {
+	std::mt19937 random(nparts);
+	unsigned int npins  = nparts * pins_per_part;
+	unsigned int nnails = nparts;
+
+	std::string text = "str_length:\r\n0\r\nvar_data:\r\n4 " + std::to_string(nparts) + " " + std::to_string(npins) + " " +
+	                   std::to_string(nnails) + "\r\nFormat:\r\n0 0\r\n1000 0\r\n1000 1000\r\n0 1000\r\nParts:\r\n";
+	for (unsigned int i = 0; i < nparts; i++) {
+		text += "U" + std::to_string(i) + " " + std::to_string(random() % 10) + " " + std::to_string((i + 1) * pins_per_part) + "\r\n";
+	}
+	text += "Pins:\r\n";
+	for (unsigned int i = 0; i < npins; i++) {
+		if (random() % 16 == 0) text += "\r\n";
+		text += std::to_string(random() % 10000) + " " + std::to_string(random() % 10000) + " " + std::to_string(int(random() % 200) - 99) +
+		        " " + std::to_string(i / pins_per_part + 1) + " " + net_name(random) + "\r\n";
+	}
+	text += "Nails:\r\n";
+	for (unsigned int i = 0; i < nnails; i++) {
+		text += std::to_string(i) + " " + std::to_string(random() % 10000) + " " + std::to_string(random() % 10000) + " " +
+		        std::to_string(1 + random() % 2) + " " + net_name(random) + "\r\n";
+	}
+	return text;
+}
+
+std::string generate_bvr3(unsigned int nparts) {
+	std::mt19937 random(nparts);
+	const char *sides[] = {"T", "B", "O"};
+
+	std::string text = "BVRAW_FORMAT_3\r\n";
+	for (unsigned int i = 0; i < nparts; i++) {
+		text += "PART_NAME U\xe9" + std::to_string(i) + "\r\nPART_SIDE " + sides[random() % 3] + "\r\nPART_ORIGIN 0 0\r\n";
+		text += std::string("PART_MOUNT ") + (random() % 2 ? "SMD" : "TH") + "\r\n";
+		for (unsigned int j = 0; j < pins_per_part; j++) {
+			text += "PIN_ID " + std::to_string(j) + "\r\nPIN_NUMBER " + std::to_string(j + 1) + "\r\nPIN_NAME P" + std::to_string(j) + "\r\n";
+			text += std::string("PIN_SIDE ") + sides[random() % 3] + "\r\nPIN_ORIGIN " + std::to_string(random() % 10000) + ".5 " +
+			        std::to_string(random() % 10000) + ".25\r\nPIN_RADIUS 0.5\r\nPIN_NET " + net_name(random) + "\r\nPIN_END\r\n";
+			if (random() % 16 == 0) text += "\r\n";
+		}
+		text += "PART_END\r\n";
+		if (i % 50 == 0) {
+			int x = random() % 1000, y = random() % 1000;
+			text += "OUTLINE_SEGMENTED " + std::to_string(x) + " " + std::to_string(y) + " " + std::to_string(x + 10) + " " +
+			        std::to_string(y) + "\r\n";
+		}
+	}
+	return text;
+}
+
+// Parses its own copy of text, parsers work in place and keep pointers into it
+template <class File>
+struct Parsed {
+	std::vector<char> buffer;
+	std::unique_ptr<File> file;
+
+	Parsed(const std::string &text, size_t nchunks) : buffer(text.begin(), text.end()) {
+		buffer.push_back('\0');
+		force_chunk_count(nchunks);
+		file.reset(new File(BufferSpan(buffer.data(), text.size())));
+		force_chunk_count(0);
+	}
+};
+
+template <class File>
+int check_chunks(const char *format, const std::string &text) {
+	int failures = 0;
+	Parsed<File> single(text, 1);
+	if (!single.file->valid || single.file->pins.empty()) {
+		fprintf(stderr, "%s: not parsed: %s\n", format, single.file->error_msg.c_str());
+		return 1;
+	}
+	for (size_t nchunks : {2, 3, 5, 8, 61}) {
+		Parsed<File> chunked(text, nchunks);
+		size_t index;
+		const char *what = brd_file_difference(*single.file, *chunked.file, index);
+		if (!what && chunked.file->valid != single.file->valid) what = "validity";
+		if (!what && chunked.file->error_msg != single.file->error_msg) what = "error message";
+		if (what) {
+			fprintf(stderr, "%s in %zu chunks: %s %zu differs\n", format, nchunks, what, index);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+} // namespace
+
+int main() {
+	int failures = 0;
+	for (unsigned int nparts : {1, 2, 40, 1000}) {
+		failures += check_chunks<BRDFile>("BRD", generate_brd(nparts));
+		failures += check_chunks<BVR3File>("BVR3", generate_bvr3(nparts));
+	}
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Board::ComputePartGeometry(), which computes each footprint once and shifts it onto the other parts having it,
+ * must give what Component::ComputeOutline() gives on every part: outline, hull, centre, type and pin sizes.
+ */
+#include "BRDBoard.h"
+#include "FileFormats/BRDFile.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const float pin_diameter         = 20.0f;
+const float default_pin_diameter = 7.0f;
+
+// Parts placed anywhere with one of a few footprints, whose names lead ComputeOutline() to different shapes
+std::string generate_brd(unsigned int nparts) {
+	std::mt19937 random(nparts);
+	const char *prefixes[] = {"U", "Q", "D", "C", "R", "L", "J", "CN", "LED", "ZD", "X", "LC"};
+
+	std::vector<std::vector<std::pair<int, int>>> footprints(24);
+	for (auto &footprint : footprints) {
+		size_t npins = 1 + random() % 12;
+		for (size_t j = 0; j < npins; j++) footprint.push_back({int(random() % 300), int(random() % 300)});
+	}
+
+	std::string parts, pins;
+	unsigned int npins = 0;
+	for (unsigned int i = 0; i < nparts; i++) {
+		auto &footprint = footprints[random() % footprints.size()];
+		int x = random() % 10000, y = random() % 10000;
+		for (auto &offset : footprint) {
+			pins += std::to_string(x + offset.first) + " " + std::to_string(y + offset.second) + " 0 " + std::to_string(i + 1) + " NET_" +
+			        std::to_string(random() % 100) + "\n";
+		}
+		npins += footprint.size();
+		parts += std::string(prefixes[random() % 12]) + std::to_string(i) + " " + std::to_string(1 + random() % 2) + " " +
+		         std::to_string(npins) + "\n";
+	}
+	return "str_length:\n0\nvar_data:\n4 " + std::to_string(nparts) + " " + std::to_string(npins) +
+	       " 0\nFormat:\n0 0\n10000 0\n10000 10000\n0 10000\nParts:\n" + parts + "Pins:\n" + pins + "Nails:\n";
+}
+
+bool near(const ImVec2 &a, const ImVec2 &b) {
+	return std::fabs(a.x - b.x) < 0.01f && std::fabs(a.y - b.y) < 0.01f;
+}
+
+// Name of the first difference between the geometry of the two parts, nullptr if there is none
+const char *difference(Component &a, Component &b) {
+	if (a.outline_done != b.outline_done) return "outline_done";
+	if (a.component_type != b.component_type) return "component type";
+	if (std::fabs(a.expanse - b.expanse) > 0.01) return "expanse";
+	if (!near(a.omin, b.omin) || !near(a.omax, b.omax)) return "bounds";
+	if (!near(a.centerpoint, b.centerpoint)) return "centre";
+	for (size_t i = 0; i < a.outline.size(); i++) {
+		if (!near(a.outline[i], b.outline[i])) return "outline";
+	}
+	if (a.hull.size() != b.hull.size()) return "hull size";
+	for (size_t i = 0; i < a.hull.size(); i++) {
+		if (!near(a.hull[i], b.hull[i])) return "hull";
+	}
+	for (size_t i = 0; i < a.pins.size(); i++) {
+		if (a.pins[i]->diameter() != b.pins[i]->diameter()) return "pin diameter";
+	}
+	return nullptr;
+}
+
+} // namespace
+
+int main() {
+	int failures = 0;
+	for (unsigned int nparts : {1, 30, 2000}) {
+		std::string text = generate_brd(nparts);
+		std::vector<char> buffer(text.begin(), text.end());
+		buffer.push_back('\0');
+		BRDFile file(BufferSpan(buffer.data(), text.size()));
+		if (!file.valid) {
+			fprintf(stderr, "%u parts: not parsed: %s\n", nparts, file.error_msg.c_str());
+			failures++;
+			continue;
+		}
+
+		// Computed part by part, as before footprints were shared
+		BRDBoard expected(&file);
+		auto &diameters = expected.PinData().diameter;
+		std::fill(diameters.begin(), diameters.end(), default_pin_diameter);
+		for (auto &part : expected.Components()) {
+			if (!part->is_dummy() && !part->pins.empty()) part->ComputeOutline(pin_diameter);
+		}
+
+		for (size_t nchunks : {1, 4}) {
+			BRDBoard board(&file);
+			force_chunk_count(nchunks);
+			board.ComputePartGeometry(pin_diameter, default_pin_diameter);
+			force_chunk_count(0);
+
+			for (size_t i = 0; i < board.Components().size(); i++) {
+				if (const char *what = difference(*expected.Components()[i], *board.Components()[i])) {
+					fprintf(stderr, "%u parts in %zu chunks: %s of part %zu differs\n", nparts, nchunks, what, i);
+					failures++;
+					break;
+				}
+			}
+			if (nparts > 100 && board.unique_footprints >= nparts / 2) {
+				fprintf(stderr, "%u parts: %zu footprints, repeated ones are not shared\n", nparts, board.unique_footprints);
+				failures++;
+			}
+		}
+	}
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "FileFormats/BRDFileBase.h"
+
+// Parsers only build their own file, so tests fill a BRDFileBase directly
+class TestBoard : public BRDFileBase {};
+
+// A few elements of each kind, with null, empty, shared and non-ASCII strings
+inline void fill_board(TestBoard &board) {
+	board.format           = {{0, 0}, {1000, 0}, {1000, -500}, {0, -500}};
+	board.outline_segments = {{{0, 0}, {1000, 0}}, {{1000, 0}, {1000, -500}}};
+
+	BRDPart part;
+	part.name          = "U1";
+	part.mfgcode       = "LM358 dual op-amp";
+	part.mounting_side = BRDPartMountingSide::Top;
+	part.part_type     = BRDPartType::SMD;
+	part.end_of_pins   = 3;
+	part.p1            = {10, 20};
+	part.p2            = {30, 40};
+	board.parts.push_back(part);
+
+	part.name          = "J\xc3\xa9"; // Not ASCII
+	part.mfgcode       = "";
+	part.mounting_side = BRDPartMountingSide::Both;
+	part.part_type     = BRDPartType::ThroughHole;
+	part.end_of_pins   = 4;
+	part.p1            = {-5, -6};
+	part.p2            = {7, 8};
+	board.parts.push_back(part);
+
+	for (int i = 0; i < 4; i++) {
+		BRDPin pin;
+		pin.pos    = {i * 100, -i * 50};
+		pin.probe  = i - 1;
+		pin.part   = i < 3 ? 1 : 2;
+		pin.side   = i % 2 ? BRDPinSide::Bottom : BRDPinSide::Top;
+		pin.net    = i % 2 ? "GND" : "VCC_3V3";
+		pin.radius = 0.25 * (i + 1);
+		pin.snum   = i == 2 ? nullptr : (i ? "2" : "1");
+		pin.name   = i == 1 ? "OUT" : nullptr;
+		board.pins.push_back(pin);
+	}
+
+	BRDNail nail;
+	nail.probe = 7;
+	nail.pos   = {500, -250};
+	nail.side  = BRDPartMountingSide::Bottom;
+	nail.net   = "GND";
+	board.nails.push_back(nail);
+
+	board.num_format = board.format.size();
+	board.num_parts  = board.parts.size();
+	board.num_pins   = board.pins.size();
+	board.num_nails  = board.nails.size();
+	board.valid      = true;
+}
+
+// Ways break_board() has to put a value out of range
+const int broken_values = 7;
+
+// Puts one value BRDBoard relies on out of range: the part of a pin, then a side or part type enum
+inline void break_board(TestBoard &board, int value) {
+	switch (value) {
+		case 0: board.pins[1].part = 0; break;
+		case 1: board.pins[1].part = board.parts.size() + 1; break;
+		case 2: board.pins[1].part = 0xffffffffu; break;
+		case 3: board.pins[0].side = static_cast<BRDPinSide>(3); break;
+		case 4: board.parts[1].part_type = static_cast<BRDPartType>(2); break;
+		case 5: board.parts[0].mounting_side = static_cast<BRDPartMountingSide>(200); break;
+		case 6: board.nails[0].side = static_cast<BRDPartMountingSide>(3); break;
+	}
+}
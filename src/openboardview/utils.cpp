@@ -56,7 +56,7 @@ bool check_fileext(const filesystem::path &filepath, const std::string fileext)
 }
 
 // Returns true if the given str was found in buf
-bool find_str_in_buf(const std::string str, const std::vector<char> &buf) {
+bool find_str_in_buf(const std::string str, const BufferSpan &buf) {
 	return std::search(buf.begin(), buf.end(), str.begin(), str.end()) != buf.end();
 }
 
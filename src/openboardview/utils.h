@@ -5,6 +5,7 @@
 
 #include <SDL.h>
 
+#include "MappedFile.h"
 #include "filesystem_impl.h"
 
 // Verify predicate X, if false write error to ERROR_MSG and log and execute ACTION
@@ -24,7 +25,7 @@ std::vector<char> file_as_buffer(const filesystem::path &filepath, std::string &
 bool check_fileext(const filesystem::path &filepath, const std::string fileext);
 
 // Retunrs true if the given str was found in buf
-bool find_str_in_buf(const std::string str, const std::vector<char> &buf);
+bool find_str_in_buf(const std::string str, const BufferSpan &buf);
 
 // Case insensitive comparison of std::string
 bool compare_string_insensitive(const std::string &str1, const std::string &str2);
@@ -1,4 +1,5 @@
 #include "imgui/imgui.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <climits>
@@ -6,6 +7,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <tuple>
+#include <unordered_map>
 
 #include "vectorhulls.h"
 
@@ -261,3 +264,90 @@ bool GetIntersection(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3, ImVec2 *i) {
 
 	return false; // No collision
 }
+
+/*
+ * Triangles covering what horizontal scanlines fill between segments, even-odd.
+ * The segments need not be joined in loops: the plane is cut in slabs at the height of every end point,
+ * the segments crossing a slab are sorted along it and paired, each pair bounding a trapezoid.
+ * Trapezoids of the same pair of segments in consecutive slabs are merged.
+ */
+std::vector<ImVec2> VHFillTriangles(const std::vector<std::pair<ImVec2, ImVec2>> &segments) {
+	struct Edge {
+		double x0, y0, x1, y1; // y0 < y1
+
+		double x(double y) const {
+			return x0 + (x1 - x0) * (y - y0) / (y1 - y0);
+		}
+		bool operator<(const Edge &e) const {
+			return std::tie(y0, x0, y1, x1) < std::tie(e.y0, e.x0, e.y1, e.x1);
+		}
+		bool operator==(const Edge &e) const {
+			return x0 == e.x0 && y0 == e.y0 && x1 == e.x1 && y1 == e.y1;
+		}
+	};
+
+	// Horizontal segments never cross a scanline, duplicate ones would cancel out
+	std::vector<Edge> edges;
+	for (auto &s : segments) {
+		if (s.first.y < s.second.y) edges.push_back({s.first.x, s.first.y, s.second.x, s.second.y});
+		if (s.first.y > s.second.y) edges.push_back({s.second.x, s.second.y, s.first.x, s.first.y});
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	std::vector<double> ys;
+	for (auto &e : edges) {
+		ys.push_back(e.y0);
+		ys.push_back(e.y1);
+	}
+	std::sort(ys.begin(), ys.end());
+	ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+	std::vector<ImVec2> triangles;
+	auto emit = [&](const Edge &l, const Edge &r, double ya, double yb) {
+		ImVec2 a(l.x(ya), ya), b(r.x(ya), ya), c(r.x(yb), yb), d(l.x(yb), yb);
+		triangles.insert(triangles.end(), {a, b, c, a, c, d});
+	};
+
+	struct Trapezoid {
+		uint32_t left, right;
+		double top;
+		bool carried;
+	};
+	auto key = [](const Trapezoid &t) { return uint64_t{t.left} << 32 | t.right; };
+	std::vector<Trapezoid> open, next;
+	std::unordered_map<uint64_t, size_t> open_index;
+	std::vector<uint32_t> active;
+	size_t added = 0;
+	for (size_t k = 0; k + 1 < ys.size(); k++) {
+		double ya = ys[k], yb = ys[k + 1], ym = (ya + yb) / 2;
+
+		// Edges are sorted by their lower end
+		active.erase(std::remove_if(active.begin(), active.end(), [&](uint32_t e) { return edges[e].y1 <= ya; }), active.end());
+		for (; added < edges.size() && edges[added].y0 <= ya; added++) active.push_back(added);
+		std::sort(active.begin(), active.end(), [&](uint32_t a, uint32_t b) { return edges[a].x(ym) < edges[b].x(ym); });
+
+		// Inside between the first and second edge, the third and fourth...
+		next.clear();
+		for (size_t i = 0; i + 1 < active.size(); i += 2) {
+			Trapezoid t = {active[i], active[i + 1], ya, false};
+			auto it     = open_index.find(key(t));
+			if (it != open_index.end()) {
+				t.top                    = open[it->second].top;
+				open[it->second].carried = true;
+			}
+			next.push_back(t);
+		}
+		for (auto &o : open) {
+			if (!o.carried) emit(edges[o.left], edges[o.right], o.top, ya);
+		}
+		open.swap(next);
+		open_index.clear();
+		for (size_t i = 0; i < open.size(); i++) open_index[key(open[i])] = i;
+	}
+	if (!ys.empty()) {
+		for (auto &o : open) emit(edges[o.left], edges[o.right], o.top, ys.back());
+	}
+
+	return triangles;
+}
@@ -2,6 +2,7 @@
 #define VECTORHULLS
 
 #include <array>
+#include <utility>
 #include <vector>
 
 void VHRotateV(double *px, double *py, double ox, double oy, double theta);
@@ -12,6 +13,8 @@ int VHConvexHullOrientation(ImVec2 p, ImVec2 q, ImVec2 r);
 std::vector<ImVec2> VHConvexHull(const std::vector<ImVec2> &points);
 int VHTightenHull(ImVec2 hull[], int n, double threshold);
 std::array<ImVec2, 4> VHMBBCalculate(std::vector<ImVec2> hull, double psz);
+// Even-odd fill of the area between segments, 3 vertices per triangle
+std::vector<ImVec2> VHFillTriangles(const std::vector<std::pair<ImVec2, ImVec2>> &segments);
 
 bool GetIntersection(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3, ImVec2 *i);
 